@@ -0,0 +1,152 @@
+#include "Accelerator.h"
+#include "TiledOperations.h"
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+namespace OcvUtility
+{
+	atomic<bool> Accelerator::_isEnabled(false);
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// enable()
+	//
+	// Start running on the default OpenCL device. Returns false, leaving
+	// everything on the CPU, if OpenCV has no OpenCL device to use.
+	//////////////////////////////////////////////////////////////////////////////////
+	bool Accelerator::enable()
+	{
+		if (!ocl::haveOpenCL())
+			return false;
+
+		ocl::setUseOpenCL(true);
+
+		if (!ocl::useOpenCL() || !ocl::Device::getDefault().available())
+		{
+			ocl::setUseOpenCL(false);
+			return false;
+		}
+
+		_isEnabled = true;
+
+		return true;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// disable()
+	//
+	// Run everything on the CPU from now on.
+	//////////////////////////////////////////////////////////////////////////////////
+	void Accelerator::disable()
+	{
+		_isEnabled = false;
+		ocl::setUseOpenCL(false);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// isEnabled()
+	//
+	// Returns true if operations are currently run on the device.
+	//////////////////////////////////////////////////////////////////////////////////
+	bool Accelerator::isEnabled()
+	{
+		return _isEnabled;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getDeviceName()
+	//
+	// Returns the name of the device operations run on, or an empty string if they
+	// run on the CPU.
+	//////////////////////////////////////////////////////////////////////////////////
+	string Accelerator::getDeviceName()
+	{
+		if (!_isEnabled)
+			return string();
+
+		return ocl::Device::getDefault().name();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// acceleratedMorphologyEx()
+	//
+	// morphologyEx() on the device if the accelerator is enabled, otherwise in
+	// parallel strips on the CPU. The source is uploaded and the result downloaded
+	// once each; nothing stays on the device between calls.
+	//
+	// On the CPU, morphologyEx() of a region of interest reads the pixels of its
+	// parent image beyond the region, but only in its first pass: an opening,
+	// closing or hat erodes or dilates into a new image with no parent, so its
+	// second pass uses the border value at the edges of the region. An uploaded
+	// region would lose its parent, so it is uploaded with as much of its parent
+	// around it as the first pass can reach. The first pass is cropped back to the
+	// region on the device before a compound operation's second pass, so both
+	// passes see what they see on the CPU.
+	//////////////////////////////////////////////////////////////////////////////////
+	void acceleratedMorphologyEx(const Mat& source, Mat& destination, const int operation, const Mat& element, const Point anchor, const int iterations, const int borderType, const Scalar& borderValue)
+	{
+		if (Accelerator::isEnabled())
+		{
+			try
+			{
+				const Size reach = Size(element.cols * iterations, element.rows * iterations);
+				Size parentSize;
+				Point offset;
+				source.locateROI(parentSize, offset);
+
+				const bool isIsolated = (borderType & BORDER_ISOLATED) != 0;	// The parent isn't read then, on either path.
+				const int top = isIsolated ? 0 : min(reach.height, offset.y);
+				const int bottom = isIsolated ? 0 : min(reach.height, parentSize.height - offset.y - source.rows);
+				const int left = isIsolated ? 0 : min(reach.width, offset.x);
+				const int right = isIsolated ? 0 : min(reach.width, parentSize.width - offset.x - source.cols);
+				const Rect region = Rect(left, top, source.cols, source.rows);
+
+				Mat paddedSource = source;
+				paddedSource.adjustROI(top, bottom, left, right);
+
+				UMat deviceSource;
+				paddedSource.copyTo(deviceSource);
+
+				const bool isOpening = (operation == MORPH_OPEN || operation == MORPH_TOPHAT);
+				const bool isClosing = (operation == MORPH_CLOSE || operation == MORPH_BLACKHAT);
+				if (!isOpening && !isClosing)
+				{
+					UMat deviceDestination;
+					morphologyEx(deviceSource, deviceDestination, operation, element, anchor, iterations, borderType, borderValue);
+					deviceDestination(region).copyTo(destination);
+
+					return;
+				}
+
+				// The first pass is copied out of its padding, so the second has no parent to read, as on the CPU.
+				UMat firstPass;
+				UMat croppedFirstPass;
+				UMat secondPass;
+				morphologyEx(deviceSource, firstPass, isOpening ? MORPH_ERODE : MORPH_DILATE, element, anchor, iterations, borderType, borderValue);
+				firstPass(region).copyTo(croppedFirstPass);
+				morphologyEx(croppedFirstPass, secondPass, isOpening ? MORPH_DILATE : MORPH_ERODE, element, anchor, iterations, borderType, borderValue);
+
+				if (operation == MORPH_TOPHAT)
+					subtract(deviceSource(region), secondPass, secondPass);
+				else if (operation == MORPH_BLACKHAT)
+					subtract(secondPass, deviceSource(region), secondPass);
+
+				secondPass.copyTo(destination);
+
+				return;
+			}
+			catch (const cv::Exception& e)
+			{
+				cerr << "OpenCL morphology failed, continuing on the CPU: " << e.what() << endl;
+				Accelerator::disable();
+			}
+		}
+
+		tiledMorphologyEx(source, destination, operation, element, anchor, iterations, borderType, borderValue);
+	}
+}
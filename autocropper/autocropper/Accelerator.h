@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <atomic>
+#include <string>
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// Accelerator
+	//
+	// Run background subtraction and morphology on an OpenCL device through
+	// OpenCV's transparent API. The accelerator is off until enabled, and can only
+	// be enabled when a device is present, so every caller falls back to the CPU
+	// without having to check. An operation that fails on the device disables the
+	// accelerator and is run again on the CPU. Only the background model and the
+	// foreground union stay on the device between frames; each morphology call
+	// uploads its source and downloads its result.
+	//////////////////////////////////////////////////////////////////////////////////
+	class Accelerator final
+	{
+	public:
+		static bool enable();
+		static void disable();
+		static bool isEnabled();
+		static std::string getDeviceName();
+	private:
+		static std::atomic<bool> _isEnabled;
+	};
+
+	void acceleratedMorphologyEx(const cv::Mat& source, cv::Mat& destination, const int operation, const cv::Mat& element, const cv::Point anchor = cv::Point(-1, -1), const int iterations = 1, const int borderType = cv::BORDER_CONSTANT, const cv::Scalar& borderValue = cv::morphologyDefaultBorderValue());
+}
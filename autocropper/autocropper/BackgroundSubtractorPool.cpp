@@ -0,0 +1,83 @@
+#include "BackgroundSubtractorPool.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <opencv2/video.hpp>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+vector<Ptr<BackgroundSubtractorMOG2>> BackgroundSubtractorPool::_idleInstances;
+mutex BackgroundSubtractorPool::_mutex;
+
+//////////////////////////////////////////////////////////////////////////////////
+// acquire()
+//
+// Returns an idle instance if there is one, otherwise a new one. Give it
+// learning rate 1 on its first frame.
+//////////////////////////////////////////////////////////////////////////////////
+Ptr<BackgroundSubtractorMOG2> BackgroundSubtractorPool::acquire()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+
+		if (!_idleInstances.empty())
+		{
+			Ptr<BackgroundSubtractorMOG2> backgroundSubtractor = _idleInstances.back();
+			_idleInstances.pop_back();
+			return backgroundSubtractor;
+		}
+	}
+
+	return createBackgroundSubtractorMOG2();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// release()
+//
+// Give back an instance acquired from the pool once its series is done. It is
+// freed instead if the pool already has as many idle instances as it keeps.
+//////////////////////////////////////////////////////////////////////////////////
+void BackgroundSubtractorPool::release(const Ptr<BackgroundSubtractorMOG2>& backgroundSubtractor)
+{
+	if (!backgroundSubtractor)
+		return;
+
+	lock_guard<mutex> lock(_mutex);
+
+	if (_idleInstances.size() < getMaximumNumberOfIdleInstances())
+		_idleInstances.push_back(backgroundSubtractor);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfIdleInstances()
+//
+// Returns the number of instances waiting to be reused.
+//////////////////////////////////////////////////////////////////////////////////
+size_t BackgroundSubtractorPool::getNumberOfIdleInstances()
+{
+	lock_guard<mutex> lock(_mutex);
+	return _idleInstances.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getMaximumNumberOfIdleInstances()
+//
+// Returns the most instances the pool keeps for reuse: one per worker thread.
+//////////////////////////////////////////////////////////////////////////////////
+size_t BackgroundSubtractorPool::getMaximumNumberOfIdleInstances()
+{
+	return ThreadPool::getDefaultNumberOfThreads();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// clear()
+//
+// Free every idle instance and its model.
+//////////////////////////////////////////////////////////////////////////////////
+void BackgroundSubtractorPool::clear()
+{
+	lock_guard<mutex> lock(_mutex);
+	_idleInstances.clear();
+}
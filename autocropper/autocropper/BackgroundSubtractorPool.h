@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/video.hpp>
+#include <mutex>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// BackgroundSubtractorPool
+	//
+	// MOG2 instances kept for reuse, so a series doesn't pay for constructing one
+	// and allocating its model. The model of a full resolution frame is hundreds
+	// of megabytes, and an instance keeps it when its series is done. A reused
+	// instance must be given learning rate 1 on its first frame, which clears the
+	// model exactly as a new instance starts. At most one idle instance per worker
+	// thread is kept, as no more series than that run at once; the rest are freed
+	// when they are given back. The pool may be shared between threads.
+	//////////////////////////////////////////////////////////////////////////////////
+	class BackgroundSubtractorPool final
+	{
+	public:
+		static cv::Ptr<cv::BackgroundSubtractorMOG2> acquire();
+		static void release(const cv::Ptr<cv::BackgroundSubtractorMOG2>& backgroundSubtractor);
+		static size_t getNumberOfIdleInstances();
+		static size_t getMaximumNumberOfIdleInstances();
+		static void clear();
+	private:
+		static std::vector<cv::Ptr<cv::BackgroundSubtractorMOG2>> _idleInstances;
+		static std::mutex _mutex;
+	};
+}
@@ -0,0 +1,475 @@
+#include "BatchProcessor.h"
+#include "BoundedQueue.h"
+#include "CropPipeline.h"
+#include "CropResultCache.h"
+#include "CropSidecar.h"
+#include "FileUtilities.h"
+#include "ImageReader.h"
+#include "PackedSeries.h"
+#include "WorkStealingThreadPool.h"
+#include <opencv2/core.hpp>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <thread>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// findSeries()
+//
+// Returns the starting file of every series to process. The specified path is
+// either a directory, in which case the first frame of every series in it is
+// listed, or a manifest listing one starting file per line. The directory is
+// indexed into the specified index if there is one, so processSeries() needn't
+// list it again.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> BatchProcessor::findSeries(const string& directoryOrManifest, SeriesIndex* seriesIndex)
+{
+	if (FileUtilities::isDirectory(directoryOrManifest))
+	{
+		SeriesIndex directoryIndex;
+
+		return (seriesIndex != nullptr ? *seriesIndex : directoryIndex).getStartingFilenames(directoryOrManifest);
+	}
+
+	return readManifest(directoryOrManifest);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// processSeries()
+//
+// Crop every specified series, writing each one's cropped images to its own
+// subdirectory of the output directory. Returns one result per series, in the
+// order the series were specified. The frames of each series are looked up in
+// the specified index, or in one made for the batch if there isn't one.
+//////////////////////////////////////////////////////////////////////////////////
+vector<SeriesResult> BatchProcessor::processSeries(const vector<string>& startingFilenames, const string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, SeriesIndex* seriesIndex)
+{
+	SeriesIndex batchSeriesIndex;
+	SeriesIndex& activeSeriesIndex = (seriesIndex != nullptr) ? *seriesIndex : batchSeriesIndex;
+
+	// Image decodes and encodes go to their own pool: a series task blocks on them, so they can't share the series pool.
+	ThreadPool readerThreadPool;
+	MatPool matPool;	// Shared by every series, so later series reuse the buffers of earlier ones.
+	vector<future<SeriesResult>> pendingResults;
+	vector<SeriesResult> results;
+
+	{
+		WorkStealingThreadPool seriesThreadPool;
+
+		for (const auto& startingFilename : startingFilenames)
+		{
+			pendingResults.push_back(seriesThreadPool.submit([startingFilename, &outputDirectory, &options, &outputOptions, resultCache, &activeSeriesIndex, &readerThreadPool, &matPool]()
+			{
+				return processOneSeries(startingFilename, outputDirectory, options, outputOptions, resultCache, activeSeriesIndex, readerThreadPool, matPool);
+			}));
+		}
+
+		for (auto& pendingResult : pendingResults)
+		{
+			results.push_back(pendingResult.get());
+		}
+	}
+
+	return results;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// processSeriesPipelined()
+//
+// Crop every specified series like processSeries(), but pass the series through
+// a pipeline of stages: one thread reads series, a thread per core analyzes
+// them, and one thread writes them. The next series is read while others are
+// analyzed and written, so the disk, the CPU and the encoder are all kept busy.
+// A series takes a token before it is read and gives it back once it is
+// written, and there is one token per analyze thread plus the specified queue
+// capacity, so that is the most series whose frames are held at once: each
+// analyze thread has a series to work on and the reader is only that far ahead.
+//////////////////////////////////////////////////////////////////////////////////
+vector<SeriesResult> BatchProcessor::processSeriesPipelined(const vector<string>& startingFilenames, const string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, SeriesIndex* seriesIndex, const unsigned int queueCapacity)
+{
+	SeriesIndex batchSeriesIndex;
+	SeriesIndex& activeSeriesIndex = (seriesIndex != nullptr) ? *seriesIndex : batchSeriesIndex;
+
+	ThreadPool readerThreadPool;	// The read and write stages decode and encode the frames of a series in parallel.
+	MatPool matPool;
+	const unsigned int numberOfAnalyzeThreads = ThreadPool::getDefaultNumberOfThreads();
+	const unsigned int maximumSeriesInFlight = numberOfAnalyzeThreads + queueCapacity;
+	BoundedQueue<unsigned int> inFlightTokens(maximumSeriesInFlight);	// Never holds more than it starts with, so giving one back never blocks.
+	BoundedQueue<unique_ptr<SeriesWork>> readSeriesQueue(maximumSeriesInFlight);
+	BoundedQueue<unique_ptr<SeriesWork>> analyzedSeriesQueue(maximumSeriesInFlight);
+	vector<SeriesResult> results(startingFilenames.size());
+
+	for (unsigned int i = 0; i < maximumSeriesInFlight; ++i)
+	{
+		inFlightTokens.push(i);
+	}
+
+	// Outside of runStage() only running out of memory can throw, but a stage thread that dies leaves the others waiting, so the series is failed instead.
+	thread readThread([&]()
+	{
+		for (size_t i = 0; i < startingFilenames.size(); ++i)
+		{
+			unsigned int token = 0;
+			inFlightTokens.pop(token);
+
+			try
+			{
+				unique_ptr<SeriesWork> work = beginSeries(i, startingFilenames[i]);
+				readSeries(*work, outputDirectory, options, outputOptions, resultCache, activeSeriesIndex, readerThreadPool);
+				readSeriesQueue.push(move(work));
+			}
+			catch (...)
+			{
+				results[i] = createFailedResult(startingFilenames[i], describeCurrentException());
+				inFlightTokens.push(token);
+			}
+		}
+
+		readSeriesQueue.close();
+	});
+
+	vector<thread> analyzeThreads;
+	for (unsigned int i = 0; i < numberOfAnalyzeThreads; ++i)
+	{
+		analyzeThreads.emplace_back([&]()
+		{
+			unique_ptr<SeriesWork> work;
+
+			while (readSeriesQueue.pop(work))
+			{
+				const size_t index = work->index;
+
+				try
+				{
+					analyzeSeries(*work, options, resultCache, matPool);
+					analyzedSeriesQueue.push(move(work));
+				}
+				catch (...)
+				{
+					results[index] = createFailedResult(startingFilenames[index], describeCurrentException());
+					work.reset();
+					inFlightTokens.push(0);
+				}
+			}
+		});
+	}
+
+	thread writeThread([&]()
+	{
+		unique_ptr<SeriesWork> work;
+
+		while (analyzedSeriesQueue.pop(work))
+		{
+			const size_t index = work->index;
+
+			try
+			{
+				writeSeries(*work, outputOptions, readerThreadPool);
+				results[index] = finishSeries(*work);
+			}
+			catch (...)
+			{
+				results[index] = createFailedResult(startingFilenames[index], describeCurrentException());
+			}
+
+			work.reset();	// Release the frames before the next series is read in their place.
+			inFlightTokens.push(0);
+		}
+	});
+
+	readThread.join();
+
+	for (auto& analyzeThread : analyzeThreads)
+	{
+		analyzeThread.join();
+	}
+
+	analyzedSeriesQueue.close();
+	writeThread.join();
+
+	return results;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeSummary()
+//
+// Write the crop region of every series as CSV, one series per line.
+//////////////////////////////////////////////////////////////////////////////////
+void BatchProcessor::writeSummary(const vector<SeriesResult>& results, ostream& stream)
+{
+	stream << "series,starting_file,status,x,y,width,height,frames_used,error" << endl;
+
+	for (const auto& result : results)
+	{
+		stream << FileUtilities::quoteCsv(result.seriesName) << "," << FileUtilities::quoteCsv(result.startingFilename) << ","
+			<< (result.succeeded ? "ok" : "failed") << ","
+			<< result.cropRegion.x << "," << result.cropRegion.y << ","
+			<< result.cropRegion.width << "," << result.cropRegion.height << ","
+			<< result.numberOfFramesUsed << "," << FileUtilities::quoteCsv(result.errorMessage) << endl;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getProfiles()
+//
+// Returns the stage timings of every series, in the order of the results.
+//////////////////////////////////////////////////////////////////////////////////
+vector<SeriesProfile> BatchProcessor::getProfiles(const vector<SeriesResult>& results)
+{
+	vector<SeriesProfile> profiles;
+
+	for (const auto& result : results)
+	{
+		profiles.push_back(result.profile);
+	}
+
+	return profiles;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// processOneSeries()
+//
+// Crop a single series. Any error is caught and recorded in the result so that
+// the rest of the batch can carry on. The time each stage took is recorded in the
+// result whether or not the series succeeded. A series found in the result cache
+// is only read if its images are to be cropped. Only the frames the index lists
+// are read.
+//////////////////////////////////////////////////////////////////////////////////
+SeriesResult BatchProcessor::processOneSeries(const string& startingFilename, const string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, SeriesIndex& seriesIndex, ThreadPool& readerThreadPool, MatPool& matPool)
+{
+	const unique_ptr<SeriesWork> work = beginSeries(0, startingFilename);
+
+	readSeries(*work, outputDirectory, options, outputOptions, resultCache, seriesIndex, readerThreadPool);
+	analyzeSeries(*work, options, resultCache, matPool);
+	writeSeries(*work, outputOptions, readerThreadPool);
+
+	return finishSeries(*work);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// beginSeries()
+//
+// Returns the work of a series that no stage has run on yet.
+//////////////////////////////////////////////////////////////////////////////////
+unique_ptr<BatchProcessor::SeriesWork> BatchProcessor::beginSeries(const size_t index, const string& startingFilename)
+{
+	unique_ptr<SeriesWork> work(new SeriesWork());
+	work->index = index;
+	work->result.startingFilename = startingFilename;
+	work->result.seriesName = ImageReader::getSeriesName(startingFilename);
+	work->result.numberOfFramesUsed = 0;
+	work->result.succeeded = false;
+	work->profiler.reset(new StageProfiler(work->result.seriesName));
+	work->isCached = false;
+	work->hasFailed = false;
+
+	return work;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readSeries()
+//
+// Create the output directory of a series, look it up in the result cache, and
+// read its frames unless it was found and its images aren't to be cropped. A
+// packed series is mapped instead, and named as it was packed.
+//////////////////////////////////////////////////////////////////////////////////
+void BatchProcessor::readSeries(SeriesWork& work, const string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, SeriesIndex& seriesIndex, ThreadPool& readerThreadPool)
+{
+	runStage(work, [&]()
+	{
+		const bool isPackedSeries = PackedSeries::isPackedSeries(work.result.startingFilename);
+		vector<string> filenames;
+
+		if (isPackedSeries)
+		{
+			work.packedSeries.reset(new PackedSeries(work.result.startingFilename));
+			work.result.seriesName = work.packedSeries->getSeriesName();
+			filenames.push_back(work.result.startingFilename);	// The packed file is the one source, as CropSidecar::create() lists it.
+		}
+		else
+		{
+			filenames = seriesIndex.getFilenames(work.result.startingFilename);
+			if (filenames.empty())
+				throw runtime_error("No frames of the series were found.");
+		}
+
+		work.seriesOutputDirectory = FileUtilities::joinPath(outputDirectory, work.result.seriesName) + "/";
+
+		if (!FileUtilities::createDirectories(work.seriesOutputDirectory))
+			throw runtime_error("Unable to create output directory: " + work.seriesOutputDirectory);
+
+		work.sidecar = CropSidecar::create(work.result.seriesName, filenames, Rect(), Rect());
+		work.cacheKey = (resultCache != nullptr) ? CropResultCache::computeKey(work.sidecar.sourceFilenames, options, work.profiler.get()) : string();
+		work.isCached = (resultCache != nullptr && resultCache->lookup(work.cacheKey, work.sidecar));
+
+		if (!work.isCached || outputOptions.writeImages)
+		{
+			StageProfiler::ScopedStage stage(work.profiler.get(), "readDataset");
+			work.originalImages = isPackedSeries ? work.packedSeries->getFrames() : ImageReader::readImages(filenames, readerThreadPool);
+
+			for (const auto& image : work.originalImages)
+			{
+				stage.addImage(image);
+			}
+		}
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// analyzeSeries()
+//
+// Find the crop region of a series that wasn't in the result cache, and store
+// it there.
+//////////////////////////////////////////////////////////////////////////////////
+void BatchProcessor::analyzeSeries(SeriesWork& work, const CropRegionOptions& options, const CropResultCache* resultCache, MatPool& matPool)
+{
+	runStage(work, [&]()
+	{
+		if (!work.isCached)
+		{
+			Mat foregroundUnion;
+			Mat* foregroundUnionOut = (resultCache != nullptr && resultCache->isStoringForegroundUnion()) ? &foregroundUnion : nullptr;
+			work.sidecar.cropRegion = computeSeriesCropRegion(work.originalImages, options, &matPool, work.profiler.get(), &work.sidecar.gelRegion, foregroundUnionOut, &work.result.numberOfFramesUsed);
+
+			if (resultCache != nullptr)
+				resultCache->store(work.cacheKey, work.sidecar, foregroundUnion);
+		}
+
+		work.result.cropRegion = work.sidecar.cropRegion;
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeSeries()
+//
+// Write the sidecar and cropped images of a series, then release its frames.
+//////////////////////////////////////////////////////////////////////////////////
+void BatchProcessor::writeSeries(SeriesWork& work, const CropOutputOptions& outputOptions, ThreadPool& readerThreadPool)
+{
+	runStage(work, [&]()
+	{
+		if (outputOptions.writeSidecar)
+			work.sidecar.write(work.seriesOutputDirectory + CropSidecar::DEFAULT_FILENAME);
+
+		if (outputOptions.writeImages)
+			cropOriginalImages(work.originalImages, work.result.cropRegion, work.seriesOutputDirectory, outputOptions, readerThreadPool, work.profiler.get());
+
+		work.result.succeeded = true;
+	});
+
+	work.originalImages.clear();
+	work.packedSeries.reset();	// Only once its frames, which may be views of it, are gone.
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// finishSeries()
+//
+// Returns the result of a series, with the time each stage took.
+//////////////////////////////////////////////////////////////////////////////////
+SeriesResult BatchProcessor::finishSeries(SeriesWork& work)
+{
+	work.result.profile = work.profiler->getProfile();
+
+	return work.result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// runStage()
+//
+// Run the specified stage of a series unless an earlier stage failed. An error
+// is caught and recorded in the result, so the rest of the batch carries on.
+//////////////////////////////////////////////////////////////////////////////////
+void BatchProcessor::runStage(SeriesWork& work, const function<void()>& stage)
+{
+	if (work.hasFailed)
+		return;
+
+	try
+	{
+		stage();
+	}
+	catch (...)
+	{
+		work.hasFailed = true;
+		work.result.errorMessage = describeCurrentException();
+		cerr << "Failed to process series " << work.result.startingFilename << ": " << work.result.errorMessage << endl;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// createFailedResult()
+//
+// Returns the result of a series that failed outside of any stage.
+//////////////////////////////////////////////////////////////////////////////////
+SeriesResult BatchProcessor::createFailedResult(const string& startingFilename, const string& errorMessage)
+{
+	SeriesResult result;
+	result.startingFilename = startingFilename;
+	result.seriesName = ImageReader::getSeriesName(startingFilename);
+	result.numberOfFramesUsed = 0;
+	result.succeeded = false;
+	result.errorMessage = errorMessage;
+	cerr << "Failed to process series " << startingFilename << ": " << errorMessage << endl;
+
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// describeCurrentException()
+//
+// Returns the message of the exception being handled. Must be called from a
+// catch block.
+//////////////////////////////////////////////////////////////////////////////////
+string BatchProcessor::describeCurrentException()
+{
+	try
+	{
+		throw;
+	}
+	catch (const exception& e)	// cv::Exception derives from std::exception.
+	{
+		return e.what();
+	}
+	catch (...)
+	{
+		return "Unknown error.";
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readManifest()
+//
+// Returns the starting files listed in the specified manifest, skipping blank
+// lines and lines beginning with #.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> BatchProcessor::readManifest(const string& manifestFilename)
+{
+	vector<string> startingFilenames;
+	ifstream manifest(manifestFilename);
+	string line;
+
+	if (!manifest)
+	{
+		cerr << "Unable to open manifest: " << manifestFilename << endl;
+		return startingFilenames;
+	}
+
+	while (getline(manifest, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		startingFilenames.push_back(line);
+	}
+
+	return startingFilenames;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CropPipeline.h"
+#include "CropResultCache.h"
+#include "CropSidecar.h"
+#include "MatPool.h"
+#include "PackedSeries.h"
+#include "SeriesIndex.h"
+#include "StageProfiler.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// SeriesResult
+	//
+	// The outcome of cropping a single series in a batch.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct SeriesResult
+	{
+		std::string startingFilename;
+		std::string seriesName;
+		cv::Rect cropRegion;
+		int numberOfFramesUsed;		// The frames the crop region was found from; 0 if it came from the result cache.
+		bool succeeded;
+		std::string errorMessage;
+		utility::SeriesProfile profile;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// BatchProcessor
+	//
+	// Crop many series in one invocation. Series are processed concurrently on a
+	// work-stealing thread pool, and a series that fails doesn't stop the others.
+	// The frames of every series are found through one SeriesIndex, so each
+	// directory is listed once for the whole batch, and a packed series may be
+	// listed in place of its starting file. Alternatively the series flow
+	// through a pipeline of stages (read, analyze, write), so the disk, the CPU and
+	// the encoder work on different series at once.
+	//////////////////////////////////////////////////////////////////////////////////
+	class BatchProcessor final
+	{
+	public:
+		static std::vector<std::string> findSeries(const std::string& directoryOrManifest, SeriesIndex* seriesIndex = nullptr);
+		static std::vector<SeriesResult> processSeries(const std::vector<std::string>& startingFilenames, const std::string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions = CropOutputOptions(), const CropResultCache* resultCache = nullptr, SeriesIndex* seriesIndex = nullptr);
+		static std::vector<SeriesResult> processSeriesPipelined(const std::vector<std::string>& startingFilenames, const std::string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions = CropOutputOptions(), const CropResultCache* resultCache = nullptr, SeriesIndex* seriesIndex = nullptr, const unsigned int queueCapacity = DEFAULT_QUEUE_CAPACITY);
+		static void writeSummary(const std::vector<SeriesResult>& results, std::ostream& stream);
+		static std::vector<utility::SeriesProfile> getProfiles(const std::vector<SeriesResult>& results);
+		static SeriesResult processOneSeries(const std::string& startingFilename, const std::string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, SeriesIndex& seriesIndex, utility::ThreadPool& readerThreadPool, utility::MatPool& matPool);
+
+		static const unsigned int DEFAULT_QUEUE_CAPACITY = 2;	// Series read ahead of the analyze threads in the pipeline.
+	private:
+		// A series on its way through the stages of processOneSeries(). Once a stage
+		// fails, the later ones skip the series.
+		struct SeriesWork
+		{
+			size_t index;
+			SeriesResult result;
+			std::unique_ptr<utility::StageProfiler> profiler;
+			std::string seriesOutputDirectory;
+			CropSidecar sidecar;
+			std::string cacheKey;
+			bool isCached;
+			bool hasFailed;
+			std::vector<cv::Mat> originalImages;
+			std::unique_ptr<PackedSeries> packedSeries;	// Keeps a packed series mapped while its frames are views of it.
+		};
+
+		static std::unique_ptr<SeriesWork> beginSeries(const size_t index, const std::string& startingFilename);
+		static void readSeries(SeriesWork& work, const std::string& outputDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, SeriesIndex& seriesIndex, utility::ThreadPool& readerThreadPool);
+		static void analyzeSeries(SeriesWork& work, const CropRegionOptions& options, const CropResultCache* resultCache, utility::MatPool& matPool);
+		static void writeSeries(SeriesWork& work, const CropOutputOptions& outputOptions, utility::ThreadPool& readerThreadPool);
+		static SeriesResult finishSeries(SeriesWork& work);
+		static void runStage(SeriesWork& work, const std::function<void()>& stage);
+		static SeriesResult createFailedResult(const std::string& startingFilename, const std::string& errorMessage);
+		static std::string describeCurrentException();
+		static std::vector<std::string> readManifest(const std::string& manifestFilename);
+	};
+}
@@ -0,0 +1,395 @@
+#include "BinaryMask.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <stdexcept>
+#if CV_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// BinaryMask()
+	//
+	// Create an empty mask.
+	//////////////////////////////////////////////////////////////////////////////////
+	BinaryMask::BinaryMask()
+		: _wordsPerRow(0)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// BinaryMask()
+	//
+	// Create a mask of the specified size with every pixel clear.
+	//////////////////////////////////////////////////////////////////////////////////
+	BinaryMask::BinaryMask(const Size size)
+		: _size(size),
+		_wordsPerRow((size.width + BITS_PER_WORD - 1) / BITS_PER_WORD),
+		_words(static_cast<size_t>(_wordsPerRow) * size.height, 0)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// pack()
+	//
+	// Returns the mask of the nonzero pixels of the specified CV_8UC1 image.
+	//////////////////////////////////////////////////////////////////////////////////
+	BinaryMask BinaryMask::pack(const Mat& image)
+	{
+		BinaryMask mask(image.size());
+		mask.orNonZero(image);
+
+		return mask;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// unpack()
+	//
+	// Write the mask into the specified image as a CV_8UC1 image of 0s and 255s.
+	// If the image is already the right size and type its buffer is reused.
+	//////////////////////////////////////////////////////////////////////////////////
+	void BinaryMask::unpack(Mat& image) const
+	{
+		image.create(_size, CV_8UC1);
+
+		for (int y = 0; y < _size.height; ++y)
+		{
+			const uint64_t* words = ptr(y);
+			uchar* pixels = image.ptr<uchar>(y);
+
+			for (int x = 0; x < _size.width; ++x)
+			{
+				pixels[x] = ((words[x / BITS_PER_WORD] >> (x % BITS_PER_WORD)) & 1) ? 255 : 0;
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// orNonZero()
+	//
+	// Set the pixels that are nonzero in the specified CV_8UC1 image, and in the
+	// specified mask if there is one. This is the packed equivalent of
+	// bitwise_or(union, image, union, mask) on a union only tested for zero.
+	//////////////////////////////////////////////////////////////////////////////////
+	void BinaryMask::orNonZero(const Mat& image, const Mat& mask)
+	{
+		if (image.size() != _size || image.type() != CV_8UC1 || (!mask.empty() && (mask.size() != _size || mask.type() != CV_8UC1)))
+			throw invalid_argument("Only a CV_8UC1 image and mask the size of the binary mask can be ored into it.");
+
+		for (int y = 0; y < _size.height; ++y)
+		{
+			const uchar* pixels = image.ptr<uchar>(y);
+			const uchar* maskPixels = mask.empty() ? nullptr : mask.ptr<uchar>(y);
+			uint64_t* words = getRowWords(y);
+
+			for (int word = 0; word < _wordsPerRow; ++word)
+			{
+				const int x = word * BITS_PER_WORD;
+				const int length = min(BITS_PER_WORD, _size.width - x);
+				uint64_t bits = packPixels(pixels + x, length);
+
+				if (maskPixels != nullptr)
+					bits &= packPixels(maskPixels + x, length);
+
+				words[word] |= bits;
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// orWith()
+	//
+	// Set every pixel that is set in the specified mask of the same size.
+	//////////////////////////////////////////////////////////////////////////////////
+	void BinaryMask::orWith(const BinaryMask& other)
+	{
+		if (other._size != _size)
+			throw invalid_argument("Only binary masks of the same size can be ored.");
+
+		for (size_t i = 0; i < _words.size(); ++i)
+		{
+			_words[i] |= other._words[i];
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// andWith()
+	//
+	// Clear every pixel that is clear in the specified mask of the same size.
+	//////////////////////////////////////////////////////////////////////////////////
+	void BinaryMask::andWith(const BinaryMask& other)
+	{
+		if (other._size != _size)
+			throw invalid_argument("Only binary masks of the same size can be anded.");
+
+		for (size_t i = 0; i < _words.size(); ++i)
+		{
+			_words[i] &= other._words[i];
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// clear()
+	//
+	// Clear every pixel, keeping the size.
+	//////////////////////////////////////////////////////////////////////////////////
+	void BinaryMask::clear()
+	{
+		fill(_words.begin(), _words.end(), 0);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countRow()
+	//
+	// Returns the number of set pixels in the specified row.
+	//////////////////////////////////////////////////////////////////////////////////
+	int BinaryMask::countRow(const int y) const
+	{
+		const uint64_t* words = ptr(y);
+		int count = 0;
+
+		for (int word = 0; word < _wordsPerRow; ++word)
+		{
+			count += countBits(words[word]);
+		}
+
+		return count;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countColumns()
+	//
+	// Returns the number of set pixels in each column. Only the set bits of each
+	// word are visited, so a sparse mask is counted quickly.
+	//////////////////////////////////////////////////////////////////////////////////
+	vector<int> BinaryMask::countColumns() const
+	{
+		vector<int> counts(_size.width, 0);
+
+		for (int y = 0; y < _size.height; ++y)
+		{
+			const uint64_t* words = ptr(y);
+
+			for (int word = 0; word < _wordsPerRow; ++word)
+			{
+				for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+				{
+					++counts[word * BITS_PER_WORD + findLowestBit(bits)];
+				}
+			}
+		}
+
+		return counts;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findFirstInRow()
+	//
+	// Returns the column of the first set pixel of the specified row, or the width
+	// if none is set, as findFirstNonZero() does.
+	//////////////////////////////////////////////////////////////////////////////////
+	int BinaryMask::findFirstInRow(const int y) const
+	{
+		const uint64_t* words = ptr(y);
+
+		for (int word = 0; word < _wordsPerRow; ++word)
+		{
+			if (words[word] != 0)
+				return word * BITS_PER_WORD + findLowestBit(words[word]);
+		}
+
+		return _size.width;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLastInRow()
+	//
+	// Returns the column of the last set pixel of the specified row, or -1 if none
+	// is set, as findLastNonZero() does.
+	//////////////////////////////////////////////////////////////////////////////////
+	int BinaryMask::findLastInRow(const int y) const
+	{
+		const uint64_t* words = ptr(y);
+
+		for (int word = _wordsPerRow - 1; word >= 0; --word)
+		{
+			if (words[word] != 0)
+				return word * BITS_PER_WORD + findHighestBit(words[word]);
+		}
+
+		return -1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeBoundingRect()
+	//
+	// Returns the smallest rectangle containing every set pixel, or an empty
+	// rectangle if none is set, as computeNonZeroBoundingRect() does. The set
+	// columns are found by oring the rows together a word at a time.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect BinaryMask::computeBoundingRect() const
+	{
+		vector<uint64_t> columns(_wordsPerRow, 0);
+		int top = -1, bottom = -1;
+
+		for (int y = 0; y < _size.height; ++y)
+		{
+			const uint64_t* words = ptr(y);
+			uint64_t row = 0;
+
+			for (int word = 0; word < _wordsPerRow; ++word)
+			{
+				columns[word] |= words[word];
+				row |= words[word];
+			}
+
+			if (row != 0)
+			{
+				if (top < 0)
+					top = y;
+				bottom = y;
+			}
+		}
+
+		if (top < 0)
+			return Rect();
+
+		int left = 0, right = 0;
+		for (int word = 0; word < _wordsPerRow; ++word)
+		{
+			if (columns[word] != 0)
+			{
+				left = word * BITS_PER_WORD + findLowestBit(columns[word]);
+				break;
+			}
+		}
+
+		for (int word = _wordsPerRow - 1; word >= 0; --word)
+		{
+			if (columns[word] != 0)
+			{
+				right = word * BITS_PER_WORD + findHighestBit(columns[word]);
+				break;
+			}
+		}
+
+		return Rect(left, top, right - left + 1, bottom - top + 1);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// size()
+	//
+	// Returns the size of the mask in pixels.
+	//////////////////////////////////////////////////////////////////////////////////
+	Size BinaryMask::size() const
+	{
+		return _size;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// empty()
+	//
+	// Returns true if the mask has no pixels.
+	//////////////////////////////////////////////////////////////////////////////////
+	bool BinaryMask::empty() const
+	{
+		return _words.empty();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// ptr()
+	//
+	// Returns the words of the specified row.
+	//////////////////////////////////////////////////////////////////////////////////
+	const uint64_t* BinaryMask::ptr(const int y) const
+	{
+		return _words.data() + static_cast<size_t>(y) * _wordsPerRow;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getRowWords()
+	//
+	// Returns the words of the specified row, for writing.
+	//////////////////////////////////////////////////////////////////////////////////
+	uint64_t* BinaryMask::getRowWords(const int y)
+	{
+		return _words.data() + static_cast<size_t>(y) * _wordsPerRow;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countBits()
+	//
+	// Returns the number of set bits of the specified word. Written out rather
+	// than using a popcount intrinsic, which 32 bit builds and older CPUs lack.
+	//////////////////////////////////////////////////////////////////////////////////
+	int BinaryMask::countBits(uint64_t word)
+	{
+		word = word - ((word >> 1) & 0x5555555555555555ULL);
+		word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+		word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+		return static_cast<int>((word * 0x0101010101010101ULL) >> 56);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLowestBit()
+	//
+	// Returns the index of the lowest set bit of the specified nonzero word.
+	//////////////////////////////////////////////////////////////////////////////////
+	int BinaryMask::findLowestBit(const uint64_t word)
+	{
+		return countBits((word & (~word + 1)) - 1);	// The bits below the lowest set one.
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findHighestBit()
+	//
+	// Returns the index of the highest set bit of the specified nonzero word.
+	//////////////////////////////////////////////////////////////////////////////////
+	int BinaryMask::findHighestBit(uint64_t word)
+	{
+		// Set every bit below the highest set one, then count them.
+		word |= word >> 1;
+		word |= word >> 2;
+		word |= word >> 4;
+		word |= word >> 8;
+		word |= word >> 16;
+		word |= word >> 32;
+
+		return countBits(word) - 1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// packPixels()
+	//
+	// Returns a word with bit x set if pixel x of the specified pixels is nonzero,
+	// for up to 64 pixels.
+	//////////////////////////////////////////////////////////////////////////////////
+	uint64_t BinaryMask::packPixels(const uchar* pixels, const int length)
+	{
+		uint64_t bits = 0;
+		int x = 0;
+
+#if CV_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 16 <= length; x += 16)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + x));
+			const int zeroBits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+			bits |= static_cast<uint64_t>(~zeroBits & 0xFFFF) << x;
+		}
+#endif
+
+		for (; x < length; ++x)
+		{
+			if (pixels[x] != 0)
+				bits |= uint64_t(1) << x;
+		}
+
+		return bits;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// BinaryMask
+	//
+	// A mask with one bit per pixel, packed 64 pixels to a word. Pixel x of a row
+	// is bit x % 64 of word x / 64, and the bits past the width of a row are always
+	// clear. Ors, ands and counts work a word at a time, so they touch an eighth of
+	// the memory a CV_8UC1 mask would. Masks are converted to and from CV_8UC1
+	// only where they meet OpenCV.
+	//////////////////////////////////////////////////////////////////////////////////
+	class BinaryMask final
+	{
+	public:
+		BinaryMask();
+		explicit BinaryMask(const cv::Size size);
+
+		static BinaryMask pack(const cv::Mat& image);
+		void unpack(cv::Mat& image) const;
+		void orNonZero(const cv::Mat& image, const cv::Mat& mask = cv::Mat());
+		void orWith(const BinaryMask& other);
+		void andWith(const BinaryMask& other);
+		void clear();
+
+		int countRow(const int y) const;
+		std::vector<int> countColumns() const;
+		int findFirstInRow(const int y) const;
+		int findLastInRow(const int y) const;
+		cv::Rect computeBoundingRect() const;
+
+		cv::Size size() const;
+		bool empty() const;
+		const std::uint64_t* ptr(const int y) const;
+
+		static int countBits(std::uint64_t word);
+		static int findLowestBit(const std::uint64_t word);
+		static int findHighestBit(std::uint64_t word);
+
+		static const int BITS_PER_WORD = 64;
+	private:
+		std::uint64_t* getRowWords(const int y);
+
+		static std::uint64_t packPixels(const uchar* pixels, const int length);
+
+		cv::Size _size;
+		int _wordsPerRow;
+		std::vector<std::uint64_t> _words;
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// BoundedQueue
+	//
+	// A first in, first out queue between threads which holds at most a fixed
+	// number of items. push() blocks while the queue is full, so a producer can't
+	// run further ahead of its consumers than the capacity, and pop() blocks while
+	// it is empty. Once the queue is closed, pop() returns false after the items
+	// already queued have been taken.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	class BoundedQueue final
+	{
+	public:
+		explicit BoundedQueue(const size_t capacity);
+
+		void push(T item);
+		bool pop(T& item);
+		void close();
+
+		size_t getCapacity() const;
+	private:
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		std::deque<T> _items;
+		size_t _capacity;
+		std::mutex _mutex;
+		std::condition_variable _itemAvailable;
+		std::condition_variable _spaceAvailable;
+		bool _isClosed;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// BoundedQueue()
+	//
+	// Create an empty queue which holds at most the specified number of items.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	BoundedQueue<T>::BoundedQueue(const size_t capacity)
+		: _capacity(capacity),
+		_isClosed(false)
+	{
+		if (capacity == 0)
+			throw std::invalid_argument("A bounded queue must hold at least one item.");
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// push()
+	//
+	// Add the specified item to the back of the queue, waiting until there is room
+	// for it. Throws if the queue has been closed.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	void BoundedQueue<T>::push(T item)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_spaceAvailable.wait(lock, [this]() { return _isClosed || _items.size() < _capacity; });
+
+			if (_isClosed)
+				throw std::logic_error("Can't push to a closed queue.");
+
+			_items.push_back(std::move(item));
+		}
+
+		_itemAvailable.notify_one();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// pop()
+	//
+	// Take the item at the front of the queue, waiting until there is one. Returns
+	// false, leaving the item untouched, once the queue is closed and empty.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	bool BoundedQueue<T>::pop(T& item)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_itemAvailable.wait(lock, [this]() { return _isClosed || !_items.empty(); });
+
+			if (_items.empty())
+				return false;
+
+			item = std::move(_items.front());
+			_items.pop_front();
+		}
+
+		_spaceAvailable.notify_one();
+
+		return true;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// close()
+	//
+	// Mark the end of the items, waking every thread waiting on the queue.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	void BoundedQueue<T>::close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_isClosed = true;
+		}
+
+		_itemAvailable.notify_all();
+		_spaceAvailable.notify_all();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getCapacity()
+	//
+	// Returns the most items the queue holds at once.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	size_t BoundedQueue<T>::getCapacity() const
+	{
+		return _capacity;
+	}
+}
@@ -0,0 +1,183 @@
+#include "CommandLineArguments.h"
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace utility;
+
+const string CommandLineArguments::OPTION_PREFIX = "--";
+const string CommandLineArguments::OPTION_VALUE_DELIMETER = "=";
+
+//////////////////////////////////////////////////////////////////////////////////
+// CommandLineArguments()
+//
+// Parse the specified command line. The program name (argv[0]) is skipped.
+//////////////////////////////////////////////////////////////////////////////////
+CommandLineArguments::CommandLineArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const string argument = argv[i];
+
+		if (argument.compare(0, OPTION_PREFIX.size(), OPTION_PREFIX) != 0)
+		{
+			_positionalArguments.push_back(argument);
+			continue;
+		}
+
+		const size_t delimeterPosition = argument.find(OPTION_VALUE_DELIMETER);
+		const string name = argument.substr(OPTION_PREFIX.size(), delimeterPosition - OPTION_PREFIX.size());
+		const string value = (delimeterPosition == string::npos) ? "" : argument.substr(delimeterPosition + 1);
+
+		_options[name] = value;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// hasOption()
+//
+// Returns true if the specified option was given, with or without a value.
+//////////////////////////////////////////////////////////////////////////////////
+bool CommandLineArguments::hasOption(const string& name) const
+{
+	return _options.find(name) != _options.end();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getOption()
+//
+// Returns the value of the specified option, or the default value if the option
+// was not given.
+//////////////////////////////////////////////////////////////////////////////////
+string CommandLineArguments::getOption(const string& name, const string& defaultValue) const
+{
+	auto option = _options.find(name);
+
+	return (option == _options.end()) ? defaultValue : option->second;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getDoubleOption()
+//
+// Returns the value of the specified option as a number, or the default value if
+// the option was not given. Throws if the value is not a number.
+//////////////////////////////////////////////////////////////////////////////////
+double CommandLineArguments::getDoubleOption(const string& name, const double defaultValue) const
+{
+	if (!hasOption(name))
+		return defaultValue;
+
+	return parseDouble(name, getOption(name));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getIntegerOption()
+//
+// Returns the value of the specified option as an integer, or the default value
+// if the option was not given. Throws if the value is not an integer.
+//////////////////////////////////////////////////////////////////////////////////
+int CommandLineArguments::getIntegerOption(const string& name, const int defaultValue) const
+{
+	if (!hasOption(name))
+		return defaultValue;
+
+	const string value = getOption(name);
+	size_t charactersParsed = 0;
+	int number = 0;
+
+	try
+	{
+		number = stoi(value, &charactersParsed);
+	}
+	catch (const exception&)
+	{
+		charactersParsed = 0;
+	}
+
+	if (charactersParsed == 0 || charactersParsed != value.size())
+		throw invalid_argument("Expected an integer for " + OPTION_PREFIX + name + ", got: " + value);
+
+	return number;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getListOption()
+//
+// Returns the comma separated values of the specified option, or no values if
+// the option was not given.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> CommandLineArguments::getListOption(const string& name) const
+{
+	vector<string> values;
+
+	if (!hasOption(name))
+		return values;
+
+	istringstream list(getOption(name));
+	string value;
+
+	while (getline(list, value, LIST_DELIMETER))
+	{
+		values.push_back(value);
+	}
+
+	return values;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getDoubleListOption()
+//
+// Returns the comma separated values of the specified option as numbers, or
+// just the default value if the option was not given. Throws if any value is
+// not a number.
+//////////////////////////////////////////////////////////////////////////////////
+vector<double> CommandLineArguments::getDoubleListOption(const string& name, const double defaultValue) const
+{
+	if (!hasOption(name))
+		return vector<double>(1, defaultValue);
+
+	vector<double> numbers;
+
+	for (const auto& value : getListOption(name))
+	{
+		numbers.push_back(parseDouble(name, value));
+	}
+
+	return numbers;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getPositionalArguments()
+//
+// Returns the arguments that are not options, in the order they were given.
+//////////////////////////////////////////////////////////////////////////////////
+const vector<string>& CommandLineArguments::getPositionalArguments() const
+{
+	return _positionalArguments;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// parseDouble()
+//
+// Returns the specified value of the named option as a number. Throws if the
+// value is not a number.
+//////////////////////////////////////////////////////////////////////////////////
+double CommandLineArguments::parseDouble(const string& name, const string& value)
+{
+	size_t charactersParsed = 0;
+	double number = 0;
+
+	try
+	{
+		number = stod(value, &charactersParsed);
+	}
+	catch (const exception&)
+	{
+		charactersParsed = 0;
+	}
+
+	if (charactersParsed == 0 || charactersParsed != value.size())
+		throw invalid_argument("Expected a number for " + OPTION_PREFIX + name + ", got: " + value);
+
+	return number;
+}
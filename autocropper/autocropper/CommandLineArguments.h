@@ -0,0 +1,38 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CommandLineArguments
+	//
+	// Split the command line into positional arguments and options. Options are
+	// given as --name or --name=value, where a value may be a list separated by
+	// commas.
+	//////////////////////////////////////////////////////////////////////////////////
+	class CommandLineArguments final
+	{
+	public:
+		CommandLineArguments(int argc, char** argv);
+
+		bool hasOption(const std::string& name) const;
+		std::string getOption(const std::string& name, const std::string& defaultValue = "") const;
+		double getDoubleOption(const std::string& name, const double defaultValue) const;
+		int getIntegerOption(const std::string& name, const int defaultValue) const;
+		std::vector<std::string> getListOption(const std::string& name) const;
+		std::vector<double> getDoubleListOption(const std::string& name, const double defaultValue) const;
+		const std::vector<std::string>& getPositionalArguments() const;
+	private:
+		static double parseDouble(const std::string& name, const std::string& value);
+
+		static const std::string OPTION_PREFIX;			// Options are expected in the following format: [Prefix][Name]=[Value]
+		static const std::string OPTION_VALUE_DELIMETER;
+		static const char LIST_DELIMETER = ',';
+
+		std::map<std::string, std::string> _options;
+		std::vector<std::string> _positionalArguments;
+	};
+}
@@ -0,0 +1,120 @@
+#include "ContentHash.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ContentHash()
+//
+// Create the hash of nothing.
+//////////////////////////////////////////////////////////////////////////////////
+ContentHash::ContentHash()
+	: _value(OFFSET_BASIS)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// add()
+//
+// Add the specified bytes to the hash.
+//////////////////////////////////////////////////////////////////////////////////
+void ContentHash::add(const void* data, const size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		_value = (_value ^ bytes[i]) * PRIME;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// add()
+//
+// Add the specified string to the hash. Its length goes in first, so that
+// adding "ab" then "c" doesn't hash like adding "a" then "bc".
+//////////////////////////////////////////////////////////////////////////////////
+void ContentHash::add(const string& value)
+{
+	add(static_cast<int>(value.size()));
+	add(value.data(), value.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// add()
+//
+// Add the specified integer to the hash.
+//////////////////////////////////////////////////////////////////////////////////
+void ContentHash::add(const int value)
+{
+	add(&value, sizeof(value));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// add()
+//
+// Add the specified number to the hash, by its exact bits.
+//////////////////////////////////////////////////////////////////////////////////
+void ContentHash::add(const double value)
+{
+	add(&value, sizeof(value));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// addFile()
+//
+// Add the size and contents of the specified file to the hash. Returns false,
+// leaving the hash unchanged, if the file can't be read.
+//////////////////////////////////////////////////////////////////////////////////
+bool ContentHash::addFile(const string& filename)
+{
+	ifstream file(filename, ios::binary);
+
+	if (!file)
+		return false;
+
+	ContentHash fileHash;
+	vector<char> buffer(FILE_BUFFER_SIZE);
+	long long fileSize = 0;
+
+	while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+	{
+		fileHash.add(buffer.data(), static_cast<size_t>(file.gcount()));
+		fileSize += file.gcount();
+	}
+
+	if (file.bad())
+		return false;
+
+	add(&fileSize, sizeof(fileSize));
+	add(&fileHash._value, sizeof(fileHash._value));
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getValue()
+//
+// Returns the hash of everything added so far.
+//////////////////////////////////////////////////////////////////////////////////
+uint64_t ContentHash::getValue() const
+{
+	return _value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// toString()
+//
+// Returns the hash as 16 hexadecimal digits, for use in filenames.
+//////////////////////////////////////////////////////////////////////////////////
+string ContentHash::toString() const
+{
+	ostringstream ss;
+	ss << hex << setw(16) << setfill('0') << _value;
+
+	return ss.str();
+}
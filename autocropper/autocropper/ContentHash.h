@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// ContentHash
+	//
+	// A 64-bit FNV-1a hash built up from strings, numbers and whole files. It is
+	// for telling inputs apart, not for security: it is fast and has no keys.
+	//////////////////////////////////////////////////////////////////////////////////
+	class ContentHash final
+	{
+	public:
+		ContentHash();
+
+		void add(const void* data, const size_t size);
+		void add(const std::string& value);
+		void add(const int value);
+		void add(const double value);
+		bool addFile(const std::string& filename);
+
+		uint64_t getValue() const;
+		std::string toString() const;
+	private:
+		static const uint64_t OFFSET_BASIS = 14695981039346656037ULL;
+		static const uint64_t PRIME = 1099511628211ULL;
+		static const size_t FILE_BUFFER_SIZE = 1 << 16;	// Files are hashed in chunks of this many bytes.
+
+		uint64_t _value;
+	};
+}
@@ -0,0 +1,621 @@
+#include "CropPipeline.h"
+#include "Accelerator.h"
+#include "DebugImageSink.h"
+#include "ExperimentalFunctions.h"
+#include "ForegroundAccumulator.h"
+#include "ImageReader.h"
+#include "OcvUtilities.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+using namespace cv;
+using namespace experimental;
+using namespace std;
+using namespace utility;
+using namespace OcvUtility;
+
+namespace autocropper
+{
+	const string DEFAULT_OUTPUT_DIRECTORY = "TestImages/CroppedImages/";
+
+	// In streaming mode, only this many frames are decoded ahead of the frame being processed.
+	const unsigned int STREAMING_IMAGES_IN_FLIGHT = 4;
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropRegionOptions()
+	//
+	// The parameters the crop region detection was originally tuned with.
+	//////////////////////////////////////////////////////////////////////////////////
+	CropRegionOptions::CropRegionOptions()
+		: verticalLineFraction(0.65),
+		horizontalLineFraction(0.9),
+		closingElementSize(11, 9),
+		workingScale(1.0),
+		refinementBand(2),
+		lineDetectionMethod(LineDetectionMethod::Morphology),
+		rootRowSearchFraction(0.1),
+		largestComponentMethod(LargestComponentMethod::ConnectedComponents),
+		backgroundModel(BackgroundModel::Mog2),
+		backgroundThreshold(25),
+		coarseFrameStride(1),
+		convergenceFraction(0.01)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeVerticalContainerBoundaries()
+	//
+	// Compute the region between the vertical edges of the container.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeVerticalContainerBoundaries(Mat originalImage, const CropRegionOptions& options)
+	{
+		Mat verticalContainerBoundaries = findLargestVerticalLines(originalImage, options.verticalLineFraction, options.lineDetectionMethod);
+		DEBUG_IMWRITE("TestImages/DEBUG/VerticalContainerLines.png", verticalContainerBoundaries);
+
+		// If the container is not centered perfectly in front of the camera (which is likely),
+		// then the vertical edges of the container will appear as thick lines in the background subtracted image.
+		Rect verticalContainerRegion = computeInnermostRectangle(verticalContainerBoundaries);
+
+		return verticalContainerRegion;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeHorizontalContainerBoundaries()
+	//
+	// Compute the region between the horizontal edges of the container.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeHorizontalContainerBoundaries(Mat verticalContainerImage, const CropRegionOptions& options)
+	{
+		Mat horizontalContainerBoundaries = findLargestHorizontalLines(verticalContainerImage, options.horizontalLineFraction, options.lineDetectionMethod);
+		DEBUG_IMWRITE("TestImages/DEBUG/HorizontalContainerLines.png", horizontalContainerBoundaries);
+		Rect horizontalContainerRegion = computeInnermostRectangle(horizontalContainerBoundaries);
+
+		return horizontalContainerRegion;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeGelRegion()
+	//
+	// Compute the region of the gel the root system grows in. Intermediate images
+	// are borrowed from the specified pool if there is one.
+	//TODO: Elaborate via comments how this is really the gel and not the container.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeGelRegion(Mat originalImage, const CropRegionOptions& options, MatPool* matPool)
+	{
+		if (options.workingScale < 1.0)
+			return computeGelRegionMultiResolution(originalImage, options, matPool);
+
+		Rect verticalContainerLines = computeVerticalContainerBoundaries(originalImage, options);
+		Mat verticalContainerImage = originalImage(verticalContainerLines);
+		DEBUG_IMWRITE("TestImages/DEBUG/VerticalContainerImage.png", verticalContainerImage);
+
+		auto elem = getStructuringElement(MORPH_RECT, options.closingElementSize);
+		MatPool::Lease tmpVerticalContainerLease = MatPool::acquire(matPool, verticalContainerImage.size(), verticalContainerImage.type());
+		Mat& tmpVerticalContainerImage = tmpVerticalContainerLease.get();
+		acceleratedMorphologyEx(verticalContainerImage, tmpVerticalContainerImage, MORPH_CLOSE, elem);
+
+		Rect horizontalContainerLines = computeHorizontalContainerBoundaries(tmpVerticalContainerImage, options);
+		Mat containerImage = verticalContainerImage(horizontalContainerLines);
+		DEBUG_IMWRITE("TestImages/DEBUG/ContainerImage.png", containerImage);
+
+		Rect gelRegionWRToriginal = Rect(verticalContainerLines.x + horizontalContainerLines.x, verticalContainerLines.y + horizontalContainerLines.y, horizontalContainerLines.width, horizontalContainerLines.height);
+
+		return gelRegionWRToriginal;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeGelRegionMultiResolution()
+	//
+	// Compute the region of the gel on a reduced copy of the image, where the long
+	// line openings are cheap, then refine each container edge at full resolution
+	// within a narrow band around where the reduced image put it. Intermediate
+	// images are borrowed from the specified pool if there is one.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeGelRegionMultiResolution(Mat originalImage, const CropRegionOptions& options, MatPool* matPool)
+	{
+		const double scale = options.workingScale;
+		const int band = static_cast<int>(ceil(options.refinementBand / scale));
+
+		// Only whether a pixel is zero matters to the line detection, so a reduced pixel is set
+		// wherever any of the pixels it covers is set.
+		MatPool::Lease nonZeroLease = MatPool::acquire(matPool, originalImage.size(), CV_8UC1);
+		compare(originalImage, 0, nonZeroLease.get(), CMP_GT);
+
+		const Size reducedSize = Size(saturate_cast<int>(originalImage.cols * scale), saturate_cast<int>(originalImage.rows * scale));	// As resize() computes it.
+		MatPool::Lease reducedLease = MatPool::acquire(matPool, reducedSize, CV_8UC1);
+		Mat& reducedImage = reducedLease.get();
+		resize(nonZeroLease.get(), reducedImage, Size(), scale, scale, INTER_AREA);
+		nonZeroLease.reset();
+		threshold(reducedImage, reducedImage, 0, 255, THRESH_BINARY);
+
+		CropRegionOptions reducedOptions = options;
+		reducedOptions.workingScale = 1.0;
+		reducedOptions.closingElementSize = Size(max(1, cvRound(options.closingElementSize.width * scale)), max(1, cvRound(options.closingElementSize.height * scale)));
+
+		Rect reducedVerticalContainerLines = computeVerticalContainerBoundaries(reducedImage, reducedOptions);
+		MatPool::Lease reducedVerticalContainerLease = MatPool::acquire(matPool, reducedVerticalContainerLines.size(), reducedImage.type());
+		Mat& reducedVerticalContainerImage = reducedVerticalContainerLease.get();
+		acceleratedMorphologyEx(reducedImage(reducedVerticalContainerLines), reducedVerticalContainerImage, MORPH_CLOSE, getStructuringElement(MORPH_RECT, reducedOptions.closingElementSize));
+		Rect reducedHorizontalContainerLines = computeHorizontalContainerBoundaries(reducedVerticalContainerImage, reducedOptions);
+
+		// Refine the estimates at full resolution.
+		Rect verticalContainerEstimate = scaleRect(reducedVerticalContainerLines, 1.0 / scale) & Rect(Point(0, 0), originalImage.size());
+		Rect verticalContainerLines = refineVerticalContainerBoundaries(originalImage, verticalContainerEstimate, band, options);
+		Mat verticalContainerImage = originalImage(verticalContainerLines);
+		DEBUG_IMWRITE("TestImages/DEBUG/VerticalContainerImage.png", verticalContainerImage);
+
+		// The reduced horizontal lines were found within the reduced vertical container, so move them from where it put the container to where the refinement did.
+		Rect horizontalContainerEstimate = (scaleRect(reducedHorizontalContainerLines, 1.0 / scale) + (verticalContainerEstimate.tl() - verticalContainerLines.tl())) & Rect(Point(0, 0), verticalContainerImage.size());
+		Rect horizontalContainerLines = refineHorizontalContainerBoundaries(verticalContainerImage, horizontalContainerEstimate, band, options);
+		DEBUG_IMWRITE("TestImages/DEBUG/ContainerImage.png", verticalContainerImage(horizontalContainerLines));
+
+		return Rect(verticalContainerLines.x + horizontalContainerLines.x, verticalContainerLines.y + horizontalContainerLines.y, horizontalContainerLines.width, horizontalContainerLines.height);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// refineVerticalContainerBoundaries()
+	//
+	// Compute the region between the vertical edges of the container at full
+	// resolution, as computeVerticalContainerBoundaries() would, but only look for
+	// the left and right edges within the specified band around the estimate.
+	// An edge that isn't found in its band keeps its estimated position.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect refineVerticalContainerBoundaries(Mat originalImage, Rect estimate, const int band, const CropRegionOptions& options)
+	{
+		const Point center = Point(originalImage.size().width / 2, originalImage.size().height / 2);
+		const Range rowProbe = computeProbeBand(originalImage.size().height);
+		const Range columnProbe = computeProbeBand(originalImage.size().width);
+		int u = 0, d = originalImage.size().height, l = estimate.x, r = estimate.x + estimate.width;
+
+		// Vertical lines are found column by column, so any subset of columns can be computed exactly on its own.
+		// The center columns are cheap, so the top and bottom are searched for exactly as computeInnermostRectangle() does.
+		ProjectionProfile centerColumnLines(findLargestVerticalLines(originalImage.colRange(columnProbe), options.verticalLineFraction, options.lineDetectionMethod));
+		const Range centerColumns = Range(0, columnProbe.size());
+
+		int y = centerColumnLines.findLastRow(Range(0, center.y + 1), centerColumns, computeProbeCoverage(columnProbe));
+		if (y >= 0)
+			u = y;
+
+		y = centerColumnLines.findFirstRow(Range(center.y, originalImage.size().height), centerColumns, computeProbeCoverage(columnProbe));
+		if (y < originalImage.size().height)
+			d = y;
+
+		// The left edge is the line crossing the center rows nearest the center.
+		Range leftBand = Range(max(0, l - band), min(center.x + 1, l + band + 1));
+		if (leftBand.start < leftBand.end)
+		{
+			// Only the center rows of the band are profiled, as only they are counted.
+			Mat leftLines = findLargestVerticalLines(originalImage.colRange(leftBand), options.verticalLineFraction, options.lineDetectionMethod);
+			ProjectionProfile leftProbe(leftLines.rowRange(rowProbe));
+			int x = leftProbe.findLastColumn(Range(0, leftBand.size()), Range(0, rowProbe.size()), computeProbeCoverage(rowProbe));
+			if (x >= 0)
+				l = leftBand.start + x;
+		}
+
+		Range rightBand = Range(max(center.x, r - band), min(originalImage.size().width, r + band + 1));
+		if (rightBand.start < rightBand.end)
+		{
+			Mat rightLines = findLargestVerticalLines(originalImage.colRange(rightBand), options.verticalLineFraction, options.lineDetectionMethod);
+			ProjectionProfile rightProbe(rightLines.rowRange(rowProbe));
+			int x = rightProbe.findFirstColumn(Range(0, rightBand.size()), Range(0, rowProbe.size()), computeProbeCoverage(rowProbe));
+			if (x < rightBand.size())
+				r = rightBand.start + x;
+		}
+
+		return Rect(l, u, r - l, d - u);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// refineHorizontalContainerBoundaries()
+	//
+	// Compute the region between the horizontal edges of the container at full
+	// resolution, as computeHorizontalContainerBoundaries() would on the closed
+	// vertical container image, but only look for the top and bottom edges within
+	// the specified band around the estimate. An edge that isn't found in its band
+	// keeps its estimated position.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect refineHorizontalContainerBoundaries(Mat verticalContainerImage, Rect estimate, const int band, const CropRegionOptions& options)
+	{
+		const Point center = Point(verticalContainerImage.size().width / 2, verticalContainerImage.size().height / 2);
+		const Range rowProbe = computeProbeBand(verticalContainerImage.size().height);
+		const Range columnProbe = computeProbeBand(verticalContainerImage.size().width);
+		int u = estimate.y, d = estimate.y + estimate.height, l = 0, r = verticalContainerImage.size().width;
+
+		// The center rows are cheap, so the left and right are searched for exactly as computeInnermostRectangle() does.
+		ProjectionProfile centerRowLines(computeHorizontalContainerLines(verticalContainerImage, rowProbe, options));
+		const Range centerRows = Range(0, rowProbe.size());
+
+		int x = centerRowLines.findLastColumn(Range(0, center.x + 1), centerRows, computeProbeCoverage(rowProbe));
+		if (x >= 0)
+			l = x;
+
+		x = centerRowLines.findFirstColumn(Range(center.x, verticalContainerImage.size().width), centerRows, computeProbeCoverage(rowProbe));
+		if (x < verticalContainerImage.size().width)
+			r = x;
+
+		// The top edge is the line crossing the center columns nearest the center.
+		Range topBand = Range(max(0, u - band), min(center.y + 1, u + band + 1));
+		if (topBand.start < topBand.end)
+		{
+			// Only the center columns of the band are profiled, as only they are counted.
+			Mat topLines = computeHorizontalContainerLines(verticalContainerImage, topBand, options);
+			ProjectionProfile topProbe(topLines.colRange(columnProbe));
+			int y = topProbe.findLastRow(Range(0, topBand.size()), Range(0, columnProbe.size()), computeProbeCoverage(columnProbe));
+			if (y >= 0)
+				u = topBand.start + y;
+		}
+
+		Range bottomBand = Range(max(center.y, d - band), min(verticalContainerImage.size().height, d + band + 1));
+		if (bottomBand.start < bottomBand.end)
+		{
+			Mat bottomLines = computeHorizontalContainerLines(verticalContainerImage, bottomBand, options);
+			ProjectionProfile bottomProbe(bottomLines.colRange(columnProbe));
+			int y = bottomProbe.findFirstRow(Range(0, bottomBand.size()), Range(0, columnProbe.size()), computeProbeCoverage(columnProbe));
+			if (y < bottomBand.size())
+				d = bottomBand.start + y;
+		}
+
+		return Rect(l, u, r - l, d - u);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeHorizontalContainerLines()
+	//
+	// Compute the horizontal container lines of the specified rows only. The result
+	// matches those rows of findLargestHorizontalLines() on the whole closed vertical
+	// container image.
+	//////////////////////////////////////////////////////////////////////////////////
+	Mat computeHorizontalContainerLines(Mat verticalContainerImage, Range rows, const CropRegionOptions& options)
+	{
+		// Horizontal lines are found row by row, but the closing before it needs a few rows either side to be exact.
+		const int halo = options.closingElementSize.height;
+		Range paddedRows = Range(max(0, rows.start - halo), min(verticalContainerImage.size().height, rows.end + halo));
+
+		Mat closedImage;
+		acceleratedMorphologyEx(verticalContainerImage.rowRange(paddedRows), closedImage, MORPH_CLOSE, getStructuringElement(MORPH_RECT, options.closingElementSize));
+
+		return findLargestHorizontalLines(closedImage.rowRange(rows.start - paddedRows.start, rows.end - paddedRows.start), options.horizontalLineFraction, options.lineDetectionMethod);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeCropRegion()
+	//
+	// Compute the region of the root system from the or of the foreground images.
+	// Note that the specified image is modified. Intermediate images are borrowed
+	// from the specified pool if there is one, and each stage is timed by the
+	// specified profiler if there is one. The gel region the root system was found
+	// in is returned through gelRegionOut if it isn't null.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeCropRegion(Mat img, const CropRegionOptions& options, MatPool* matPool, StageProfiler* profiler, Rect* gelRegionOut)
+	{
+		// Draw original image.
+		Mat orig;
+		if (DEBUG_IMAGES_ENABLED())
+			orig = img.clone();
+		DEBUG_IMWRITE("TestImages/1foregroundORImage.png", orig);
+
+		// Compute image cropped to the gel boundary.
+		Rect gelRegion;
+		{
+			StageProfiler::ScopedStage stage(profiler, "computeGelRegion");
+			gelRegion = computeGelRegion(img, options, matPool);
+		}
+		DEBUG_IMWRITE("TestImages/2highlightedGel.png", drawRedRectOnImage(orig, gelRegion, 3));
+		if (gelRegionOut != nullptr)
+			*gelRegionOut = gelRegion;
+		Mat containerImage = img(gelRegion);
+
+		// Find the root system within the gel.
+		{
+			StageProfiler::ScopedStage stage(profiler, "keepOnlyLargestComponent");
+			keepOnlyLargestComponent(containerImage, options.largestComponentMethod, matPool);
+		}
+		Mat rootSystem = containerImage;
+		DEBUG_IMWRITE("TestImages/DEBUG/PossibleRootSystem.png", containerImage);
+
+		Rect rootRectangle;
+		{
+			StageProfiler::ScopedStage stage(profiler, "computeMaximumRootExtents");
+			const ProjectionProfile rootProfile(containerImage);
+			int rowPositionWithMaximumBlackPixels = computeRowWithMaximumBlackPixels(rootProfile, options.rootRowSearchFraction);
+			rootRectangle = computeMaximumRootExtents(rootProfile, rowPositionWithMaximumBlackPixels);
+		}
+		Rect rootRectangleWRToriginal = Rect(rootRectangle.x + gelRegion.x, rootRectangle.y + gelRegion.y, rootRectangle.width, rootRectangle.height);
+		Mat rootImage = containerImage(rootRectangle);
+		DEBUG_IMWRITE("TestImages/DEBUG/AA_FINALTEST_ROOT.png", rootImage);
+		DEBUG_IMWRITE("TestImages/3highlightedRoots.png", drawRedRectOnImage(orig, rootRectangleWRToriginal, 3));
+
+		return rootRectangleWRToriginal;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeForegroundUnion()
+	//
+	// Compute the or of the foreground images of the series in a single pass. This
+	// gives the same image as or(computeForegroundImages(originalImages)) without
+	// building a foreground image per frame.
+	//////////////////////////////////////////////////////////////////////////////////
+	Mat computeForegroundUnion(const vector<Mat>& originalImages)
+	{
+		ForegroundAccumulator foregroundAccumulator;
+
+		for (const auto& image : originalImages)
+		{
+			foregroundAccumulator.add(image);
+		}
+
+		return foregroundAccumulator.getForegroundUnion();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeCoarseToFineFrameOrder()
+	//
+	// Returns the passes to feed the frames of a series to the background model
+	// in: every coarseFrameStride'th frame and the last one, where the root system
+	// is largest, then the frames between at half the stride, down to a stride of
+	// one. Each frame is in exactly one pass, in frame order within it.
+	//////////////////////////////////////////////////////////////////////////////////
+	vector<vector<size_t>> computeCoarseToFineFrameOrder(const size_t numberOfFrames, const int coarseFrameStride)
+	{
+		vector<vector<size_t>> frameOrder;
+		vector<bool> isOrdered(numberOfFrames, false);
+
+		for (size_t stride = max(coarseFrameStride, 1); stride > 0; stride /= 2)
+		{
+			vector<size_t> pass;
+
+			for (size_t frame = 0; frame < numberOfFrames; ++frame)
+			{
+				if (!isOrdered[frame] && (frame % stride == 0 || (frameOrder.empty() && frame == numberOfFrames - 1)))
+				{
+					pass.push_back(frame);
+					isOrdered[frame] = true;
+				}
+			}
+
+			if (!pass.empty())
+				frameOrder.push_back(pass);
+		}
+
+		return frameOrder;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// accumulateUntilConverged()
+	//
+	// Hand the passes of frameOrder to addFrames, which adds those frames to the
+	// accumulator, until a pass changes the root region found in the foreground
+	// union by no more than the convergence fraction of the two regions' bounding
+	// box. The root region is found after every pass but the last on a copy of the
+	// union, whose buffer is borrowed from the specified pool if there is one. That
+	// is cheap next to the background subtraction of a pass, and unlike the
+	// bounding box of the whole union, which the container edges fill after the
+	// first pass, it follows the roots as they grow. It is still a heuristic: roots
+	// that grow only in the frames skipped are missed. A coarse frame stride of 1
+	// uses every frame.
+	//////////////////////////////////////////////////////////////////////////////////
+	void accumulateUntilConverged(ForegroundAccumulator& foregroundAccumulator, const vector<vector<size_t>>& frameOrder, const CropRegionOptions& options, const function<void(const vector<size_t>&)>& addFrames, MatPool* matPool)
+	{
+		Rect previousRootRegion;
+
+		for (size_t pass = 0; pass < frameOrder.size(); ++pass)
+		{
+			addFrames(frameOrder[pass]);
+
+			if (pass + 1 == frameOrder.size() || foregroundAccumulator.getNumberOfFramesProcessed() < 2)
+				continue;
+
+			const Mat& foregroundUnion = foregroundAccumulator.getForegroundUnion();
+			MatPool::Lease unionCopy = MatPool::acquire(matPool, foregroundUnion.size(), foregroundUnion.type());
+			foregroundUnion.copyTo(unionCopy.get());	// computeCropRegion() modifies the union.
+			const Rect rootRegion = computeCropRegion(unionCopy.get(), options, matPool);
+
+			const Rect bothRegions = rootRegion | previousRootRegion;
+			const int changedArea = bothRegions.area() - (rootRegion & previousRootRegion).area();
+			if (previousRootRegion.area() > 0 && rootRegion.area() > 0 && changedArea <= options.convergenceFraction * bothRegions.area())
+				break;
+
+			previousRootRegion = rootRegion;
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// accumulateSeriesForegroundUnion()
+	//
+	// Compute the foreground union of the original images of a series into the
+	// specified image, as computeSeriesCropRegion() finds it, without finding the
+	// crop region. If the image is already the right size and type its buffer is
+	// reused. Intermediate images are borrowed from the specified pool if there is
+	// one, and the stage is timed by the specified profiler if there is one. With
+	// a static background model the series is read twice, once for its background
+	// and once for the union. With a coarse frame stride, frames stop being added
+	// once the root region converges, and the number of frames used is returned
+	// through framesUsedOut if it isn't null.
+	//////////////////////////////////////////////////////////////////////////////////
+	void accumulateSeriesForegroundUnion(const vector<Mat>& originalImages, const CropRegionOptions& options, Mat& foregroundUnion, MatPool* matPool, StageProfiler* profiler, int* framesUsedOut)
+	{
+		if (originalImages.size() < 2)
+			throw runtime_error("At least two images are needed to separate the foreground from the background.");
+
+		StageProfiler::ScopedStage stage(profiler, "computeForegroundUnion");
+
+		if (options.backgroundModel != BackgroundModel::Mog2)
+		{
+			StaticBackground::computeForegroundUnion(originalImages, options.backgroundModel, options.backgroundThreshold, foregroundUnion);
+			stage.addFrames(static_cast<long long>(originalImages.size()));
+
+			if (framesUsedOut != nullptr)
+				*framesUsedOut = static_cast<int>(originalImages.size());
+
+			return;
+		}
+
+		ForegroundAccumulator foregroundAccumulator(matPool);
+
+		accumulateUntilConverged(foregroundAccumulator, computeCoarseToFineFrameOrder(originalImages.size(), options.coarseFrameStride), options, [&foregroundAccumulator, &originalImages](const vector<size_t>& frames)
+		{
+			for (const auto frame : frames)
+			{
+				foregroundAccumulator.add(originalImages[frame]);
+			}
+		}, matPool);
+
+		stage.addFrames(foregroundAccumulator.getNumberOfFramesProcessed());
+		foregroundAccumulator.getForegroundUnion().copyTo(foregroundUnion);
+
+		if (framesUsedOut != nullptr)
+			*framesUsedOut = foregroundAccumulator.getNumberOfFramesProcessed();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeSeriesCropRegion()
+	//
+	// Compute the region of the root system from the original images of a series.
+	// Intermediate images are borrowed from the specified pool if there is one, and
+	// each stage is timed by the specified profiler if there is one. The gel region
+	// is returned through gelRegionOut, and a copy of the foreground union through
+	// foregroundUnionOut, if they aren't null. The union is found as
+	// accumulateSeriesForegroundUnion() finds it, and the number of frames used is
+	// returned through framesUsedOut if it isn't null.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeSeriesCropRegion(const vector<Mat>& originalImages, const CropRegionOptions& options, MatPool* matPool, StageProfiler* profiler, Rect* gelRegionOut, Mat* foregroundUnionOut, int* framesUsedOut)
+	{
+		if (originalImages.empty())
+			throw runtime_error("At least two images are needed to separate the foreground from the background.");
+
+		MatPool::Lease foregroundUnion = MatPool::acquire(matPool, originalImages[0].size(), CV_8UC1);
+		accumulateSeriesForegroundUnion(originalImages, options, foregroundUnion.get(), matPool, profiler, framesUsedOut);
+
+		if (foregroundUnionOut != nullptr)
+			*foregroundUnionOut = foregroundUnion.get().clone();	// computeCropRegion() modifies the union.
+
+		return computeCropRegion(foregroundUnion.get(), options, matPool, profiler, gelRegionOut);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// cropOriginalImages()
+	//
+	// Write the specified region of every original image to the output directory,
+	// encoding them in parallel on a thread pool of their own.
+	//////////////////////////////////////////////////////////////////////////////////
+	void cropOriginalImages(const vector<Mat>& originalImages, Rect cropRegion, const string& outputDirectory, const CropOutputOptions& outputOptions, StageProfiler* profiler)
+	{
+		ThreadPool encoderThreadPool;
+
+		cropOriginalImages(originalImages, cropRegion, outputDirectory, outputOptions, encoderThreadPool, profiler);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// cropOriginalImages()
+	//
+	// Write the specified region of every original image to the output directory,
+	// encoding them in parallel on the specified thread pool. Returns once every
+	// image is written.
+	//////////////////////////////////////////////////////////////////////////////////
+	void cropOriginalImages(const vector<Mat>& originalImages, Rect cropRegion, const string& outputDirectory, const CropOutputOptions& outputOptions, ThreadPool& threadPool, StageProfiler* profiler)
+	{
+		StageProfiler::ScopedStage stage(profiler, "cropOriginalImages");
+		stage.addFrames(static_cast<long long>(originalImages.size()));
+
+		CropWriter cropWriter(outputDirectory, outputOptions, threadPool);
+		int i = 1;
+
+		for (const auto& image : originalImages)
+		{
+			cropWriter.write(image(cropRegion), i++);
+		}
+
+		cropWriter.finish();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeCropRegionStreaming()
+	//
+	// Compute the region of the root system of the specified frames, such as a
+	// SeriesIndex found, without keeping the series in memory. Frames are decoded,
+	// background subtracted and ored into a running image one at a time, and only
+	// the crop region is kept. Intermediate images are borrowed from the
+	// specified pool if there is one. Reading and background subtraction
+	// overlap, so the profiler times them as one stage. The gel region is returned
+	// through gelRegionOut, and a copy of the foreground union through
+	// foregroundUnionOut, if they aren't null. With a coarse frame stride, frames
+	// after the union converges aren't even decoded, and the number of frames used
+	// is returned through framesUsedOut if it isn't null.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeCropRegionStreaming(const vector<string>& filenames, ThreadPool& threadPool, const CropRegionOptions& options, MatPool* matPool, StageProfiler* profiler, Rect* gelRegionOut, Mat* foregroundUnionOut, int* framesUsedOut)
+	{
+		if (options.backgroundModel != BackgroundModel::Mog2)
+			throw invalid_argument("A static background needs the whole series; only the MOG2 background model can be streamed.");
+
+		ForegroundAccumulator foregroundAccumulator(matPool);
+
+		{
+			StageProfiler::ScopedStage stage(profiler, "streamForegroundUnion");
+
+			accumulateUntilConverged(foregroundAccumulator, computeCoarseToFineFrameOrder(filenames.size(), options.coarseFrameStride), options, [&](const vector<size_t>& frames)
+			{
+				vector<string> passFilenames;
+				for (const auto frame : frames)
+				{
+					passFilenames.push_back(filenames[frame]);
+				}
+
+				ImageReader::streamImages(passFilenames, threadPool, [&foregroundAccumulator, &stage](size_t, const Mat& image) { stage.addImage(image); foregroundAccumulator.add(image); }, STREAMING_IMAGES_IN_FLIGHT);
+			}, matPool);
+		}
+
+		if (framesUsedOut != nullptr)
+			*framesUsedOut = foregroundAccumulator.getNumberOfFramesProcessed();
+
+		if (foregroundAccumulator.getNumberOfFramesProcessed() < 2)
+			throw runtime_error("At least two images are needed to separate the foreground from the background.");
+
+		if (foregroundUnionOut != nullptr)
+			*foregroundUnionOut = foregroundAccumulator.getForegroundUnion().clone();	// computeCropRegion() modifies the union.
+
+		return computeCropRegion(foregroundAccumulator.getForegroundUnion(), options, matPool, profiler, gelRegionOut);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// cropOriginalImagesStreaming()
+	//
+	// Re-read the specified frames one at a time and write the specified region of
+	// each to the output directory, numbered by position as cropOriginalImages()
+	// numbers them. The same thread pool decodes frames ahead and encodes crops
+	// behind the frame being cropped.
+	//////////////////////////////////////////////////////////////////////////////////
+	void cropOriginalImagesStreaming(const vector<string>& filenames, ThreadPool& threadPool, Rect cropRegion, const string& outputDirectory, const CropOutputOptions& outputOptions, StageProfiler* profiler)
+	{
+		StageProfiler::ScopedStage stage(profiler, "cropOriginalImagesStreaming");
+
+		CropWriter cropWriter(outputDirectory, outputOptions, threadPool);
+		int i = 1;
+
+		ImageReader::streamImages(filenames, threadPool, [&i, &stage, &cropWriter, cropRegion](size_t, const Mat& image) { stage.addImage(image); cropWriter.write(image(cropRegion), i++); }, STREAMING_IMAGES_IN_FLIGHT);
+
+		cropWriter.finish();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// cropOriginalFrames()
+	//
+	// Read the specified frames one at a time and write the specified region of
+	// each to the output directory, named by its image number rather than its
+	// position, so that a subset of a series can be cropped again on its own.
+	//////////////////////////////////////////////////////////////////////////////////
+	void cropOriginalFrames(const vector<string>& filenames, ThreadPool& threadPool, Rect cropRegion, const string& outputDirectory, const CropOutputOptions& outputOptions, StageProfiler* profiler)
+	{
+		StageProfiler::ScopedStage stage(profiler, "cropOriginalFrames");
+
+		CropWriter cropWriter(outputDirectory, outputOptions, threadPool);
+
+		ImageReader::streamImages(filenames, threadPool, [&stage, &cropWriter, &filenames, cropRegion](size_t imageIndex, const Mat& image) { stage.addImage(image); cropWriter.write(image(cropRegion), ImageReader::getImageNumber(filenames[imageIndex])); }, STREAMING_IMAGES_IN_FLIGHT);
+
+		cropWriter.finish();
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "CropWriter.h"
+#include "ExperimentalFunctions.h"
+#include "ForegroundAccumulator.h"
+#include "MatPool.h"
+#include "OcvUtilities.h"
+#include "StageProfiler.h"
+#include "StaticBackground.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////////
+// CropPipeline
+//
+// The stages that take a series of images of a plant to the region its root
+// system occupies, and crop the series to that region.
+//////////////////////////////////////////////////////////////////////////////////
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropRegionOptions
+	//
+	// Parameters of the crop region detection. The defaults reproduce the original
+	// full resolution detection.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct CropRegionOptions
+	{
+		CropRegionOptions();
+
+		double verticalLineFraction;	// The vertical container edges span at least this fraction of the image height.
+		double horizontalLineFraction;	// The horizontal container edges span at least this fraction of the container width.
+		cv::Size closingElementSize;	// Closes gaps in the container image before its horizontal edges are found.
+		double workingScale;			// The container is found at this scale, then refined at full resolution. 1 finds it at full resolution.
+		int refinementBand;				// How far, in working resolution pixels, each container edge is searched for at full resolution.
+		experimental::LineDetectionMethod lineDetectionMethod;	// How the long container edges are found. Both methods find the same lines.
+		double rootRowSearchFraction;	// The top of the root system is searched for in this fraction of the gel, from the top.
+		OcvUtility::LargestComponentMethod largestComponentMethod;	// How the root system is picked out of the foreground in the gel.
+		BackgroundModel backgroundModel;	// How the foreground is separated from the background. Only MOG2 can be streamed.
+		int backgroundThreshold;			// With a static background model, pixels differing from it by more grey levels than this are foreground.
+		int coarseFrameStride;				// MOG2 sees every this many frames first, then the frames between, halving the stride. 1 takes the frames in order.
+		double convergenceFraction;			// Frames between stop being added once a pass changes the root region by no more than this fraction of its area.
+	};
+
+	cv::Rect computeVerticalContainerBoundaries(cv::Mat originalImage, const CropRegionOptions& options = CropRegionOptions());
+	cv::Rect computeHorizontalContainerBoundaries(cv::Mat verticalContainerImage, const CropRegionOptions& options = CropRegionOptions());
+	cv::Rect computeGelRegion(cv::Mat originalImage, const CropRegionOptions& options = CropRegionOptions(), utility::MatPool* matPool = nullptr);
+	cv::Rect computeGelRegionMultiResolution(cv::Mat originalImage, const CropRegionOptions& options, utility::MatPool* matPool = nullptr);
+	cv::Rect refineVerticalContainerBoundaries(cv::Mat originalImage, cv::Rect estimate, const int band, const CropRegionOptions& options);
+	cv::Rect refineHorizontalContainerBoundaries(cv::Mat verticalContainerImage, cv::Rect estimate, const int band, const CropRegionOptions& options);
+	cv::Mat computeHorizontalContainerLines(cv::Mat verticalContainerImage, cv::Range rows, const CropRegionOptions& options);
+	cv::Rect computeCropRegion(cv::Mat img, const CropRegionOptions& options = CropRegionOptions(), utility::MatPool* matPool = nullptr, utility::StageProfiler* profiler = nullptr, cv::Rect* gelRegionOut = nullptr);
+	cv::Mat computeForegroundUnion(const std::vector<cv::Mat>& originalImages);
+	std::vector<std::vector<size_t>> computeCoarseToFineFrameOrder(const size_t numberOfFrames, const int coarseFrameStride);
+	void accumulateUntilConverged(ForegroundAccumulator& foregroundAccumulator, const std::vector<std::vector<size_t>>& frameOrder, const CropRegionOptions& options, const std::function<void(const std::vector<size_t>&)>& addFrames, utility::MatPool* matPool = nullptr);
+	void accumulateSeriesForegroundUnion(const std::vector<cv::Mat>& originalImages, const CropRegionOptions& options, cv::Mat& foregroundUnion, utility::MatPool* matPool = nullptr, utility::StageProfiler* profiler = nullptr, int* framesUsedOut = nullptr);
+	cv::Rect computeSeriesCropRegion(const std::vector<cv::Mat>& originalImages, const CropRegionOptions& options = CropRegionOptions(), utility::MatPool* matPool = nullptr, utility::StageProfiler* profiler = nullptr, cv::Rect* gelRegionOut = nullptr, cv::Mat* foregroundUnionOut = nullptr, int* framesUsedOut = nullptr);
+
+	void cropOriginalImages(const std::vector<cv::Mat>& originalImages, cv::Rect cropRegion, const std::string& outputDirectory, const CropOutputOptions& outputOptions = CropOutputOptions(), utility::StageProfiler* profiler = nullptr);
+	void cropOriginalImages(const std::vector<cv::Mat>& originalImages, cv::Rect cropRegion, const std::string& outputDirectory, const CropOutputOptions& outputOptions, utility::ThreadPool& threadPool, utility::StageProfiler* profiler = nullptr);
+
+	cv::Rect computeCropRegionStreaming(const std::vector<std::string>& filenames, utility::ThreadPool& threadPool, const CropRegionOptions& options = CropRegionOptions(), utility::MatPool* matPool = nullptr, utility::StageProfiler* profiler = nullptr, cv::Rect* gelRegionOut = nullptr, cv::Mat* foregroundUnionOut = nullptr, int* framesUsedOut = nullptr);
+	void cropOriginalImagesStreaming(const std::vector<std::string>& filenames, utility::ThreadPool& threadPool, cv::Rect cropRegion, const std::string& outputDirectory, const CropOutputOptions& outputOptions = CropOutputOptions(), utility::StageProfiler* profiler = nullptr);
+
+	void cropOriginalFrames(const std::vector<std::string>& filenames, utility::ThreadPool& threadPool, cv::Rect cropRegion, const std::string& outputDirectory, const CropOutputOptions& outputOptions = CropOutputOptions(), utility::StageProfiler* profiler = nullptr);
+
+	extern const std::string DEFAULT_OUTPUT_DIRECTORY;
+	extern const unsigned int STREAMING_IMAGES_IN_FLIGHT;
+}
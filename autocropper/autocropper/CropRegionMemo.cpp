@@ -0,0 +1,97 @@
+#include "CropRegionMemo.h"
+#include "Accelerator.h"
+#include "ExperimentalFunctions.h"
+#include "OcvUtilities.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+using namespace autocropper;
+using namespace cv;
+using namespace experimental;
+using namespace std;
+using namespace utility;
+using namespace OcvUtility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// CropRegionMemo()
+//
+// Create a memo of the specified foreground union, which isn't modified. A
+// stage that holds the specified number of values forgets them once it is full,
+// so a long tuning session doesn't keep every closed container it has seen.
+//////////////////////////////////////////////////////////////////////////////////
+CropRegionMemo::CropRegionMemo(const Mat& foregroundUnion, const size_t maximumValuesPerStage)
+	: _foregroundUnion(foregroundUnion),
+	_verticalRegions(maximumValuesPerStage),
+	_closedVerticalContainers(maximumValuesPerStage),
+	_gelRegions(maximumValuesPerStage),
+	_rootSystems(maximumValuesPerStage)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeGelRegion()
+//
+// Returns the gel region computeGelRegion() finds in the union with the
+// specified options.
+//////////////////////////////////////////////////////////////////////////////////
+Rect CropRegionMemo::computeGelRegion(const CropRegionOptions& options)
+{
+	const Size closing = options.closingElementSize;
+
+	return _gelRegions.get(make_tuple(options.verticalLineFraction, closing.width, closing.height, options.horizontalLineFraction), [&]() -> Rect
+	{
+		if (options.workingScale < 1.0)
+			return autocropper::computeGelRegion(_foregroundUnion, options);	// The reduced image depends on every parameter at once.
+
+		const Rect verticalRegion = _verticalRegions.get(options.verticalLineFraction, [&]() -> Rect
+		{
+			return computeVerticalContainerBoundaries(_foregroundUnion, options);
+		});
+
+		const Mat closedVerticalContainer = _closedVerticalContainers.get(make_tuple(options.verticalLineFraction, closing.width, closing.height), [&]() -> Mat
+		{
+			Mat closedImage;
+			acceleratedMorphologyEx(_foregroundUnion(verticalRegion), closedImage, MORPH_CLOSE, getStructuringElement(MORPH_RECT, closing));
+			return closedImage;
+		});
+
+		const Rect horizontalRegion = computeHorizontalContainerBoundaries(closedVerticalContainer, options);
+
+		return Rect(verticalRegion.x + horizontalRegion.x, verticalRegion.y + horizontalRegion.y, horizontalRegion.width, horizontalRegion.height);
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeCropRegion()
+//
+// Returns the crop region computeCropRegion() finds in the union with the
+// specified options. The gel region is returned through gelRegionOut if it
+// isn't null.
+//////////////////////////////////////////////////////////////////////////////////
+Rect CropRegionMemo::computeCropRegion(const CropRegionOptions& options, Rect* gelRegionOut)
+{
+	const Rect gelRegion = computeGelRegion(options);
+	if (gelRegionOut != nullptr)
+		*gelRegionOut = gelRegion;
+
+	const ProjectionProfile rootSystem = _rootSystems.get(make_tuple(gelRegion.x, gelRegion.y, gelRegion.width, gelRegion.height), [&]() -> ProjectionProfile
+	{
+		Mat containerImage = _foregroundUnion(gelRegion).clone();
+		keepOnlyLargestComponent(containerImage, options.largestComponentMethod);
+		return ProjectionProfile(containerImage);
+	});
+
+	const Rect rootRegion = computeMaximumRootExtents(rootSystem, computeRowWithMaximumBlackPixels(rootSystem, options.rootRowSearchFraction));
+
+	return Rect(rootRegion.x + gelRegion.x, rootRegion.y + gelRegion.y, rootRegion.width, rootRegion.height);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getForegroundUnion()
+//
+// Returns the foreground union the regions are found in.
+//////////////////////////////////////////////////////////////////////////////////
+const Mat& CropRegionMemo::getForegroundUnion() const
+{
+	return _foregroundUnion;
+}
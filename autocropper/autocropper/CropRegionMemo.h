@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ProjectionProfile.h"
+#include "CropPipeline.h"
+#include "SharedMemo.h"
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <tuple>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropRegionMemo
+	//
+	// Find the crop region of one foreground union with many sets of options. The
+	// union is computed once by the caller, and every later stage is memoized on
+	// just the parameters it depends on: the vertical edges on the vertical
+	// fraction, the closed container on that and the closing element, the gel on
+	// those and the horizontal fraction, and the root system on the gel region.
+	// Options that find the same gel therefore share all of its work. Only those
+	// four parameters and the root search fraction may differ between calls. The
+	// memo may be shared between threads.
+	//////////////////////////////////////////////////////////////////////////////////
+	class CropRegionMemo final
+	{
+	public:
+		explicit CropRegionMemo(const cv::Mat& foregroundUnion, const size_t maximumValuesPerStage = 0);
+
+		cv::Rect computeGelRegion(const CropRegionOptions& options);
+		cv::Rect computeCropRegion(const CropRegionOptions& options, cv::Rect* gelRegionOut = nullptr);
+		const cv::Mat& getForegroundUnion() const;
+	private:
+		CropRegionMemo(const CropRegionMemo&) = delete;
+		CropRegionMemo& operator=(const CropRegionMemo&) = delete;
+
+		typedef std::tuple<double, int, int> ClosingKey;			// Vertical fraction and closing element size.
+		typedef std::tuple<double, int, int, double> GelKey;		// Vertical fraction, closing element size and horizontal fraction.
+		typedef std::tuple<int, int, int, int> RegionKey;
+
+		cv::Mat _foregroundUnion;
+		utility::SharedMemo<double, cv::Rect> _verticalRegions;
+		utility::SharedMemo<ClosingKey, cv::Mat> _closedVerticalContainers;
+		utility::SharedMemo<GelKey, cv::Rect> _gelRegions;
+		utility::SharedMemo<RegionKey, OcvUtility::ProjectionProfile> _rootSystems;	// Only their row profiles, as only their rows are searched from then on.
+	};
+}
@@ -0,0 +1,175 @@
+#include "CropResultCache.h"
+#include "Accelerator.h"
+#include "ContentHash.h"
+#include "FileUtilities.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// CropResultCache()
+//
+// Use the specified directory for the cache, creating it if needed. The
+// foreground union of each series is only stored if asked for, as it is far
+// larger than the regions.
+//////////////////////////////////////////////////////////////////////////////////
+CropResultCache::CropResultCache(const string& cacheDirectory, const bool storeForegroundUnion)
+	: _cacheDirectory(cacheDirectory),
+	_storeForegroundUnion(storeForegroundUnion)
+{
+	if (!FileUtilities::createDirectories(_cacheDirectory))
+		throw runtime_error("Unable to create cache directory: " + _cacheDirectory);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeKey()
+//
+// Returns the key of the specified frames cropped with the specified options.
+// The frames are hashed by content, not name or time, so a copied or touched
+// series still hits. Throws if a frame can't be read.
+//////////////////////////////////////////////////////////////////////////////////
+string CropResultCache::computeKey(const vector<string>& sourceFilenames, const CropRegionOptions& options, StageProfiler* profiler)
+{
+	StageProfiler::ScopedStage stage(profiler, "computeCacheKey");
+	stage.addFrames(static_cast<long long>(sourceFilenames.size()));
+
+	ContentHash hash;
+
+	hash.add(CACHE_VERSION);
+	hash.add(options.verticalLineFraction);
+	hash.add(options.horizontalLineFraction);
+	hash.add(options.closingElementSize.width);
+	hash.add(options.closingElementSize.height);
+	hash.add(options.workingScale);
+	hash.add(options.refinementBand);
+	hash.add(static_cast<int>(options.lineDetectionMethod));
+	hash.add(options.rootRowSearchFraction);
+	hash.add(static_cast<int>(options.largestComponentMethod));
+	hash.add(static_cast<int>(options.backgroundModel));
+	hash.add(options.backgroundThreshold);
+	hash.add(options.coarseFrameStride);
+	hash.add(options.convergenceFraction);
+	hash.add(OcvUtility::Accelerator::isEnabled() ? 1 : 0);	// Background subtraction on the device can mark marginally different pixels.
+	hash.add(static_cast<int>(sourceFilenames.size()));
+
+	for (const auto& filename : sourceFilenames)
+	{
+		if (!hash.addFile(filename))
+			throw runtime_error("Unable to read source image: " + filename);
+	}
+
+	return hash.toString();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// lookup()
+//
+// Read the regions of the entry with the specified key into the specified
+// sidecar, and its foreground union too if one is asked for and was stored. The
+// rest of the sidecar is left alone, as the cached series may have been read
+// from elsewhere. Returns false if there is no entry, or if a foreground union
+// was asked for and there is none.
+//////////////////////////////////////////////////////////////////////////////////
+bool CropResultCache::lookup(const string& key, CropSidecar& sidecar, Mat* foregroundUnion) const
+{
+	const string sidecarFilename = getSidecarFilename(key);
+
+	if (!FileUtilities::fileExists(sidecarFilename))
+		return false;
+
+	if (foregroundUnion != nullptr)
+	{
+		*foregroundUnion = imread(getForegroundUnionFilename(key), IMREAD_GRAYSCALE);
+
+		if (foregroundUnion->empty())
+			return false;
+	}
+
+	const CropSidecar cachedSidecar = CropSidecar::read(sidecarFilename);
+	sidecar.gelRegion = cachedSidecar.gelRegion;
+	sidecar.cropRegion = cachedSidecar.cropRegion;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// store()
+//
+// Write the specified sidecar, and the foreground union if the cache stores
+// them, as the entry with the specified key. Each file is written under a name
+// of its own to the writing thread and moved into place, and the sidecar last,
+// so a reader never sees an entry that is only half written, however many
+// threads and processes store the same entry at once. Throws if the entry can't
+// be written.
+//////////////////////////////////////////////////////////////////////////////////
+void CropResultCache::store(const string& key, const CropSidecar& sidecar, const Mat& foregroundUnion) const
+{
+	if (_storeForegroundUnion && !foregroundUnion.empty())
+	{
+		const string foregroundUnionFilename = getForegroundUnionFilename(key);
+		const string temporaryFilename = FileUtilities::buildTemporaryFilename(foregroundUnionFilename);
+
+		if (!imwrite(temporaryFilename, foregroundUnion))
+		{
+			remove(temporaryFilename.c_str());
+			throw runtime_error("Unable to write cached foreground union: " + foregroundUnionFilename);
+		}
+
+		moveIntoPlace(temporaryFilename, foregroundUnionFilename);
+	}
+
+	const string sidecarFilename = getSidecarFilename(key);
+	const string temporaryFilename = FileUtilities::buildTemporaryFilename(sidecarFilename);
+
+	sidecar.write(temporaryFilename);
+	moveIntoPlace(temporaryFilename, sidecarFilename);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isStoringForegroundUnion()
+//
+// Returns true if entries include the foreground union.
+//////////////////////////////////////////////////////////////////////////////////
+bool CropResultCache::isStoringForegroundUnion() const
+{
+	return _storeForegroundUnion;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// moveIntoPlace()
+//
+// Rename the specified complete file to the specified name of an entry. The
+// rename fails if another run stored the same entry first. Its file is just as
+// good, as the key is of the content, so ours is removed.
+//////////////////////////////////////////////////////////////////////////////////
+void CropResultCache::moveIntoPlace(const string& temporaryFilename, const string& filename)
+{
+	if (rename(temporaryFilename.c_str(), filename.c_str()) != 0)
+		remove(temporaryFilename.c_str());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSidecarFilename()
+//
+// Returns [Cache Directory]/[Key].yml
+//////////////////////////////////////////////////////////////////////////////////
+string CropResultCache::getSidecarFilename(const string& key) const
+{
+	return FileUtilities::joinPath(_cacheDirectory, key + ".yml");
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getForegroundUnionFilename()
+//
+// Returns [Cache Directory]/[Key].png
+//////////////////////////////////////////////////////////////////////////////////
+string CropResultCache::getForegroundUnionFilename(const string& key) const
+{
+	return FileUtilities::joinPath(_cacheDirectory, key + ".png");
+}
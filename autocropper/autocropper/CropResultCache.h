@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CropPipeline.h"
+#include "CropSidecar.h"
+#include "StageProfiler.h"
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropResultCache
+	//
+	// Crop regions found on earlier runs, keyed by a hash of the bytes of the
+	// source frames and of every parameter that affects the crop region, so that
+	// a series seen before skips straight to writing its output. Each entry is a
+	// CropSidecar, optionally with the foreground union the regions were found in.
+	// The cache may be shared between threads and processes.
+	//////////////////////////////////////////////////////////////////////////////////
+	class CropResultCache final
+	{
+	public:
+		CropResultCache(const std::string& cacheDirectory, const bool storeForegroundUnion = false);
+
+		static std::string computeKey(const std::vector<std::string>& sourceFilenames, const CropRegionOptions& options, utility::StageProfiler* profiler = nullptr);
+		bool lookup(const std::string& key, CropSidecar& sidecar, cv::Mat* foregroundUnion = nullptr) const;
+		void store(const std::string& key, const CropSidecar& sidecar, const cv::Mat& foregroundUnion = cv::Mat()) const;
+		bool isStoringForegroundUnion() const;
+	private:
+		std::string getSidecarFilename(const std::string& key) const;
+		std::string getForegroundUnionFilename(const std::string& key) const;
+		static void moveIntoPlace(const std::string& temporaryFilename, const std::string& filename);
+
+		static const int CACHE_VERSION = 2;	// Bump whenever the crop region detection changes, so old entries are ignored.
+
+		std::string _cacheDirectory;
+		bool _storeForegroundUnion;
+	};
+}
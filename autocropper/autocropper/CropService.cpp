@@ -0,0 +1,207 @@
+#include "CropService.h"
+#include "FileUtilities.h"
+#include "SeriesIndex.h"
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+const string CropService::JOB_EXTENSION = ".job";
+const string CropService::RUNNING_EXTENSION = ".running";
+const string CropService::RESULT_EXTENSION = ".result";
+const string CropService::STOP_FILENAME = "stop";
+
+//////////////////////////////////////////////////////////////////////////////////
+// CropService()
+//
+// Create a service for the specified watch folder, which looks for new jobs
+// every pollMilliseconds. Every job is cropped with the same options.
+//////////////////////////////////////////////////////////////////////////////////
+CropService::CropService(const string& watchDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, const unsigned int pollMilliseconds)
+	: _watchDirectory(watchDirectory),
+	_options(options),
+	_outputOptions(outputOptions),
+	_resultCache(resultCache),
+	_pollMilliseconds(pollMilliseconds)
+{
+	if (!FileUtilities::isDirectory(watchDirectory))
+		throw invalid_argument("The watch folder doesn't exist: " + watchDirectory);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// run()
+//
+// Process jobs until the stop file appears, then wait for the running jobs and
+// remove it. Jobs left running by a service that was killed are run again.
+// Returns the number of jobs processed.
+//////////////////////////////////////////////////////////////////////////////////
+int CropService::run()
+{
+	const string stopFilename = FileUtilities::joinPath(_watchDirectory, STOP_FILENAME);
+	int numberOfJobsProcessed = 0;
+
+	requeueInterruptedJobs();
+	cout << "Watching " << _watchDirectory << " for " << JOB_EXTENSION << " files." << endl;
+
+	while (!FileUtilities::fileExists(stopFilename))
+	{
+		numberOfJobsProcessed += poll();
+		this_thread::sleep_for(chrono::milliseconds(_pollMilliseconds));
+	}
+
+	numberOfJobsProcessed += finishJobs(true);
+	remove(stopFilename.c_str());
+
+	cout << "Stopped after " << numberOfJobsProcessed << " jobs." << endl;
+
+	return numberOfJobsProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// poll()
+//
+// Start every job that has arrived, and write the result of every job that has
+// finished. Returns the number of jobs finished.
+//////////////////////////////////////////////////////////////////////////////////
+int CropService::poll()
+{
+	claimJobs();
+
+	return finishJobs(false);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// claimJobs()
+//
+// Rename every new job file to mark it as running and queue the series it
+// names. A job that can't be renamed has been claimed by someone else.
+//////////////////////////////////////////////////////////////////////////////////
+void CropService::claimJobs()
+{
+	for (const auto& filename : FileUtilities::listDirectory(_watchDirectory))
+	{
+		if (filename.size() <= JOB_EXTENSION.size() || filename.compare(filename.size() - JOB_EXTENSION.size(), JOB_EXTENSION.size(), JOB_EXTENSION) != 0)
+			continue;
+
+		const string jobFilename = FileUtilities::joinPath(_watchDirectory, filename);
+		const string runningFilename = jobFilename + RUNNING_EXTENSION;
+
+		if (rename(jobFilename.c_str(), runningFilename.c_str()) != 0)
+			continue;
+
+		string startingFilename, outputDirectory;
+		readJob(runningFilename, startingFilename, outputDirectory);
+
+		_runningJobs.emplace_back();
+		Job& job = _runningJobs.back();
+		job.name = filename.substr(0, filename.size() - JOB_EXTENSION.size());
+		job.runningFilename = runningFilename;
+		job.startTicks = getTickCount();
+		job.result = _jobThreadPool.submit([this, startingFilename, outputDirectory]()
+		{
+			SeriesIndex seriesIndex;	// Per job, as frames may have been added since the last one.
+			return BatchProcessor::processOneSeries(startingFilename, outputDirectory, _options, _outputOptions, _resultCache, seriesIndex, _readerThreadPool, _matPool);
+		});
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// finishJobs()
+//
+// Write the result of every finished job and remove its running file, waiting
+// for every job if waitForAll is set. The result is written under another name
+// and renamed, so it is never read half written. Returns the number of jobs
+// finished.
+//////////////////////////////////////////////////////////////////////////////////
+int CropService::finishJobs(const bool waitForAll)
+{
+	int numberOfJobsFinished = 0;
+
+	for (auto job = _runningJobs.begin(); job != _runningJobs.end();)
+	{
+		if (!waitForAll && job->result.wait_for(chrono::seconds(0)) != future_status::ready)
+		{
+			++job;
+			continue;
+		}
+
+		const SeriesResult result = job->result.get();
+		const double seconds = (getTickCount() - job->startTicks) / getTickFrequency();
+
+		const string resultFilename = FileUtilities::joinPath(_watchDirectory, job->name + RESULT_EXTENSION);
+		const string temporaryFilename = resultFilename + ".tmp";
+		{
+			ofstream resultFile(temporaryFilename);
+			BatchProcessor::writeSummary(vector<SeriesResult>(1, result), resultFile);
+		}
+
+		remove(resultFilename.c_str());	// rename() won't replace an existing file on Windows.
+		if (rename(temporaryFilename.c_str(), resultFilename.c_str()) != 0)
+			cerr << "Unable to write job result: " << resultFilename << endl;
+
+		remove(job->runningFilename.c_str());
+
+		cout << "Job " << job->name << ": " << (result.succeeded ? "ok" : "failed") << " in " << seconds << " s" << endl;
+
+		job = _runningJobs.erase(job);
+		++numberOfJobsFinished;
+	}
+
+	return numberOfJobsFinished;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// requeueInterruptedJobs()
+//
+// Rename the running files left by a service that didn't stop cleanly back to
+// job files, so they are picked up again.
+//////////////////////////////////////////////////////////////////////////////////
+void CropService::requeueInterruptedJobs()
+{
+	const string runningSuffix = JOB_EXTENSION + RUNNING_EXTENSION;
+
+	for (const auto& filename : FileUtilities::listDirectory(_watchDirectory))
+	{
+		if (filename.size() <= runningSuffix.size() || filename.compare(filename.size() - runningSuffix.size(), runningSuffix.size(), runningSuffix) != 0)
+			continue;
+
+		const string runningFilename = FileUtilities::joinPath(_watchDirectory, filename);
+		const string jobFilename = runningFilename.substr(0, runningFilename.size() - RUNNING_EXTENSION.size());
+		rename(runningFilename.c_str(), jobFilename.c_str());
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readJob()
+//
+// Read the starting file and output directory of the specified job. A starting
+// file that doesn't exist as written is looked for in the watch folder, and the
+// output directory defaults to the one single series runs write to.
+//////////////////////////////////////////////////////////////////////////////////
+void CropService::readJob(const string& runningFilename, string& startingFilename, string& outputDirectory) const
+{
+	ifstream jobFile(runningFilename);
+
+	getline(jobFile, startingFilename);
+	getline(jobFile, outputDirectory);
+
+	for (string* line : { &startingFilename, &outputDirectory })
+	{
+		if (!line->empty() && line->back() == '\r')
+			line->pop_back();
+	}
+
+	if (!startingFilename.empty() && !FileUtilities::fileExists(startingFilename) && FileUtilities::fileExists(FileUtilities::joinPath(_watchDirectory, startingFilename)))
+		startingFilename = FileUtilities::joinPath(_watchDirectory, startingFilename);
+
+	if (outputDirectory.empty())
+		outputDirectory = DEFAULT_OUTPUT_DIRECTORY;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "BatchProcessor.h"
+#include "CropPipeline.h"
+#include "CropResultCache.h"
+#include "MatPool.h"
+#include "ThreadPool.h"
+#include "WorkStealingThreadPool.h"
+#include <opencv2/core.hpp>
+#include <future>
+#include <list>
+#include <string>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropService
+	//
+	// Crop series as jobs arrive in a watch folder, without starting a process
+	// per series. The thread pools, buffers and MOG2 instances stay warm between
+	// jobs. A job is a file [Name].job whose first line is the starting file of a
+	// series, and whose optional second line is the output directory. Write it
+	// under another name and rename it, so it is never read half written. The job
+	// is renamed [Name].job.running while it runs, and [Name].result, in the CSV
+	// of a batch summary, appears once it is done. A file named stop in the watch
+	// folder stops the service once its running jobs are done.
+	//////////////////////////////////////////////////////////////////////////////////
+	class CropService final
+	{
+	public:
+		CropService(const std::string& watchDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, const unsigned int pollMilliseconds);
+
+		int run();
+		int poll();
+
+		static const std::string JOB_EXTENSION;
+		static const std::string RUNNING_EXTENSION;
+		static const std::string RESULT_EXTENSION;
+		static const std::string STOP_FILENAME;
+	private:
+		CropService(const CropService&) = delete;
+		CropService& operator=(const CropService&) = delete;
+
+		struct Job
+		{
+			std::string name;
+			std::string runningFilename;
+			int64 startTicks;
+			std::future<SeriesResult> result;
+		};
+
+		void claimJobs();
+		int finishJobs(const bool waitForAll);
+		void requeueInterruptedJobs();
+		void readJob(const std::string& runningFilename, std::string& startingFilename, std::string& outputDirectory) const;
+
+		std::string _watchDirectory;
+		CropRegionOptions _options;
+		CropOutputOptions _outputOptions;
+		const CropResultCache* _resultCache;
+		unsigned int _pollMilliseconds;
+		utility::ThreadPool _readerThreadPool;
+		utility::MatPool _matPool;
+		std::list<Job> _runningJobs;
+		utility::WorkStealingThreadPool _jobThreadPool;	// Last, so it finishes its jobs before the pools they use are destroyed.
+	};
+}
@@ -0,0 +1,132 @@
+#include "CropSidecar.h"
+#include "ImageReader.h"
+#include "PackedSeries.h"
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+const string CropSidecar::DEFAULT_FILENAME = "crop.yml";
+
+//////////////////////////////////////////////////////////////////////////////////
+// create()
+//
+// Returns the sidecar of the series beginning with the specified starting file.
+// Only the frames that exist are listed, as only they were read. A packed series
+// is listed as its one file.
+//////////////////////////////////////////////////////////////////////////////////
+CropSidecar CropSidecar::create(const string& startingFilename, Rect gelRegion, Rect cropRegion)
+{
+	CropSidecar sidecar;
+	sidecar.gelRegion = gelRegion;
+	sidecar.cropRegion = cropRegion;
+
+	if (PackedSeries::isPackedSeries(startingFilename))
+	{
+		sidecar.seriesName = PackedSeries(startingFilename).getSeriesName();
+		sidecar.sourceFilenames.push_back(startingFilename);
+		return sidecar;
+	}
+
+	sidecar.seriesName = ImageReader::getSeriesName(startingFilename);
+
+	sidecar.sourceFilenames = ImageReader::getDatasetFilenames(startingFilename);
+
+	return sidecar;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// create()
+//
+// Returns the sidecar of the specified series made of the specified frames, such
+// as a SeriesIndex found.
+//////////////////////////////////////////////////////////////////////////////////
+CropSidecar CropSidecar::create(const string& seriesName, const vector<string>& sourceFilenames, Rect gelRegion, Rect cropRegion)
+{
+	CropSidecar sidecar;
+	sidecar.seriesName = seriesName;
+	sidecar.gelRegion = gelRegion;
+	sidecar.cropRegion = cropRegion;
+	sidecar.sourceFilenames = sourceFilenames;
+
+	return sidecar;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// read()
+//
+// Read the sidecar from the specified file. Throws if it can't be read.
+//////////////////////////////////////////////////////////////////////////////////
+CropSidecar CropSidecar::read(const string& filename)
+{
+	FileStorage fs(filename, FileStorage::READ);
+
+	if (!fs.isOpened())
+		throw runtime_error("Unable to read crop sidecar: " + filename);
+
+	CropSidecar sidecar;
+	sidecar.seriesName = static_cast<string>(fs["series"]);
+	sidecar.gelRegion = readRect(fs["gelRegion"]);
+	sidecar.cropRegion = readRect(fs["cropRegion"]);
+
+	const FileNode sourceFiles = fs["sourceFiles"];
+
+	for (auto it = sourceFiles.begin(); it != sourceFiles.end(); ++it)
+	{
+		sidecar.sourceFilenames.push_back(static_cast<string>(*it));
+	}
+
+	return sidecar;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// write()
+//
+// Write the sidecar to the specified file. Throws if it can't be written.
+//////////////////////////////////////////////////////////////////////////////////
+void CropSidecar::write(const string& filename) const
+{
+	FileStorage fs(filename, FileStorage::WRITE);
+
+	if (!fs.isOpened())
+		throw runtime_error("Unable to write crop sidecar: " + filename);
+
+	fs << "series" << seriesName;
+	writeRect(fs, "gelRegion", gelRegion);
+	writeRect(fs, "cropRegion", cropRegion);
+	fs << "sourceFiles" << "[";
+
+	for (const auto& sourceFilename : sourceFilenames)
+	{
+		fs << sourceFilename;
+	}
+
+	fs << "]";
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeRect()
+//
+// Write the specified rectangle as a map of named fields rather than OpenCV's
+// bare sequence, so consumers don't need to know the field order.
+//////////////////////////////////////////////////////////////////////////////////
+void CropSidecar::writeRect(FileStorage& fs, const string& name, const Rect& rect)
+{
+	fs << name << "{" << "x" << rect.x << "y" << rect.y << "width" << rect.width << "height" << rect.height << "}";
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readRect()
+//
+// Read a rectangle written by writeRect().
+//////////////////////////////////////////////////////////////////////////////////
+Rect CropSidecar::readRect(const FileNode& node)
+{
+	if (node.empty())
+		throw runtime_error("Crop sidecar is missing a region.");
+
+	return Rect(static_cast<int>(node["x"]), static_cast<int>(node["y"]), static_cast<int>(node["width"]), static_cast<int>(node["height"]));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropSidecar
+	//
+	// Everything needed to crop a series without writing its cropped images: the
+	// gel and root regions, and the source frames they apply to. Written as YAML,
+	// so it can be read without OpenCV.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct CropSidecar
+	{
+		std::string seriesName;
+		cv::Rect gelRegion;						// The inside of the container, in source frame coordinates.
+		cv::Rect cropRegion;					// The root system, in source frame coordinates.
+		std::vector<std::string> sourceFilenames;	// The frames of the series in frame order, as they were specified.
+
+		static CropSidecar create(const std::string& startingFilename, cv::Rect gelRegion, cv::Rect cropRegion);
+		static CropSidecar create(const std::string& seriesName, const std::vector<std::string>& sourceFilenames, cv::Rect gelRegion, cv::Rect cropRegion);
+		static CropSidecar read(const std::string& filename);
+		void write(const std::string& filename) const;
+
+		static const std::string DEFAULT_FILENAME;
+	private:
+		static void writeRect(cv::FileStorage& fs, const std::string& name, const cv::Rect& rect);
+		static cv::Rect readRect(const cv::FileNode& node);
+	};
+}
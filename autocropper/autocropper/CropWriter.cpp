@@ -0,0 +1,173 @@
+#include "CropWriter.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// CropOutputOptions()
+//
+// Cropped images only, as PNG at the default compression level, as they were
+// always written.
+//////////////////////////////////////////////////////////////////////////////////
+CropOutputOptions::CropOutputOptions()
+	: format("png"),
+	pngCompressionLevel(3),
+	writeImages(true),
+	writeSidecar(false)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isValid()
+//
+// Returns true if the format is one of the supported ones, the compression
+// level is in range and something is to be written.
+//////////////////////////////////////////////////////////////////////////////////
+bool CropOutputOptions::isValid() const
+{
+	const bool isSupportedFormat = (format == "png" || format == "bmp" || format == "pgm" || format == "tif");
+
+	return isSupportedFormat && pngCompressionLevel >= 0 && pngCompressionLevel <= 9 && (writeImages || writeSidecar);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getExtension()
+//
+// Returns the extension of the cropped images, including the leading period.
+//////////////////////////////////////////////////////////////////////////////////
+string CropOutputOptions::getExtension() const
+{
+	return "." + format;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getEncoderParameters()
+//
+// Returns the parameters to pass to imwrite() for the format.
+//////////////////////////////////////////////////////////////////////////////////
+vector<int> CropOutputOptions::getEncoderParameters() const
+{
+	vector<int> parameters;
+
+	if (format == "png")
+	{
+		parameters.push_back(IMWRITE_PNG_COMPRESSION);
+		parameters.push_back(pngCompressionLevel);
+	}
+	else if (format == "pgm")
+	{
+		parameters.push_back(IMWRITE_PXM_BINARY);
+		parameters.push_back(1);
+	}
+
+	return parameters;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// CropWriter()
+//
+// Write cropped images to the specified directory, encoding them on the
+// specified thread pool.
+//////////////////////////////////////////////////////////////////////////////////
+CropWriter::CropWriter(const string& outputDirectory, const CropOutputOptions& outputOptions, ThreadPool& threadPool)
+	: _outputDirectory(outputDirectory),
+	_outputOptions(outputOptions),
+	_threadPool(threadPool),
+	_maximumPendingWrites(threadPool.getNumberOfThreads() * IMAGES_IN_FLIGHT_PER_THREAD)
+{
+	if (!_outputOptions.isValid())
+		throw invalid_argument("Unsupported cropped image format or compression level: " + _outputOptions.format);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~CropWriter()
+//
+// Wait for every queued image to be written. Errors are only reported by
+// finish(), so call it first to find out whether everything was written.
+//////////////////////////////////////////////////////////////////////////////////
+CropWriter::~CropWriter()
+{
+	try
+	{
+		finish();
+	}
+	catch (const exception&)
+	{
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// write()
+//
+// Queue the specified image to be written as the specified image number. The
+// image shares its pixels with the caller's, so it must not be modified until
+// finish() returns.
+//////////////////////////////////////////////////////////////////////////////////
+void CropWriter::write(const Mat& image, const int imageNumber)
+{
+	while (_pendingWrites.size() >= _maximumPendingWrites)
+	{
+		future<void> pendingWrite = move(_pendingWrites.front());
+		_pendingWrites.pop_front();
+		pendingWrite.get();	// Rethrows if the image couldn't be written.
+	}
+
+	const string filename = getFilename(imageNumber);
+	const vector<int> encoderParameters = _outputOptions.getEncoderParameters();
+
+	_pendingWrites.push_back(_threadPool.submit([image, filename, encoderParameters]()
+	{
+		if (!imwrite(filename, image, encoderParameters))
+			throw runtime_error("Unable to write cropped image: " + filename);
+	}));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// finish()
+//
+// Wait for every queued image to be written. Throws the first error any of them
+// hit, after the rest have finished.
+//////////////////////////////////////////////////////////////////////////////////
+void CropWriter::finish()
+{
+	exception_ptr firstError;
+
+	while (!_pendingWrites.empty())
+	{
+		future<void> pendingWrite = move(_pendingWrites.front());
+		_pendingWrites.pop_front();
+
+		try
+		{
+			pendingWrite.get();
+		}
+		catch (...)
+		{
+			if (!firstError)
+				firstError = current_exception();
+		}
+	}
+
+	if (firstError)
+		rethrow_exception(firstError);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFilename()
+//
+// Returns [Output Directory][Image Number].[Extension]
+//////////////////////////////////////////////////////////////////////////////////
+string CropWriter::getFilename(const int imageNumber) const
+{
+	stringstream ss;
+	ss << _outputDirectory << imageNumber << _outputOptions.getExtension();
+
+	return ss.str();
+}
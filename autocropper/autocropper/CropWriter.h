@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropOutputOptions
+	//
+	// What is written for a cropped series, and how cropped images are encoded.
+	// The defaults reproduce the original PNG output.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct CropOutputOptions
+	{
+		CropOutputOptions();
+
+		std::string format;				// The file extension, and so the encoder: png, bmp, pgm or tif.
+		int pngCompressionLevel;		// 0 (fastest, largest) to 9 (slowest, smallest). Ignored by the other formats.
+		bool writeImages;				// Write the cropped region of every frame.
+		bool writeSidecar;				// Write a CropSidecar describing the crop instead of, or as well as, the images.
+
+		bool isValid() const;
+		std::string getExtension() const;
+		std::vector<int> getEncoderParameters() const;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// CropWriter
+	//
+	// Encode and write cropped images on a thread pool so that encoding, which
+	// dominates the end of a run, happens in parallel while the caller carries on.
+	// Only a bounded number of images wait to be written at once; write() blocks
+	// once that many are queued. If an image can't be written, the error is thrown
+	// from a later write() or from finish().
+	//////////////////////////////////////////////////////////////////////////////////
+	class CropWriter final
+	{
+	public:
+		CropWriter(const std::string& outputDirectory, const CropOutputOptions& outputOptions, utility::ThreadPool& threadPool);
+		~CropWriter();
+
+		void write(const cv::Mat& image, const int imageNumber);
+		void finish();
+
+		std::string getFilename(const int imageNumber) const;
+
+		static const unsigned int IMAGES_IN_FLIGHT_PER_THREAD = 2;
+	private:
+		CropWriter(const CropWriter&) = delete;
+		CropWriter& operator=(const CropWriter&) = delete;
+
+		std::string _outputDirectory;
+		CropOutputOptions _outputOptions;
+		utility::ThreadPool& _threadPool;
+		std::deque<std::future<void>> _pendingWrites;
+		size_t _maximumPendingWrites;
+	};
+}
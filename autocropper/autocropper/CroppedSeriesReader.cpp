@@ -0,0 +1,107 @@
+#include "CroppedSeriesReader.h"
+#include "ImageReader.h"
+#include <opencv2/core.hpp>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////
+// CroppedSeriesReader()
+//
+// Read the series described by the specified sidecar file.
+//////////////////////////////////////////////////////////////////////////////////
+CroppedSeriesReader::CroppedSeriesReader(const string& sidecarFilename)
+	: _sidecar(CropSidecar::read(sidecarFilename))
+{
+	openPackedSeries();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// CroppedSeriesReader()
+//
+// Read the series described by the specified sidecar.
+//////////////////////////////////////////////////////////////////////////////////
+CroppedSeriesReader::CroppedSeriesReader(const CropSidecar& sidecar)
+	: _sidecar(sidecar)
+{
+	openPackedSeries();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfImages()
+//
+// Returns the number of frames in the series.
+//////////////////////////////////////////////////////////////////////////////////
+size_t CroppedSeriesReader::getNumberOfImages() const
+{
+	if (_packedSeries)
+		return _packedSeries->getNumberOfFrames();
+
+	return _sidecar.sourceFilenames.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getCroppedImage()
+//
+// Decode the specified frame and return the root system region of it. The
+// result is a view that keeps the whole decoded frame alive; clone it to keep
+// only the region.
+//////////////////////////////////////////////////////////////////////////////////
+Mat CroppedSeriesReader::getCroppedImage(const size_t imageIndex) const
+{
+	return getRegion(imageIndex, _sidecar.cropRegion);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getGelImage()
+//
+// Decode the specified frame and return the gel region of it, as a view.
+//////////////////////////////////////////////////////////////////////////////////
+Mat CroppedSeriesReader::getGelImage(const size_t imageIndex) const
+{
+	return getRegion(imageIndex, _sidecar.gelRegion);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSidecar()
+//
+// Returns the sidecar the series is read from.
+//////////////////////////////////////////////////////////////////////////////////
+const CropSidecar& CroppedSeriesReader::getSidecar() const
+{
+	return _sidecar;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getRegion()
+//
+// Decode the specified frame, as the pipeline read it, and return a view of the
+// specified region. Throws if the frame can't be read or doesn't contain the
+// region, e.g. because the source files changed after the sidecar was written.
+//////////////////////////////////////////////////////////////////////////////////
+Mat CroppedSeriesReader::getRegion(const size_t imageIndex, Rect region) const
+{
+	const string& filename = _packedSeries ? _packedSeries->getFilename() : _sidecar.sourceFilenames.at(imageIndex);
+	Mat image = _packedSeries ? _packedSeries->getFrame(imageIndex) : ImageReader::readImage(filename);
+
+	if (image.empty())
+		throw runtime_error("Unable to read source image: " + filename);
+
+	if ((region & Rect(0, 0, image.cols, image.rows)) != region)
+		throw runtime_error("Source image is smaller than its crop region: " + filename);
+
+	return image(region);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// openPackedSeries()
+//
+// Map the source file if the sidecar's series is packed into one.
+//////////////////////////////////////////////////////////////////////////////////
+void CroppedSeriesReader::openPackedSeries()
+{
+	if (_sidecar.sourceFilenames.size() == 1 && PackedSeries::isPackedSeries(_sidecar.sourceFilenames.front()))
+		_packedSeries = make_shared<PackedSeries>(_sidecar.sourceFilenames.front());
+}
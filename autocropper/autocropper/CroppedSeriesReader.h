@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CropSidecar.h"
+#include "PackedSeries.h"
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// CroppedSeriesReader
+	//
+	// Read a series cropped by a sidecar instead of its cropped images. Each frame
+	// is decoded only when asked for, and the crop is returned as a view into the
+	// decoded frame rather than a copy. Frames are never cached, so the reader can
+	// be shared between threads. The frames of a packed series are views into its
+	// mapped file, which stays mapped as long as the reader does.
+	//////////////////////////////////////////////////////////////////////////////////
+	class CroppedSeriesReader final
+	{
+	public:
+		explicit CroppedSeriesReader(const std::string& sidecarFilename);
+		explicit CroppedSeriesReader(const CropSidecar& sidecar);
+
+		size_t getNumberOfImages() const;
+		cv::Mat getCroppedImage(const size_t imageIndex) const;
+		cv::Mat getGelImage(const size_t imageIndex) const;
+		const CropSidecar& getSidecar() const;
+	private:
+		cv::Mat getRegion(const size_t imageIndex, cv::Rect region) const;
+		void openPackedSeries();
+
+		CropSidecar _sidecar;
+		std::shared_ptr<const PackedSeries> _packedSeries;	// Null unless the series is packed.
+	};
+}
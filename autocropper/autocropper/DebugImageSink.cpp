@@ -0,0 +1,129 @@
+#include "DebugImageSink.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+atomic<bool> DebugImageSink::_isEnabled(false);
+queue<pair<string, Mat>> DebugImageSink::_queuedImages;
+mutex DebugImageSink::_mutex;
+condition_variable DebugImageSink::_queueChanged;
+thread DebugImageSink::_writerThread;
+bool DebugImageSink::_isStopping = false;
+
+//////////////////////////////////////////////////////////////////////////////////
+// enable()
+//
+// Start writing debug images. Returns false if debug images were not compiled
+// into this build, in which case nothing is written.
+//////////////////////////////////////////////////////////////////////////////////
+bool DebugImageSink::enable()
+{
+#ifdef AUTOCROPPER_DEBUG_IMAGES
+	lock_guard<mutex> lock(_mutex);
+
+	if (_isEnabled)
+		return true;
+
+	_isStopping = false;
+	_writerThread = thread(&DebugImageSink::runWriter);
+	_isEnabled = true;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// disable()
+//
+// Stop accepting debug images, and wait for the queued ones to be written.
+//////////////////////////////////////////////////////////////////////////////////
+void DebugImageSink::disable()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+
+		if (!_isEnabled)
+			return;
+
+		_isEnabled = false;
+		_isStopping = true;
+	}
+
+	_queueChanged.notify_all();
+	_writerThread.join();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isEnabled()
+//
+// Returns true if debug images are currently being written.
+//////////////////////////////////////////////////////////////////////////////////
+bool DebugImageSink::isEnabled()
+{
+	return _isEnabled;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// write()
+//
+// Queue a copy of the specified image to be written to the specified file.
+// The caller is free to modify the image as soon as this returns.
+//////////////////////////////////////////////////////////////////////////////////
+void DebugImageSink::write(const string& filename, const Mat& image)
+{
+	Mat imageCopy = image.clone();	// Copy outside the lock; callers often keep modifying the image.
+
+	unique_lock<mutex> lock(_mutex);
+	_queueChanged.wait(lock, []() { return _isStopping || _queuedImages.size() < MAXIMUM_QUEUED_IMAGES; });
+
+	if (_isStopping)
+		return;
+
+	_queuedImages.push(make_pair(filename, imageCopy));
+	lock.unlock();
+
+	_queueChanged.notify_all();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// runWriter()
+//
+// Encode and write queued images until the sink is disabled and the queue is
+// drained.
+//////////////////////////////////////////////////////////////////////////////////
+void DebugImageSink::runWriter()
+{
+	while (true)
+	{
+		pair<string, Mat> queuedImage;
+
+		{
+			unique_lock<mutex> lock(_mutex);
+			_queueChanged.wait(lock, []() { return _isStopping || !_queuedImages.empty(); });
+
+			if (_queuedImages.empty())
+				return;	// Only reachable when stopping.
+
+			queuedImage = _queuedImages.front();
+			_queuedImages.pop();
+		}
+
+		_queueChanged.notify_all();	// Wake any writer blocked on a full queue.
+
+		try
+		{
+			if (!imwrite(queuedImage.first, queuedImage.second))
+				cerr << "Unable to write debug image: " << queuedImage.first << endl;
+		}
+		catch (const cv::Exception& e)
+		{
+			cerr << "Unable to write debug image: " << queuedImage.first << ": " << e.what() << endl;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Debug images are compiled into debug builds, or into any build that defines AUTOCROPPER_DEBUG_IMAGES.
+// In every other build DEBUG_IMWRITE compiles to nothing and its arguments are never evaluated.
+#if defined(_DEBUG) && !defined(AUTOCROPPER_DEBUG_IMAGES)
+#define AUTOCROPPER_DEBUG_IMAGES
+#endif
+
+#ifdef AUTOCROPPER_DEBUG_IMAGES
+#define DEBUG_IMAGES_ENABLED() (utility::DebugImageSink::isEnabled())
+#define DEBUG_IMWRITE(filename, image) do { if (DEBUG_IMAGES_ENABLED()) utility::DebugImageSink::write((filename), (image)); } while (false)
+#else
+#define DEBUG_IMAGES_ENABLED() (false)
+#define DEBUG_IMWRITE(filename, image) do { } while (false)
+#endif
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// DebugImageSink
+	//
+	// Write intermediate images for debugging without holding up the pipeline.
+	// Images are copied and queued, then encoded and written on a background
+	// thread. The sink is off until enabled; use DEBUG_IMWRITE rather than calling
+	// write() directly so that release builds skip it entirely.
+	//////////////////////////////////////////////////////////////////////////////////
+	class DebugImageSink final
+	{
+	public:
+		static bool enable();
+		static void disable();
+		static bool isEnabled();
+		static void write(const std::string& filename, const cv::Mat& image);
+	private:
+		static void runWriter();
+
+		static const size_t MAXIMUM_QUEUED_IMAGES = 64;	// Writers block once this many images are waiting, to bound memory.
+
+		static std::atomic<bool> _isEnabled;
+		static std::queue<std::pair<std::string, cv::Mat>> _queuedImages;
+		static std::mutex _mutex;
+		static std::condition_variable _queueChanged;
+		static std::thread _writerThread;
+		static bool _isStopping;
+	};
+}
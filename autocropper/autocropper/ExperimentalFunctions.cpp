@@ -1,39 +1,117 @@
 #include "ExperimentalFunctions.h"
+#include "Accelerator.h"
+#include "BackgroundSubtractorPool.h"
+#include "DebugImageSink.h"
 #include "FileUtilities.h"
 #include "OcvUtilities.h"
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/video.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 using namespace cv;
 using namespace experimental;
 using namespace std;
 using namespace OcvUtility;
+using namespace utility;
 
 namespace experimental
 {
+	// Rectangle searches probe this fraction of the image around its center, and take a line that covers this fraction of the probe for an edge.
+	// Lines longer than half the image plus half the probe always cover all of it, as the container edges do.
+	const double PROBE_BAND_FRACTION = 0.1;
+	const double PROBE_COVERAGE_FRACTION = 0.5;
+
 	//////////////////////////////////////////////////////////////////////////////////
 	// computeRowWithMaximumBlackPixels()
 	//
 	// Compute the row of the specified image with the maximum number of black pixels.
+	// Only the specified fraction of the image, from the top, is searched.
+	//////////////////////////////////////////////////////////////////////////////////
+	int computeRowWithMaximumBlackPixels(cv::Mat image, const double searchFraction)
+	{
+		return computeRowWithMaximumBlackPixels(ProjectionProfile(image), searchFraction);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeMaximumRootExtents()
+	//
+	// Compute the maximum root extents below a specified startingY position.
+	// TODO: Generalize this function.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeMaximumRootExtents(cv::Mat image, const int startingY)
+	{
+		return computeMaximumRootExtents(ProjectionProfile(image), startingY);
+	}
+
 	//////////////////////////////////////////////////////////////////////////////////
-	int computeRowWithMaximumBlackPixels(cv::Mat image)
+	// computeRowWithMaximumBlackPixels()
+	//
+	// computeRowWithMaximumBlackPixels() on a packed mask, counting each row a word
+	// at a time.
+	//////////////////////////////////////////////////////////////////////////////////
+	int computeRowWithMaximumBlackPixels(const BinaryMask& mask, const double searchFraction)
 	{
 		int rowPositionWithMaximumBlackPixels = 0;
 		int maxBlackPixelsInAnyRow = 0;
 
-		for (int y = 0; y < static_cast<int>(image.size().height * 0.1); ++y)
+		for (int y = 0; y < static_cast<int>(mask.size().height * searchFraction); ++y)
 		{
-			int numberOfBlackPixelsInRow = 0;
+			int numberOfBlackPixelsInRow = mask.size().width - mask.countRow(y);
 
-			for (int x = 0; x < image.size().width; ++x)
+			if (numberOfBlackPixelsInRow > maxBlackPixelsInAnyRow)
 			{
-				Point currentPoint = Point(x, y);
-				if (image.at<uchar>(currentPoint) == 0)
-				{
-					numberOfBlackPixelsInRow++;
-				}
+				maxBlackPixelsInAnyRow = numberOfBlackPixelsInRow;
+				rowPositionWithMaximumBlackPixels = y;
 			}
+		}
+
+		return rowPositionWithMaximumBlackPixels;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeMaximumRootExtents()
+	//
+	// computeMaximumRootExtents() on a packed mask. Each row is searched inwards a
+	// word at a time from both ends.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeMaximumRootExtents(const BinaryMask& mask, const int startingY)
+	{
+		int b = 0;
+		int l = mask.size().width;
+		int r = 0;
+		for (int y = startingY; y < mask.size().height; ++y)
+		{
+			int firstSet = mask.findFirstInRow(y);
+			if (firstSet == mask.size().width)
+				continue;	// No root pixels in this row.
+
+			l = min(l, firstSet);
+			r = max(r, mask.findLastInRow(y));
+			b = y;
+		}
+
+		Rect rootRectangle = Rect(l, 0, r - l, b);
+
+		return rootRectangle;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeRowWithMaximumBlackPixels()
+	//
+	// computeRowWithMaximumBlackPixels() on the profile of an image, so that each
+	// row is counted by a lookup.
+	//////////////////////////////////////////////////////////////////////////////////
+	int computeRowWithMaximumBlackPixels(const ProjectionProfile& profile, const double searchFraction)
+	{
+		int rowPositionWithMaximumBlackPixels = 0;
+		int maxBlackPixelsInAnyRow = 0;
+
+		for (int y = 0; y < static_cast<int>(profile.size().height * searchFraction); ++y)
+		{
+			int numberOfBlackPixelsInRow = profile.size().width - profile.countRow(y);
 
 			if (numberOfBlackPixelsInRow > maxBlackPixelsInAnyRow)
 			{
@@ -48,36 +126,23 @@ namespace experimental
 	//////////////////////////////////////////////////////////////////////////////////
 	// computeMaximumRootExtents()
 	//
-	// Compute the maximum root extents below a specified startingY position.
-	// TODO: Generalize this function.
+	// computeMaximumRootExtents() on the profile of an image, so that the first and
+	// last nonzero pixels of each row are lookups.
 	//////////////////////////////////////////////////////////////////////////////////
-	Rect computeMaximumRootExtents(cv::Mat image, const int startingY)
+	Rect computeMaximumRootExtents(const ProjectionProfile& profile, const int startingY)
 	{
 		int b = 0;
-		int l = image.size().width;
+		int l = profile.size().width;
 		int r = 0;
-		for (int y = startingY; y < image.size().height; ++y)
+		for (int y = startingY; y < profile.size().height; ++y)
 		{
-			for (int x = 0; x < image.size().width; ++x)
-			{
-				Point currentPoint = Point(x, y);
-				//containerImage.at<uchar>(currentPoint) = 255;	//TODO: Testing where the % line is drawn.
-				if (image.at<uchar>(currentPoint) != 0)
-				{
-					if (currentPoint.x < l)
-					{
-						l = currentPoint.x;
-					}
-					if (currentPoint.x > r)
-					{
-						r = currentPoint.x;
-					}
-					if (currentPoint.y > b)
-					{
-						b = currentPoint.y;
-					}
-				}
-			}
+			int firstNonZero = profile.findFirstInRow(y);
+			if (firstNonZero == profile.size().width)
+				continue;	// No root pixels in this row.
+
+			l = min(l, firstNonZero);
+			r = max(r, profile.findLastInRow(y));
+			b = y;
 		}
 
 		Rect rootRectangle = Rect(l, 0, r - l, b);
@@ -92,30 +157,15 @@ namespace experimental
 	//////////////////////////////////////////////////////////////////////////////////
 	Mat computeAverageImage(const vector<Mat>& images)
 	{
-		Mat averageImage = Mat::zeros(images.at(0).size().height, images.at(0).size().width, CV_32FC1);
-
-		for (Mat image : images)
-		{
-			for (int i = 0; i < image.size().height; ++i)
-			{
-				for (int j = 0; j < image.size().width; ++j)
-				{
-					Point currentPoint = Point(j, i);
-					averageImage.at<float>(currentPoint) += image.at<uchar>(currentPoint);
-				}
-			}
-		}
+		Mat sumImage = Mat::zeros(images.at(0).size().height, images.at(0).size().width, CV_32FC1);
 
-		for (int i = 0; i < averageImage.size().height; ++i)
+		for (const Mat& image : images)
 		{
-			for (int j = 0; j < averageImage.size().width; ++j)
-			{
-				Point currentPoint = Point(j, i);
-				averageImage.at<float>(currentPoint) /= images.size();
-			}
+			accumulate(image, sumImage);
 		}
 
-		averageImage.convertTo(averageImage, CV_8UC1);
+		Mat averageImage;
+		sumImage.convertTo(averageImage, CV_8UC1, 1.0 / images.size());
 
 		return averageImage;
 	}
@@ -126,8 +176,9 @@ namespace experimental
 	// Compute the gradient of the specified image and return it.
 	// Code from:
 	// http://docs.opencv.org/2.4.10/doc/tutorials/imgproc/imgtrans/sobel_derivatives/sobel_derivatives.html
+	// The intermediate images are borrowed from the specified pool if there is one.
 	//////////////////////////////////////////////////////////////////////////////////
-	Mat computeGradientImage(Mat image)
+	Mat computeGradientImage(Mat image, MatPool* matPool)
 	{
 		int scale = 1;
 		int delta = 0;
@@ -135,8 +186,15 @@ namespace experimental
 		Mat grad;
 
 		/// Generate grad_x and grad_y
-		Mat grad_x, grad_y;
-		Mat abs_grad_x, abs_grad_y;
+		const int gradientType = CV_MAKETYPE(ddepth, image.channels());
+		MatPool::Lease gradXLease = MatPool::acquire(matPool, image.size(), gradientType);
+		MatPool::Lease gradYLease = MatPool::acquire(matPool, image.size(), gradientType);
+		MatPool::Lease absGradXLease = MatPool::acquire(matPool, image.size(), gradientType);
+		MatPool::Lease absGradYLease = MatPool::acquire(matPool, image.size(), gradientType);
+		Mat& grad_x = gradXLease.get();
+		Mat& grad_y = gradYLease.get();
+		Mat& abs_grad_x = absGradXLease.get();
+		Mat& abs_grad_y = absGradYLease.get();
 
 		/// Gradient X
 		//Scharr( src_gray, grad_x, ddepth, 1, 0, scale, delta, BORDER_DEFAULT );
@@ -161,7 +219,7 @@ namespace experimental
 	//////////////////////////////////////////////////////////////////////////////////
 	Mat drawRedRectOnImage(Mat image, Rect rect, int thickness)
 	{
-		Mat convertedImage = image.clone();
+		Mat convertedImage;	// cvtColor allocates the three channel image, so there is nothing to gain from copying the input first.
 
 		cvtColor(image, convertedImage, CV_GRAY2RGB);
 		rectangle(convertedImage, rect, Scalar(0, 0, 255), thickness);
@@ -173,57 +231,39 @@ namespace experimental
 	// computeInnermostRectangle()
 	//
 	// Compute the innermost rectangle that can be defined based on the specified
-	// image.
+	// image. Each edge is the nearest line to the center that covers enough of the
+	// probe band across it, so a gap in the line at the very center row or column
+	// is not missed, and a stray pixel there is not taken for a line. Only the two
+	// bands are profiled: the center columns for the top and bottom, and the center
+	// rows for the left and right.
 	//////////////////////////////////////////////////////////////////////////////////
 	Rect computeInnermostRectangle(Mat image)	//TODO: This function name is terrible.
 	{
-		Point center = Point(image.size().width / 2, image.size().height / 2);
-		int u = 0, d = image.size().height, l = 0, r = image.size().width;
-
-		// Find the nearest nonwhite pixel above.
-		for (int i = center.y; i >= 0; --i)
-		{
-			Point currentPoint = Point(center.x, i);
-			int valueAtCurrentPoint = image.at<uchar>(currentPoint);
-			if (valueAtCurrentPoint != 0)
-			{
-				u = i;
-				break;
-			}
-		}
-
-		// Find the nearest nonwhite pixel below.
-		for (int i = center.y; i < image.size().height; ++i)
-		{
-			Point currentPoint = Point(center.x, i);
-			if (image.at<uchar>(currentPoint) != 0)
-			{
-				d = i;
-				break;
-			}
-		}
-
-		// Find the nearest nonwhite pixel to the left.
-		for (int i = center.x; i >= 0; --i)
-		{
-			Point currentPoint = Point(i, center.y);
-			if (image.at<uchar>(currentPoint) != 0)
-			{
-				l = i;
-				break;
-			}
-		}
-
-		// Find the nearest nonwhite pixel to the right.
-		for (int i = center.x; i < image.size().width; ++i)
-		{
-			Point currentPoint = Point(i, center.y);
-			if (image.at<uchar>(currentPoint) != 0)
-			{
-				r = i;
-				break;
-			}
-		}
+		const Size size = image.size();
+		const Point center = Point(size.width / 2, size.height / 2);
+		const Range rowBand = computeProbeBand(size.height);
+		const Range columnBand = computeProbeBand(size.width);
+		const ProjectionProfile centerColumns(image.colRange(columnBand));
+		const ProjectionProfile centerRows(image.rowRange(rowBand));
+		int u = 0, d = size.height, l = 0, r = size.width;
+
+		// Find the nearest row above and below that crosses the center columns.
+		int y = centerColumns.findLastRow(Range(0, center.y + 1), Range(0, columnBand.size()), computeProbeCoverage(columnBand));
+		if (y >= 0)
+			u = y;
+
+		y = centerColumns.findFirstRow(Range(center.y, size.height), Range(0, columnBand.size()), computeProbeCoverage(columnBand));
+		if (y < size.height)
+			d = y;
+
+		// Find the nearest column to the left and right that crosses the center rows.
+		int x = centerRows.findLastColumn(Range(0, center.x + 1), Range(0, rowBand.size()), computeProbeCoverage(rowBand));
+		if (x >= 0)
+			l = x;
+
+		x = centerRows.findFirstColumn(Range(center.x, size.width), Range(0, rowBand.size()), computeProbeCoverage(rowBand));
+		if (x < size.width)
+			r = x;
 
 		return Rect(l, u, r - l, d - u);
 	}
@@ -235,39 +275,48 @@ namespace experimental
 	//
 	// Compute the outermost rectangle that can be formed by the specified image.
 	// For now let's only check the top and bottom since this will only be used to
-	// find the horizontal lines in the container image.
+	// find the horizontal lines in the container image. The top is the first row
+	// from the top that crosses the center columns, as computeInnermostRectangle()
+	// decides it; the bottom isn't searched for yet.
 	//////////////////////////////////////////////////////////////////////////////////
 	Rect computeOutermostRectangle(Mat image)
 	{
-		Point center = Point(image.size().width / 2, image.size().height / 2);
-		int u = 0, d = image.size().height, l = 0, r = image.size().width;
+		const Size size = image.size();
+		const Range columnBand = computeProbeBand(size.width);
+		const ProjectionProfile centerColumns(image.colRange(columnBand));
+		int u = 0, d = size.height, l = 0, r = size.width;
 
-		// Start at the top middle point and go until you find the first non-black pixel.
-		// Start at the bottom middle point and go until you find the first non-black pixel
-		// Start at the middle left point and go until ....
-		// Start at the middle right point ...
+		int y = centerColumns.findFirstRow(Range(0, size.height), Range(0, columnBand.size()), computeProbeCoverage(columnBand));
+		if (y < size.height)
+			u = y;
 
-		for (int i = 0; i < image.size().height; ++i)
-		{
-			Point currentPoint = Point(center.x, i);
-			if (image.at<uchar>(currentPoint) != 0)
-			{
-				u = i;
-				break;
-			}
-		}
+		return Rect(l, u, r - l, d - u);
+	}
 
-		//for (int i = image.size().height - 1; i >= 0; --i)
-		//{
-		//	Point currentPoint = Point(center.x, i);
-		//	if (image.at<uchar>(currentPoint) != 0)
-		//	{
-		//		d = i;
-		//		break;
-		//	}
-		//}
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeProbeBand()
+	//
+	// Returns the rows or columns around the center of the specified length that
+	// the rectangle searches probe, rather than the single center row or column.
+	// A short image is probed along its center alone.
+	//////////////////////////////////////////////////////////////////////////////////
+	Range computeProbeBand(const int length)
+	{
+		const int center = length / 2;
+		const int halfWidth = static_cast<int>(length * PROBE_BAND_FRACTION / 2);
 
-		return Rect(l, u, r - l, d - u);
+		return Range(max(0, center - halfWidth), min(length, center + halfWidth + 1));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeProbeCoverage()
+	//
+	// Returns how many pixels of the specified probe band a line has to cover to be
+	// taken for an edge.
+	//////////////////////////////////////////////////////////////////////////////////
+	int computeProbeCoverage(const Range& band)
+	{
+		return max(1, static_cast<int>(ceil(band.size() * PROBE_COVERAGE_FRACTION)));
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////
@@ -275,13 +324,17 @@ namespace experimental
 	//
 	// Returns an image containing the largest horizontal lines found in the image.
 	//////////////////////////////////////////////////////////////////////////////////
-	Mat findLargestHorizontalLines(Mat image, const double percentOfWidth)
+	Mat findLargestHorizontalLines(Mat image, const double percentOfWidth, const LineDetectionMethod method)
 	{
 		Mat horizontalLines;
 
 		int minimumHorizontalLineSize = static_cast<int>(image.size().width * percentOfWidth);
+
+		if (method == LineDetectionMethod::RunLength)
+			return findHorizontalLinesByRunLength(image, minimumHorizontalLineSize, false);	// Matches the constant 0 border below.
+
 		auto horizElem = getStructuringElement(MORPH_RECT, Size(minimumHorizontalLineSize, 1));
-		morphologyEx(image, horizontalLines, MORPH_OPEN, horizElem, Point(-1,-1), 1, BORDER_CONSTANT, Scalar(0));
+		acceleratedMorphologyEx(image, horizontalLines, MORPH_OPEN, horizElem, Point(-1,-1), 1, BORDER_CONSTANT, Scalar(0));
 
 		return horizontalLines;
 	}
@@ -291,17 +344,142 @@ namespace experimental
 	//
 	// Returns an image containing the largest vertical lines found in the image.
 	//////////////////////////////////////////////////////////////////////////////////
-	Mat findLargestVerticalLines(Mat image, const double percentOfHeight)
+	Mat findLargestVerticalLines(Mat image, const double percentOfHeight, const LineDetectionMethod method)
 	{
 		Mat verticalLines;
 
 		int minimumVerticalLineSize = static_cast<int>(image.size().height * percentOfHeight);
+
+		if (method == LineDetectionMethod::RunLength)
+			return findVerticalLinesByRunLength(image, minimumVerticalLineSize, true);	// Matches the default morphology border below.
+
 		auto vertElem = getStructuringElement(MORPH_RECT, Size(1, minimumVerticalLineSize));
-		morphologyEx(image, verticalLines, MORPH_OPEN, vertElem);
+		acceleratedMorphologyEx(image, verticalLines, MORPH_OPEN, vertElem);
+
+		return verticalLines;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findHorizontalLinesByRunLength()
+	//
+	// Returns a mask of the pixels that opening the image with a horizontal line of
+	// the specified length would leave nonzero, found from the runs of nonzero
+	// pixels in a single pass instead of with morphology. If the outside of the
+	// image is foreground, runs touching the border are treated as continuing past
+	// it, as the default morphology border does.
+	//////////////////////////////////////////////////////////////////////////////////
+	Mat findHorizontalLinesByRunLength(Mat image, const int minimumLineLength, const bool isOutsideForeground)
+	{
+		CV_Assert(image.type() == CV_8UC1);
+
+		const int width = image.size().width;
+		Mat horizontalLines = Mat::zeros(image.size(), CV_8UC1);
+
+		for (int y = 0; y < image.size().height; ++y)
+		{
+			const uchar* row = image.ptr<uchar>(y);
+			uchar* linesRow = horizontalLines.ptr<uchar>(y);
+			int x = 0;
+
+			while (x < width)
+			{
+				int runStart = x + findFirstNonZero(row + x, width - x);
+				if (runStart == width)
+					break;
+
+				int runEnd = runStart;
+				while (runEnd + 1 < width && row[runEnd + 1] != 0)
+					++runEnd;
+
+				int openedStart, openedEnd;
+				if (computeOpenedRun(runStart, runEnd, width, minimumLineLength, isOutsideForeground, openedStart, openedEnd))
+					memset(linesRow + openedStart, 255, openedEnd - openedStart + 1);
+
+				x = runEnd + 1;
+			}
+		}
+
+		return horizontalLines;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findVerticalLinesByRunLength()
+	//
+	// Returns a mask of the pixels that opening the image with a vertical line of the
+	// specified length would leave nonzero, found from the runs of nonzero pixels in
+	// a single pass over the rows instead of with morphology. If the outside of the
+	// image is foreground, runs touching the border are treated as continuing past
+	// it, as the default morphology border does.
+	//////////////////////////////////////////////////////////////////////////////////
+	Mat findVerticalLinesByRunLength(Mat image, const int minimumLineLength, const bool isOutsideForeground)
+	{
+		CV_Assert(image.type() == CV_8UC1);
+
+		const int width = image.size().width;
+		const int height = image.size().height;
+		Mat verticalLines = Mat::zeros(image.size(), CV_8UC1);
+		vector<int> runStarts(width, -1);	// The row each column's current run of nonzero pixels started on, or -1.
+
+		// Walk the rows in order so the image is read sequentially; one row past the end closes any open runs.
+		for (int y = 0; y <= height; ++y)
+		{
+			const uchar* row = (y < height) ? image.ptr<uchar>(y) : nullptr;
+
+			for (int x = 0; x < width; ++x)
+			{
+				if (row != nullptr && row[x] != 0)
+				{
+					if (runStarts[x] < 0)
+						runStarts[x] = y;
+					continue;
+				}
+
+				if (runStarts[x] < 0)
+					continue;
+
+				int openedStart, openedEnd;
+				if (computeOpenedRun(runStarts[x], y - 1, height, minimumLineLength, isOutsideForeground, openedStart, openedEnd))
+				{
+					for (int i = openedStart; i <= openedEnd; ++i)
+						verticalLines.ptr<uchar>(i)[x] = 255;
+				}
+
+				runStarts[x] = -1;
+			}
+		}
 
 		return verticalLines;
 	}
 
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeOpenedRun()
+	//
+	// Compute which pixels of a run of nonzero pixels from runStart to runEnd stay
+	// nonzero after MORPH_OPEN with a line of the specified length, using the same
+	// anchor OpenCV uses. Returns false if none of them do.
+	//////////////////////////////////////////////////////////////////////////////////
+	bool computeOpenedRun(const int runStart, const int runEnd, const int lineLength, const int minimumLineLength, const bool isOutsideForeground, int& openedStart, int& openedEnd)
+	{
+		const int elementLength = max(1, minimumLineLength);
+		const int anchor = elementLength / 2;
+
+		// The erosion keeps the positions whose whole element lies in the run (or outside the image, if that counts as foreground).
+		int erodedStart = (isOutsideForeground && runStart == 0) ? 0 : runStart + anchor;
+		int erodedEnd = (isOutsideForeground && runEnd == lineLength - 1) ? lineLength - 1 : runEnd - (elementLength - 1 - anchor);
+
+		erodedStart = max(erodedStart, 0);
+		erodedEnd = min(erodedEnd, lineLength - 1);
+
+		if (erodedStart > erodedEnd)
+			return false;
+
+		// The dilation then grows what's left back out by the element.
+		openedStart = max(0, erodedStart + anchor - (elementLength - 1));
+		openedEnd = min(lineLength - 1, erodedEnd + anchor);
+
+		return true;
+	}
+
 	//////////////////////////////////////////////////////////////////////////////////
 	// computeForegroundImage()
 	//
@@ -339,11 +517,15 @@ namespace experimental
 	// computeForegroundImages()
 	//
 	// Computes a foreground images based on some background subtraction method.
+	// The model and mask stay on the device if the accelerator is enabled;
+	// otherwise the MOG2 instance is borrowed from BackgroundSubtractorPool.
 	//////////////////////////////////////////////////////////////////////////////////
 	vector<Mat> computeForegroundImages(const vector<Mat>& images)
 	{
 		Mat foregroundMask, foregroundImage, backgroundImage;
-		Ptr<BackgroundSubtractorMOG2> pMOG2 = createBackgroundSubtractorMOG2();
+		UMat deviceImage, deviceMask;
+		const bool isOnDevice = Accelerator::isEnabled();
+		Ptr<BackgroundSubtractorMOG2> pMOG2 = isOnDevice ? createBackgroundSubtractorMOG2() : autocropper::BackgroundSubtractorPool::acquire();
 
 		vector<Mat> foregroundImages;
 
@@ -354,19 +536,30 @@ namespace experimental
 			if (foregroundImage.empty())
 				foregroundImage.create(image.size(), image.type());
 
-			pMOG2->apply(image, foregroundMask);
+			if (isOnDevice)
+			{
+				image.copyTo(deviceImage);
+				pMOG2->apply(deviceImage, deviceMask, i == 0 ? 1 : -1);	// Learning rate 1 starts the model over from the first frame.
+				deviceMask.copyTo(foregroundMask);
+			}
+			else
+			{
+				pMOG2->apply(image, foregroundMask, i == 0 ? 1 : -1);
+			}
 
 			foregroundImage = Scalar::all(0);
 			image.copyTo(foregroundImage, foregroundMask);	//TODO: Does using the mask rather than the image improve the results?
 
-			string filename = utility::FileUtilities::buildFilename("TestImages/DEBUG/foreground/", ++i);
-			if (i > 1)	//TODO_DR: Deal with the first file.
+			if (++i > 1)	//TODO_DR: Deal with the first file.
 			{
-				imwrite(filename, foregroundImage);
+				DEBUG_IMWRITE(utility::FileUtilities::buildFilename("TestImages/DEBUG/foreground/", i), foregroundImage);
 				foregroundImages.push_back(foregroundImage.clone());
 			}
 		}
 
+		if (!isOnDevice)
+			autocropper::BackgroundSubtractorPool::release(pMOG2);
+
 		return foregroundImages;
 
 		waitKey();
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "BinaryMask.h"
+#include "MatPool.h"
+#include "ProjectionProfile.h"
 #include <opencv2/core.hpp>
 #include <vector>
 
@@ -10,15 +13,31 @@
 
 namespace experimental
 {
-	int computeRowWithMaximumBlackPixels(cv::Mat image);
+	// How findLargestHorizontalLines() and findLargestVerticalLines() find lines.
+	enum class LineDetectionMethod
+	{
+		Morphology,	// Open the image with a line shaped structuring element.
+		RunLength	// Keep runs of nonzero pixels that are long enough, in one pass.
+	};
+
+	int computeRowWithMaximumBlackPixels(cv::Mat image, const double searchFraction = 0.1);
 	cv::Rect computeMaximumRootExtents(cv::Mat image, const int startingY);
+	int computeRowWithMaximumBlackPixels(const OcvUtility::BinaryMask& mask, const double searchFraction = 0.1);
+	cv::Rect computeMaximumRootExtents(const OcvUtility::BinaryMask& mask, const int startingY);
+	int computeRowWithMaximumBlackPixels(const OcvUtility::ProjectionProfile& profile, const double searchFraction = 0.1);
+	cv::Rect computeMaximumRootExtents(const OcvUtility::ProjectionProfile& profile, const int startingY);
 	cv::Mat computeAverageImage(const std::vector<cv::Mat>& image);
-	cv::Mat computeGradientImage(cv::Mat image);
+	cv::Mat computeGradientImage(cv::Mat image, utility::MatPool* matPool = nullptr);
 	cv::Mat drawRedRectOnImage(cv::Mat image, cv::Rect rect, int thickness = 1);
 	cv::Rect computeInnermostRectangle(cv::Mat image);
 	cv::Rect computeOutermostRectangle(cv::Mat image);
-	cv::Mat findLargestHorizontalLines(cv::Mat image, const double percentOfWidth);
-	cv::Mat findLargestVerticalLines(cv::Mat image, const double PercentOfHeight);
+	cv::Range computeProbeBand(const int length);
+	int computeProbeCoverage(const cv::Range& band);
+	cv::Mat findLargestHorizontalLines(cv::Mat image, const double percentOfWidth, const LineDetectionMethod method = LineDetectionMethod::Morphology);
+	cv::Mat findLargestVerticalLines(cv::Mat image, const double PercentOfHeight, const LineDetectionMethod method = LineDetectionMethod::Morphology);
+	cv::Mat findHorizontalLinesByRunLength(cv::Mat image, const int minimumLineLength, const bool isOutsideForeground);
+	cv::Mat findVerticalLinesByRunLength(cv::Mat image, const int minimumLineLength, const bool isOutsideForeground);
+	bool computeOpenedRun(const int runStart, const int runEnd, const int lineLength, const int minimumLineLength, const bool isOutsideForeground, int& openedStart, int& openedEnd);
 	cv::Mat computeForegroundImage(const std::vector<cv::Mat>& images);
 	std::vector<cv::Mat> computeForegroundImages(const std::vector<cv::Mat>& images);
 	cv::Mat computeHistogram(cv::Mat image);
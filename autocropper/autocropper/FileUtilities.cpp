@@ -1,11 +1,22 @@
 #include "FileUtilities.h"
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
 #include <algorithm>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 using namespace utility;
 
+const string FileUtilities::PATH_SEPARATORS = "/\\";
+
 //////////////////////////////////////////////////////////////////////////////////
 // fileExists()
 //
@@ -17,6 +28,102 @@ bool FileUtilities::fileExists(const string& fileName)
 	return stat(fileName.c_str(), &buffer) == 0;
 }
 
+//////////////////////////////////////////////////////////////////////////////////
+// isDirectory()
+//
+// Returns true if the specified path exists and is a directory, false otherwise.
+//////////////////////////////////////////////////////////////////////////////////
+bool FileUtilities::isDirectory(const string& path)
+{
+	struct stat buffer;
+	return stat(path.c_str(), &buffer) == 0 && (buffer.st_mode & S_IFMT) == S_IFDIR;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// createDirectories()
+//
+// Create the specified directory along with any missing parent directories.
+// Returns true if the directory exists afterwards.
+//////////////////////////////////////////////////////////////////////////////////
+bool FileUtilities::createDirectories(const string& path)
+{
+	size_t separatorPosition = 0;
+
+	do
+	{
+		separatorPosition = path.find_first_of(PATH_SEPARATORS, separatorPosition + 1);
+		const string parentPath = path.substr(0, separatorPosition);
+
+		if (parentPath.empty() || isDirectory(parentPath))
+			continue;
+
+#ifdef _WIN32
+		_mkdir(parentPath.c_str());
+#else
+		mkdir(parentPath.c_str(), 0755);
+#endif
+	} while (separatorPosition != string::npos);
+
+	return isDirectory(path);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// listDirectory()
+//
+// Returns the names of the files in the specified directory, sorted by name.
+// Subdirectories are not included.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> FileUtilities::listDirectory(const string& directory)
+{
+	vector<string> fileNames;
+
+#ifdef _WIN32
+	_finddata_t fileInfo;
+	intptr_t handle = _findfirst(joinPath(directory, "*").c_str(), &fileInfo);
+
+	if (handle != -1)
+	{
+		do
+		{
+			if ((fileInfo.attrib & _A_SUBDIR) == 0)
+				fileNames.push_back(fileInfo.name);
+		} while (_findnext(handle, &fileInfo) == 0);
+
+		_findclose(handle);
+	}
+#else
+	DIR* directoryStream = opendir(directory.c_str());
+
+	if (directoryStream != nullptr)
+	{
+		while (dirent* entry = readdir(directoryStream))
+		{
+			if (!isDirectory(joinPath(directory, entry->d_name)))
+				fileNames.push_back(entry->d_name);
+		}
+
+		closedir(directoryStream);
+	}
+#endif
+
+	sort(fileNames.begin(), fileNames.end());
+
+	return fileNames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// joinPath()
+//
+// Returns the path of the specified file inside the specified directory.
+//////////////////////////////////////////////////////////////////////////////////
+string FileUtilities::joinPath(const string& directory, const string& fileName)
+{
+	if (directory.empty() || PATH_SEPARATORS.find(directory.back()) != string::npos)
+		return directory + fileName;
+
+	return directory + "/" + fileName;
+}
+
 //////////////////////////////////////////////////////////////////////////////////
 // buildFilename()
 //
@@ -29,3 +136,55 @@ string FileUtilities::buildFilename(const string& prefix, int number, const stri
 	ss << prefix << number << "." << filetype;
 	return ss.str();
 }
+
+//////////////////////////////////////////////////////////////////////////////////
+// buildTemporaryFilename()
+//
+// Returns a name next to the specified file that no other process or thread
+// writes to, for a file that is moved into place once it is complete. The
+// extension is kept, as OpenCV chooses the format of a file by it.
+// [name].[extension] becomes [name].[process id]-[thread id].tmp.[extension]
+//////////////////////////////////////////////////////////////////////////////////
+string FileUtilities::buildTemporaryFilename(const string& fileName)
+{
+	const size_t separatorPosition = fileName.find_last_of(PATH_SEPARATORS);
+	const size_t dotPosition = fileName.find_last_of('.');
+	const bool hasExtension = dotPosition != string::npos && (separatorPosition == string::npos || dotPosition > separatorPosition);
+	const string stem = hasExtension ? fileName.substr(0, dotPosition) : fileName;
+	const string extension = hasExtension ? fileName.substr(dotPosition) : "";
+
+#ifdef _WIN32
+	const int processId = _getpid();
+#else
+	const int processId = static_cast<int>(getpid());
+#endif
+
+	stringstream ss;
+	ss << stem << "." << processId << "-" << this_thread::get_id() << ".tmp" << extension;
+	return ss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// quoteCsv()
+//
+// Returns the specified text as one CSV field. Text holding a comma, a quote or
+// a line break is quoted, with each quote doubled; any other is left as it is.
+// Names and error messages are written through this, as either can hold any of
+// them.
+//////////////////////////////////////////////////////////////////////////////////
+string FileUtilities::quoteCsv(const string& field)
+{
+	if (field.find_first_of(",\"\r\n") == string::npos)
+		return field;
+
+	string quotedField = "\"";
+
+	for (char c : field)
+	{
+		if (c == '"')
+			quotedField += '"';
+		quotedField += c;
+	}
+
+	return quotedField + "\"";
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace utility
 {
@@ -13,6 +14,14 @@ namespace utility
 	{
 	public:
 		static bool fileExists(const std::string& fileName);
+		static bool isDirectory(const std::string& path);
+		static bool createDirectories(const std::string& path);
+		static std::vector<std::string> listDirectory(const std::string& directory);
+		static std::string joinPath(const std::string& directory, const std::string& fileName);
 		static std::string buildFilename(const std::string& prefix, int number, const std::string& filetype = "png");
+		static std::string buildTemporaryFilename(const std::string& fileName);
+		static std::string quoteCsv(const std::string& field);
+	private:
+		static const std::string PATH_SEPARATORS;	// Both separators are accepted, so paths can be written either way on Windows.
 	};
 }
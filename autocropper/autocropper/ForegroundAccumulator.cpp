@@ -0,0 +1,219 @@
+#include "ForegroundAccumulator.h"
+#include "Accelerator.h"
+#include "BackgroundSubtractorPool.h"
+#include "DebugImageSink.h"
+#include "FileUtilities.h"
+#include "OcvUtilities.h"
+#include <opencv2/core.hpp>
+#include <opencv2/video.hpp>
+
+using namespace autocropper;
+using namespace cv;
+using namespace OcvUtility;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ForegroundAccumulator()
+//
+// Create an accumulator with a fresh background model, which borrows its images
+// from the specified pool, if any. The accumulator stays on the device or the
+// CPU for its lifetime, since the background model can't be moved between them.
+// Device instances aren't pooled, as their model lives in device memory.
+//////////////////////////////////////////////////////////////////////////////////
+ForegroundAccumulator::ForegroundAccumulator(MatPool* matPool)
+	: _isOnDevice(Accelerator::isEnabled()),
+	_backgroundSubtractor(_isOnDevice ? createBackgroundSubtractorMOG2() : BackgroundSubtractorPool::acquire()),
+	_hasBackgroundModel(false),
+	_matPool(matPool),
+	_numberOfFramesProcessed(0),
+	_isForegroundUnionStale(false)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~ForegroundAccumulator()
+//
+// Give the MOG2 instance back to the pool for the next series.
+//////////////////////////////////////////////////////////////////////////////////
+ForegroundAccumulator::~ForegroundAccumulator()
+{
+	if (!_isOnDevice)
+		BackgroundSubtractorPool::release(_backgroundSubtractor);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// add()
+//
+// Update the background model with the specified frame and or its foreground
+// pixels straight into the running foreground union. The foreground image of the
+// frame is never built, and the specified frame is not kept.
+//////////////////////////////////////////////////////////////////////////////////
+void ForegroundAccumulator::add(const Mat& image)
+{
+	if (_isOnDevice)
+	{
+		addOnDevice(image);
+		return;
+	}
+
+	if (_foregroundMask.get().empty())
+		_foregroundMask = MatPool::acquire(_matPool, image.size(), CV_8UC1);	// apply() writes into it in place from then on.
+
+	applyBackgroundSubtractor(image, _foregroundMask.get());
+
+	if (++_numberOfFramesProcessed == 1)
+		return;	//TODO_DR: Deal with the first file. Everything is foreground until the model has seen a frame.
+
+	if (_packedUnion.empty())
+		_packedUnion = BinaryMask(image.size());
+
+	// A pixel joins the union where it is foreground and nonzero, as bitwise_or(union, image, union, mask) would set it.
+	_packedUnion.orNonZero(image, _foregroundMask.get());
+	_isForegroundUnionStale = true;
+
+	if (DEBUG_IMAGES_ENABLED())
+	{
+		Mat foregroundImage = Mat::zeros(image.size(), image.type());
+		image.copyTo(foregroundImage, _foregroundMask.get());
+		DEBUG_IMWRITE(FileUtilities::buildFilename("TestImages/DEBUG/foreground/", _numberOfFramesProcessed), foregroundImage);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// addOnDevice()
+//
+// add() with the frame uploaded once and the model, mask and union left on the
+// device.
+//////////////////////////////////////////////////////////////////////////////////
+void ForegroundAccumulator::addOnDevice(const Mat& image)
+{
+	image.copyTo(_deviceImage);
+	applyBackgroundSubtractor(_deviceImage, _deviceMask);
+
+	if (++_numberOfFramesProcessed == 1)
+		return;	//TODO_DR: Deal with the first file. Everything is foreground until the model has seen a frame.
+
+	if (_deviceUnion.empty())
+		_deviceUnion = UMat::zeros(image.size(), image.type());
+
+	bitwise_or(_deviceUnion, _deviceImage, _deviceUnion, _deviceMask);
+	_isForegroundUnionStale = true;
+
+	if (DEBUG_IMAGES_ENABLED())
+	{
+		Mat foregroundImage = Mat::zeros(image.size(), image.type());
+		image.copyTo(foregroundImage, _deviceMask);
+		DEBUG_IMWRITE(FileUtilities::buildFilename("TestImages/DEBUG/foreground/", _numberOfFramesProcessed), foregroundImage);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// warmUp()
+//
+// Update the background model with the specified frame without oring its
+// foreground into the union or counting it. Used to rebuild the model of a
+// restored series from its last frames.
+//////////////////////////////////////////////////////////////////////////////////
+void ForegroundAccumulator::warmUp(const Mat& image)
+{
+	if (_isOnDevice)
+	{
+		image.copyTo(_deviceImage);
+		applyBackgroundSubtractor(_deviceImage, _deviceMask);
+		return;
+	}
+
+	if (_foregroundMask.get().empty())
+		_foregroundMask = MatPool::acquire(_matPool, image.size(), CV_8UC1);
+
+	applyBackgroundSubtractor(image, _foregroundMask.get());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// applyBackgroundSubtractor()
+//
+// Update the background model with the specified frame. The first frame is
+// given learning rate 1, which makes MOG2 reinitialize its model from it, so a
+// reused instance gives the same masks as a new one.
+//////////////////////////////////////////////////////////////////////////////////
+void ForegroundAccumulator::applyBackgroundSubtractor(InputArray image, OutputArray foregroundMask)
+{
+	_backgroundSubtractor->apply(image, foregroundMask, _hasBackgroundModel ? -1 : 1);
+	_hasBackgroundModel = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// restore()
+//
+// Carry on from a saved foreground union of the specified number of frames.
+// Frames added from then on are ored into a copy of it. The background model is
+// not part of the union, so warm it up before adding more frames.
+//////////////////////////////////////////////////////////////////////////////////
+void ForegroundAccumulator::restore(const Mat& foregroundUnion, const int numberOfFramesProcessed)
+{
+	if (!foregroundUnion.empty() && _isOnDevice)
+	{
+		foregroundUnion.copyTo(_deviceUnion);
+		_isForegroundUnionStale = true;
+	}
+	else if (!foregroundUnion.empty())
+	{
+		_packedUnion = BinaryMask::pack(foregroundUnion);
+		_isForegroundUnionStale = true;
+	}
+
+	_numberOfFramesProcessed = numberOfFramesProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getForegroundUnion()
+//
+// Returns the or of the foreground images of every frame added so far. The
+// union is unpacked, or downloaded from the device, only if frames were added
+// since it last was.
+//////////////////////////////////////////////////////////////////////////////////
+const Mat& ForegroundAccumulator::getForegroundUnion() const
+{
+	if (_isForegroundUnionStale && _isOnDevice)
+	{
+		if (_foregroundUnion.get().empty())
+			_foregroundUnion = MatPool::acquire(_matPool, _deviceUnion.size(), _deviceUnion.type());
+
+		_deviceUnion.copyTo(_foregroundUnion.get());
+	}
+	else if (_isForegroundUnionStale)
+	{
+		if (_foregroundUnion.get().empty())
+			_foregroundUnion = MatPool::acquire(_matPool, _packedUnion.size(), CV_8UC1);
+
+		_packedUnion.unpack(_foregroundUnion.get());
+	}
+
+	_isForegroundUnionStale = false;
+
+	return _foregroundUnion.get();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeForegroundExtent()
+//
+// Returns the bounding box of the foreground union. On the CPU it is found from
+// the packed union, without unpacking it.
+//////////////////////////////////////////////////////////////////////////////////
+Rect ForegroundAccumulator::computeForegroundExtent() const
+{
+	if (_isOnDevice)
+		return computeNonZeroBoundingRect(getForegroundUnion());
+
+	return _packedUnion.computeBoundingRect();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfFramesProcessed()
+//
+// Returns the number of frames that have been added.
+//////////////////////////////////////////////////////////////////////////////////
+int ForegroundAccumulator::getNumberOfFramesProcessed() const
+{
+	return _numberOfFramesProcessed;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BinaryMask.h"
+#include "MatPool.h"
+#include <opencv2/core.hpp>
+#include <opencv2/video.hpp>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// ForegroundAccumulator
+	//
+	// Apply background subtraction to a series one frame at a time and keep a
+	// running or of the foreground images. Only the running image is kept, so
+	// peak memory doesn't grow with the length of the series. The mask and running
+	// image are borrowed from the specified pool if there is one. An accumulator
+	// can be restored from a saved foreground union, so a series can be extended
+	// without processing its earlier frames again. If the accelerator is enabled
+	// when the accumulator is created, the model, mask and running image live on
+	// the device for the whole series and the union is downloaded when asked for.
+	// On the CPU, the MOG2 instance is borrowed from BackgroundSubtractorPool, and
+	// the union is kept packed a bit per pixel and unpacked when asked for. Only
+	// whether a union pixel is zero matters to the crop region detection, so the
+	// union is a mask of 0s and 255s rather than the foreground pixel values.
+	//////////////////////////////////////////////////////////////////////////////////
+	class ForegroundAccumulator final
+	{
+	public:
+		explicit ForegroundAccumulator(utility::MatPool* matPool = nullptr);
+		~ForegroundAccumulator();
+
+		void add(const cv::Mat& image);
+		void warmUp(const cv::Mat& image);
+		void restore(const cv::Mat& foregroundUnion, const int numberOfFramesProcessed);
+		const cv::Mat& getForegroundUnion() const;
+		cv::Rect computeForegroundExtent() const;
+		int getNumberOfFramesProcessed() const;
+	private:
+		ForegroundAccumulator(const ForegroundAccumulator&) = delete;
+		ForegroundAccumulator& operator=(const ForegroundAccumulator&) = delete;
+
+		void addOnDevice(const cv::Mat& image);
+		void applyBackgroundSubtractor(cv::InputArray image, cv::OutputArray foregroundMask);
+
+		bool _isOnDevice;
+		cv::Ptr<cv::BackgroundSubtractorMOG2> _backgroundSubtractor;
+		bool _hasBackgroundModel;	// False until the model has seen a frame, so a reused instance starts over.
+		utility::MatPool* _matPool;
+		utility::MatPool::Lease _foregroundMask;
+		mutable utility::MatPool::Lease _foregroundUnion;	// Unpacked from _packedUnion, or downloaded from _deviceUnion, when it's asked for.
+		OcvUtility::BinaryMask _packedUnion;
+		int _numberOfFramesProcessed;
+		cv::UMat _deviceImage;
+		cv::UMat _deviceMask;
+		cv::UMat _deviceUnion;
+		mutable bool _isForegroundUnionStale;
+	};
+}
@@ -1,8 +1,14 @@
 #include "ImageReader.h"
 #include "FileUtilities.h"
+#include "SeriesIndex.h"
+#include "ThreadPool.h"
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -13,40 +19,241 @@ using namespace std;
 using namespace utility;
 
 const string ImageReader::FILENAME_DELIMETER = "_";
+const vector<string> ImageReader::IMAGE_EXTENSIONS = { "bmp", "dib", "jpeg", "jpg", "jpe", "jp2", "png", "webp", "pbm", "pgm", "ppm", "pxm", "pnm", "sr", "ras", "tiff", "tif", "exr", "hdr", "pic" };
 
 //////////////////////////////////////////////////////////////////////////////////
 // readDataset()
 //
 // Read the dataset beginning with the specified starting file.
+// The images are decoded concurrently on a thread pool sized to the machine.
 //////////////////////////////////////////////////////////////////////////////////
 vector<Mat> ImageReader::readDataset(const string& startingImageFilename)
 {
+	ThreadPool threadPool;
+
+	return readDataset(startingImageFilename, threadPool);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readDataset()
+//
+// Read the dataset beginning with the specified starting file, decoding the
+// images on the specified thread pool. The images are returned in frame order;
+// frames that could not be read are left out.
+//////////////////////////////////////////////////////////////////////////////////
+vector<Mat> ImageReader::readDataset(const string& startingImageFilename, ThreadPool& threadPool)
+{
+	return readImages(getDatasetFilenames(startingImageFilename), threadPool);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readImages()
+//
+// Read the specified images, decoding them on the specified thread pool. The
+// images are returned in the order of the filenames; images that could not be
+// read are left out.
+//////////////////////////////////////////////////////////////////////////////////
+vector<Mat> ImageReader::readImages(const vector<string>& filenames, ThreadPool& threadPool)
+{
+	vector<future<Mat>> pendingImages;
+
+	for (const auto& filename : filenames)
+	{
+		pendingImages.push_back(threadPool.submit([filename]() { return readImage(filename); }));
+	}
+
 	vector<Mat> images;
 
-	string filename = startingImageFilename;
-	string filenameSuffix = startingImageFilename.substr(startingImageFilename.find_last_of("."));
-	string filenamePrefix = startingImageFilename.substr(0, startingImageFilename.find_first_of(FILENAME_DELIMETER) + 1);
-	int fileNumber = 1;
+	for (auto& pendingImage : pendingImages)
+	{
+		Mat image = pendingImage.get();
+
+		if (!image.empty())
+			images.push_back(image);
+	}
+
+	cout << "Number of images read: " << images.size() << endl;
+
+	return images;
+}
 
-	while (fileNumber <= NUMBER_OF_IMAGES_IN_SERIES)
+//////////////////////////////////////////////////////////////////////////////////
+// readDatasetAsync()
+//
+// Queue the decode of every image in the dataset on the specified thread pool and
+// return the pending images in frame order. Frames are queued first to last, so
+// the caller can start working on the first frames while later ones are still
+// being decoded. A frame that could not be read resolves to an empty Mat.
+//////////////////////////////////////////////////////////////////////////////////
+vector<future<Mat>> ImageReader::readDatasetAsync(const string& startingImageFilename, ThreadPool& threadPool)
+{
+	vector<future<Mat>> pendingImages;
+
+	for (const auto& filename : getDatasetFilenames(startingImageFilename))
+	{
+		pendingImages.push_back(threadPool.submit([filename]() { return readImage(filename); }));
+	}
+
+	return pendingImages;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// streamDataset()
+//
+// Read the dataset beginning with the specified starting file and hand each image
+// to the specified function in frame order, without keeping the whole dataset in
+// memory. At most the specified number of images are decoded ahead of the one
+// being processed. Returns the number of images that were read.
+//////////////////////////////////////////////////////////////////////////////////
+int ImageReader::streamDataset(const string& startingImageFilename, ThreadPool& threadPool, const function<void(const Mat&)>& processImage, const unsigned int maximumImagesInFlight)
+{
+	return streamImages(getDatasetFilenames(startingImageFilename), threadPool, [&processImage](size_t, const Mat& image) { processImage(image); }, maximumImagesInFlight);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// streamImages()
+//
+// Read the specified images and hand each one, with its index in the specified
+// filenames, to the specified function in order. At most the specified number
+// of images are decoded ahead of the one being processed. Images that could not
+// be read are skipped. Returns the number of images that were read.
+//////////////////////////////////////////////////////////////////////////////////
+int ImageReader::streamImages(const vector<string>& filenames, ThreadPool& threadPool, const function<void(size_t, const Mat&)>& processImage, const unsigned int maximumImagesInFlight)
+{
+	deque<future<Mat>> pendingImages;
+	size_t nextFilenameIndex = 0;
+	int numberOfImagesRead = 0;
+
+	while (nextFilenameIndex < filenames.size() || !pendingImages.empty())
 	{
-		if (!FileUtilities::fileExists(filename))
+		while (nextFilenameIndex < filenames.size() && pendingImages.size() < max(1u, maximumImagesInFlight))
 		{
-			cerr << "File not found: " << filename << endl;
+			const string filename = filenames[nextFilenameIndex++];
+			pendingImages.push_back(threadPool.submit([filename]() { return readImage(filename); }));
 		}
-		else
-		{
-			Mat image = imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
 
-			images.push_back(image);
-		}
+		const size_t imageIndex = nextFilenameIndex - pendingImages.size();
+		Mat image = pendingImages.front().get();
+		pendingImages.pop_front();
 
-		filename = filenamePrefix + getFormattedFileNumber(++fileNumber) + filenameSuffix;
+		if (!image.empty())
+		{
+			processImage(imageIndex, image);
+			++numberOfImagesRead;
+		}
 	}
 
-	cout << "Number of images read: " << images.size() << endl;
+	cout << "Number of images read: " << numberOfImagesRead << endl;
 
-	return images;
+	return numberOfImagesRead;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getDatasetFilenames()
+//
+// Returns the filenames of every image in the dataset beginning with the
+// specified starting file, in frame order, as a SeriesIndex finds them: every
+// frame that exists, however many there are and however they are numbered.
+// The directory is listed afresh, so frames that arrived since the last call
+// are picked up wherever they fall. Throws if two frames have the same image
+// number.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> ImageReader::getDatasetFilenames(const string& startingImageFilename)
+{
+	SeriesIndex seriesIndex;
+
+	return seriesIndex.getFilenames(startingImageFilename);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSeriesName()
+//
+// Returns the name shared by every image in the dataset: the file name of the
+// specified starting file without its directory, delimeter and image number.
+//////////////////////////////////////////////////////////////////////////////////
+string ImageReader::getSeriesName(const string& startingImageFilename)
+{
+	const size_t directoryEnd = startingImageFilename.find_last_of("/\\");
+	const string filename = (directoryEnd == string::npos) ? startingImageFilename : startingImageFilename.substr(directoryEnd + 1);
+
+	return filename.substr(0, filename.find_last_of(FILENAME_DELIMETER));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getImageNumber()
+//
+// Returns the image number of the specified file, e.g. 12 for [Prefix]_012.png,
+// or 0 if it isn't named like an image of a dataset.
+//////////////////////////////////////////////////////////////////////////////////
+int ImageReader::getImageNumber(const string& imageFilename)
+{
+	const size_t numberStart = imageFilename.find_last_of(FILENAME_DELIMETER) + 1;
+	const size_t extensionStart = imageFilename.find_last_of(".");
+
+	if (numberStart == 0 || extensionStart == string::npos || extensionStart <= numberStart)
+		return 0;
+
+	const string number = imageFilename.substr(numberStart, extensionStart - numberStart);
+
+	if (number.find_first_not_of("0123456789") != string::npos)
+		return 0;
+
+	return atoi(number.c_str());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isStartingImageFilename()
+//
+// Returns true if the specified file is named like the first image of a dataset,
+// e.g. [Prefix]_001.png.
+//////////////////////////////////////////////////////////////////////////////////
+bool ImageReader::isStartingImageFilename(const string& filename)
+{
+	const string startingSuffix = FILENAME_DELIMETER + getFormattedFileNumber(1) + ".";
+	const size_t extensionStart = filename.find_last_of(".");
+
+	if (extensionStart == string::npos || extensionStart + 1 < startingSuffix.size())
+		return false;
+
+	return filename.compare(extensionStart + 1 - startingSuffix.size(), startingSuffix.size(), startingSuffix) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isImageFilename()
+//
+// Returns true if the specified file has the extension of a format readImage()
+// can decode, in any case.
+//////////////////////////////////////////////////////////////////////////////////
+bool ImageReader::isImageFilename(const string& filename)
+{
+	const size_t extensionStart = filename.find_last_of(".");
+	const size_t directoryEnd = filename.find_last_of("/\\");
+
+	if (extensionStart == string::npos || (directoryEnd != string::npos && extensionStart < directoryEnd))
+		return false;
+
+	string extension = filename.substr(extensionStart + 1);
+	transform(extension.begin(), extension.end(), extension.begin(), [](const char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+
+	return find(IMAGE_EXTENSIONS.begin(), IMAGE_EXTENSIONS.end(), extension) != IMAGE_EXTENSIONS.end();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// readImage()
+//
+// Decode a single image as grayscale. Returns an empty Mat if the file is
+// missing or cannot be decoded, so no separate existence check is needed.
+//////////////////////////////////////////////////////////////////////////////////
+Mat ImageReader::readImage(const string& filename)
+{
+	Mat image = imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+
+	if (image.empty())
+	{
+		cerr << "File not found: " << filename << endl;
+	}
+
+	return image;
 }
 
 //////////////////////////////////////////////////////////////////////////////////
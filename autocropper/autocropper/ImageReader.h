@@ -1,6 +1,9 @@
 #pragma once
 
+#include "ThreadPool.h"
 #include <opencv2/core.hpp>
+#include <functional>
+#include <future>
 #include <string>
 #include <vector>
 
@@ -16,11 +19,22 @@ namespace autocropper
 	{
 	public:
 		static std::vector<cv::Mat> readDataset(const std::string& startingImageFilename);
+		static std::vector<cv::Mat> readDataset(const std::string& startingImageFilename, utility::ThreadPool& threadPool);
+		static std::vector<cv::Mat> readImages(const std::vector<std::string>& filenames, utility::ThreadPool& threadPool);
+		static std::vector<std::future<cv::Mat>> readDatasetAsync(const std::string& startingImageFilename, utility::ThreadPool& threadPool);
+		static int streamDataset(const std::string& startingImageFilename, utility::ThreadPool& threadPool, const std::function<void(const cv::Mat&)>& processImage, const unsigned int maximumImagesInFlight);
+		static int streamImages(const std::vector<std::string>& filenames, utility::ThreadPool& threadPool, const std::function<void(size_t, const cv::Mat&)>& processImage, const unsigned int maximumImagesInFlight);
+		static std::vector<std::string> getDatasetFilenames(const std::string& startingImageFilename);
+		static std::string getSeriesName(const std::string& startingImageFilename);
+		static int getImageNumber(const std::string& imageFilename);
+		static bool isStartingImageFilename(const std::string& filename);
+		static bool isImageFilename(const std::string& filename);
+		static cv::Mat readImage(const std::string& filename);
 	private:
 		static std::string getFormattedFileNumber(const int fileNumber);
 
 		static const std::string FILENAME_DELIMETER;		// Files are expected to be named in the following format: [Prefix][Delimeter][Image Number].[File Extension]
-		static const int NUMBER_OF_DIGITS_IN_FILENAME = 3;	// Expected file names range from 001.png to 999.png
-		static const int NUMBER_OF_IMAGES_IN_SERIES = 72;	// There should always be 72 in the input image series.
+		static const std::vector<std::string> IMAGE_EXTENSIONS;	// The extensions, in lower case, of the formats imread() decodes.
+		static const int NUMBER_OF_DIGITS_IN_FILENAME = 3;	// Starting files are named [Prefix]_001.png; later frames may be numbered with any number of digits.
 	};
 }
@@ -0,0 +1,194 @@
+#include "IncrementalSeries.h"
+#include "CropPipeline.h"
+#include "FileUtilities.h"
+#include "ImageReader.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+const string IncrementalSeries::FOREGROUND_UNION_FILENAME = "foregroundUnion.png";
+
+//////////////////////////////////////////////////////////////////////////////////
+// IncrementalSeries()
+//
+// Create an empty series beginning with the specified starting file. Nothing is
+// read until the series is loaded or updated. Throws if the options ask for a
+// static background model, which needs every frame at once.
+//////////////////////////////////////////////////////////////////////////////////
+IncrementalSeries::IncrementalSeries(const string& startingFilename, const CropRegionOptions& options, MatPool* matPool)
+	: _startingFilename(startingFilename),
+	_options(options),
+	_matPool(matPool),
+	_foregroundAccumulator(matPool),
+	_numberOfForegroundPixels(0)
+{
+	if (options.backgroundModel != BackgroundModel::Mog2)
+		throw invalid_argument("A static background needs the whole series; only the MOG2 background model can be updated incrementally.");
+
+	_sidecar.seriesName = ImageReader::getSeriesName(startingFilename);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// load()
+//
+// Restore the series from the specified state directory and warm up the
+// background model on its last frames. Returns false, leaving the series empty,
+// if there is no saved state. Throws if the state belongs to another series or
+// can't be read.
+//////////////////////////////////////////////////////////////////////////////////
+bool IncrementalSeries::load(const string& stateDirectory, ThreadPool& threadPool)
+{
+	const string sidecarFilename = FileUtilities::joinPath(stateDirectory, CropSidecar::DEFAULT_FILENAME);
+
+	if (!FileUtilities::fileExists(sidecarFilename))
+		return false;
+
+	CropSidecar sidecar = CropSidecar::read(sidecarFilename);
+
+	if (sidecar.seriesName != _sidecar.seriesName)
+		throw runtime_error("Saved state in " + stateDirectory + " is for series " + sidecar.seriesName + ", not " + _sidecar.seriesName);
+
+	const string foregroundUnionFilename = FileUtilities::joinPath(stateDirectory, FOREGROUND_UNION_FILENAME);
+	Mat foregroundUnion;
+
+	if (sidecar.sourceFilenames.size() > 1)
+	{
+		foregroundUnion = imread(foregroundUnionFilename, IMREAD_GRAYSCALE);
+
+		if (foregroundUnion.empty())
+			throw runtime_error("Unable to read saved foreground union: " + foregroundUnionFilename);
+	}
+
+	_sidecar = sidecar;
+	_foregroundAccumulator.restore(foregroundUnion, static_cast<int>(_sidecar.sourceFilenames.size()));
+	_numberOfForegroundPixels = foregroundUnion.empty() ? 0 : countNonZero(foregroundUnion);
+
+	const size_t numberOfWarmUpFrames = min(_sidecar.sourceFilenames.size(), static_cast<size_t>(WARM_UP_FRAMES));
+	const vector<string> warmUpFilenames(_sidecar.sourceFilenames.end() - numberOfWarmUpFrames, _sidecar.sourceFilenames.end());
+
+	ImageReader::streamImages(warmUpFilenames, threadPool, [this](size_t, const Mat& image) { _foregroundAccumulator.warmUp(image); }, STREAMING_IMAGES_IN_FLIGHT);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// save()
+//
+// Write the state of the series to the specified directory, which must exist.
+// Throws if it can't be written.
+//////////////////////////////////////////////////////////////////////////////////
+void IncrementalSeries::save(const string& stateDirectory) const
+{
+	const Mat& foregroundUnion = _foregroundAccumulator.getForegroundUnion();
+	const string foregroundUnionFilename = FileUtilities::joinPath(stateDirectory, FOREGROUND_UNION_FILENAME);
+
+	if (!foregroundUnion.empty() && !imwrite(foregroundUnionFilename, foregroundUnion))
+		throw runtime_error("Unable to write foreground union: " + foregroundUnionFilename);
+
+	_sidecar.write(FileUtilities::joinPath(stateDirectory, CropSidecar::DEFAULT_FILENAME));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// update()
+//
+// Add every frame of the series that exists and hasn't been processed yet, in
+// frame order, then update the crop region if the foreground union grew.
+// Returns the filenames of the frames that were added.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> IncrementalSeries::update(ThreadPool& threadPool, StageProfiler* profiler)
+{
+	const set<string> processedFilenames(_sidecar.sourceFilenames.begin(), _sidecar.sourceFilenames.end());
+	vector<string> newFilenames;
+	vector<string> addedFilenames;
+
+	for (const auto& filename : ImageReader::getDatasetFilenames(_startingFilename))
+	{
+		if (processedFilenames.count(filename) == 0)
+			newFilenames.push_back(filename);
+	}
+
+	if (newFilenames.empty())
+		return addedFilenames;
+
+	{
+		StageProfiler::ScopedStage stage(profiler, "updateForegroundUnion");
+
+		ImageReader::streamImages(newFilenames, threadPool, [this, &stage, &newFilenames, &addedFilenames](size_t imageIndex, const Mat& image)
+		{
+			stage.addImage(image);
+			_foregroundAccumulator.add(image);
+			addedFilenames.push_back(newFilenames[imageIndex]);
+		}, STREAMING_IMAGES_IN_FLIGHT);
+	}
+
+	// Keep the frames in frame order, so the last ones are the ones a later load warms up on.
+	_sidecar.sourceFilenames.insert(_sidecar.sourceFilenames.end(), addedFilenames.begin(), addedFilenames.end());
+	sort(_sidecar.sourceFilenames.begin(), _sidecar.sourceFilenames.end(), [](const string& a, const string& b) { return ImageReader::getImageNumber(a) < ImageReader::getImageNumber(b); });
+
+	updateCropRegion(profiler);
+
+	return addedFilenames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getCropRegion()
+//
+// Returns the region of the root system in the frames processed so far.
+//////////////////////////////////////////////////////////////////////////////////
+Rect IncrementalSeries::getCropRegion() const
+{
+	return _sidecar.cropRegion;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSidecar()
+//
+// Returns the sidecar of the frames processed so far.
+//////////////////////////////////////////////////////////////////////////////////
+const CropSidecar& IncrementalSeries::getSidecar() const
+{
+	return _sidecar;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfFramesProcessed()
+//
+// Returns the number of frames whose foreground is in the union.
+//////////////////////////////////////////////////////////////////////////////////
+int IncrementalSeries::getNumberOfFramesProcessed() const
+{
+	return _foregroundAccumulator.getNumberOfFramesProcessed();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// updateCropRegion()
+//
+// Find the crop region again, but only if the foreground union has gained
+// pixels since it was last found. computeCropRegion() modifies its image, so it
+// works on a copy of the union.
+//////////////////////////////////////////////////////////////////////////////////
+void IncrementalSeries::updateCropRegion(StageProfiler* profiler)
+{
+	const Mat& foregroundUnion = _foregroundAccumulator.getForegroundUnion();
+
+	if (foregroundUnion.empty())
+		return;
+
+	const int numberOfForegroundPixels = countNonZero(foregroundUnion);
+
+	if (numberOfForegroundPixels == _numberOfForegroundPixels && _sidecar.cropRegion.area() > 0)
+		return;
+
+	MatPool::Lease workingImage = MatPool::acquire(_matPool, foregroundUnion.size(), foregroundUnion.type());
+	foregroundUnion.copyTo(workingImage.get());
+
+	_sidecar.cropRegion = computeCropRegion(workingImage.get(), _options, _matPool, profiler, &_sidecar.gelRegion);
+	_numberOfForegroundPixels = numberOfForegroundPixels;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CropPipeline.h"
+#include "CropSidecar.h"
+#include "ForegroundAccumulator.h"
+#include "MatPool.h"
+#include "StageProfiler.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// IncrementalSeries
+	//
+	// A series whose foreground union and crop region are kept between runs, so
+	// frames that arrive late or extend the series only cost their own background
+	// subtraction. The state is a CropSidecar of the frames processed so far and
+	// the foreground union of those frames.
+	//
+	// OpenCV doesn't expose the mixture model of BackgroundSubtractorMOG2, so a
+	// loaded series rebuilds its background model from its last WARM_UP_FRAMES
+	// frames. Frames added after loading are therefore subtracted against a model
+	// of the recent frames rather than of every earlier frame.
+	//////////////////////////////////////////////////////////////////////////////////
+	class IncrementalSeries final
+	{
+	public:
+		IncrementalSeries(const std::string& startingFilename, const CropRegionOptions& options = CropRegionOptions(), utility::MatPool* matPool = nullptr);
+
+		bool load(const std::string& stateDirectory, utility::ThreadPool& threadPool);
+		void save(const std::string& stateDirectory) const;
+		std::vector<std::string> update(utility::ThreadPool& threadPool, utility::StageProfiler* profiler = nullptr);
+
+		cv::Rect getCropRegion() const;
+		const CropSidecar& getSidecar() const;
+		int getNumberOfFramesProcessed() const;
+
+		static const int WARM_UP_FRAMES = 8;
+		static const std::string FOREGROUND_UNION_FILENAME;
+	private:
+		IncrementalSeries(const IncrementalSeries&) = delete;
+		IncrementalSeries& operator=(const IncrementalSeries&) = delete;
+
+		void updateCropRegion(utility::StageProfiler* profiler);
+
+		std::string _startingFilename;
+		CropRegionOptions _options;
+		utility::MatPool* _matPool;
+		ForegroundAccumulator _foregroundAccumulator;
+		CropSidecar _sidecar;
+		int _numberOfForegroundPixels;	// The union only ever grows, so an unchanged count means an unchanged crop region.
+	};
+}
@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// MappedFile()
+//
+// Map the whole of the specified file. Throws if it can't be opened or mapped,
+// or is empty.
+//////////////////////////////////////////////////////////////////////////////////
+MappedFile::MappedFile(const string& filename)
+	: _filename(filename),
+	_data(nullptr),
+	_size(0)
+{
+#ifdef _WIN32
+	_mappingHandle = nullptr;
+	_fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_fileHandle == INVALID_HANDLE_VALUE)
+		throw runtime_error("Unable to open file: " + filename);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(_fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(_fileHandle);
+		throw runtime_error("Unable to map empty file: " + filename);
+	}
+
+	_size = static_cast<size_t>(fileSize.QuadPart);
+	_mappingHandle = CreateFileMappingA(_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mappingHandle != nullptr)
+		_data = static_cast<const unsigned char*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+	if (_data == nullptr)
+	{
+		if (_mappingHandle != nullptr)
+			CloseHandle(_mappingHandle);
+		CloseHandle(_fileHandle);
+		throw runtime_error("Unable to map file: " + filename);
+	}
+#else
+	_fileDescriptor = open(filename.c_str(), O_RDONLY);
+	if (_fileDescriptor < 0)
+		throw runtime_error("Unable to open file: " + filename);
+
+	struct stat buffer;
+	if (fstat(_fileDescriptor, &buffer) != 0 || buffer.st_size == 0)
+	{
+		close(_fileDescriptor);
+		throw runtime_error("Unable to map empty file: " + filename);
+	}
+
+	_size = static_cast<size_t>(buffer.st_size);
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fileDescriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		close(_fileDescriptor);
+		throw runtime_error("Unable to map file: " + filename);
+	}
+
+	_data = static_cast<const unsigned char*>(data);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~MappedFile()
+//
+// Unmap and close the file. Views of its data must not outlive it.
+//////////////////////////////////////////////////////////////////////////////////
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+	CloseHandle(_mappingHandle);
+	CloseHandle(_fileHandle);
+#else
+	munmap(const_cast<unsigned char*>(_data), _size);
+	close(_fileDescriptor);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getData()
+//
+// Returns the start of the mapped file.
+//////////////////////////////////////////////////////////////////////////////////
+const unsigned char* MappedFile::getData() const
+{
+	return _data;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSize()
+//
+// Returns the size of the file in bytes.
+//////////////////////////////////////////////////////////////////////////////////
+size_t MappedFile::getSize() const
+{
+	return _size;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFilename()
+//
+// Returns the name of the mapped file.
+//////////////////////////////////////////////////////////////////////////////////
+const string& MappedFile::getFilename() const
+{
+	return _filename;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// MappedFile
+	//
+	// A file mapped read only into memory for the lifetime of the object. Pages
+	// are read from disk by the OS when they are first touched, so opening even a
+	// large file costs one open and one map.
+	//////////////////////////////////////////////////////////////////////////////////
+	class MappedFile final
+	{
+	public:
+		explicit MappedFile(const std::string& filename);
+		~MappedFile();
+
+		const unsigned char* getData() const;
+		size_t getSize() const;
+		const std::string& getFilename() const;
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		std::string _filename;
+		const unsigned char* _data;
+		size_t _size;
+#ifdef _WIN32
+		void* _fileHandle;
+		void* _mappingHandle;
+#else
+		int _fileDescriptor;
+#endif
+	};
+}
@@ -0,0 +1,273 @@
+#include "MatPool.h"
+#include <opencv2/core.hpp>
+#include <utility>
+
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+// VS2013 has no thread_local, but its own thread storage holds a plain pointer.
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL thread_local
+#endif
+
+namespace
+{
+	THREAD_LOCAL size_t* threadAllocationCounter = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Lease()
+//
+// Create an empty lease, which holds no buffer.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease::Lease()
+	: _matPool(nullptr)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Lease()
+//
+// Hold the specified buffer until the lease ends, then give it back to the
+// specified pool. If the pool is null the buffer is simply released.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease::Lease(MatPool* matPool, Mat buffer)
+	: _matPool(matPool),
+	_buffer(buffer)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Lease()
+//
+// Take over the buffer of the specified lease, leaving it empty.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease::Lease(Lease&& other)
+	: _matPool(other._matPool),
+	_buffer(other._buffer)
+{
+	other._matPool = nullptr;
+	other._buffer.release();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// operator=()
+//
+// Give back the current buffer, then take over the buffer of the specified
+// lease, leaving it empty.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease& MatPool::Lease::operator=(Lease&& other)
+{
+	if (this != &other)
+	{
+		reset();
+
+		_matPool = other._matPool;
+		_buffer = other._buffer;
+
+		other._matPool = nullptr;
+		other._buffer.release();
+	}
+
+	return *this;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~Lease()
+//
+// Give the buffer back to the pool.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease::~Lease()
+{
+	reset();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// get()
+//
+// Returns the borrowed buffer.
+//////////////////////////////////////////////////////////////////////////////////
+Mat& MatPool::Lease::get()
+{
+	return _buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// get()
+//
+// Returns the borrowed buffer.
+//////////////////////////////////////////////////////////////////////////////////
+const Mat& MatPool::Lease::get() const
+{
+	return _buffer;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// reset()
+//
+// Give the buffer back to the pool now, leaving the lease empty.
+//////////////////////////////////////////////////////////////////////////////////
+void MatPool::Lease::reset()
+{
+	if (_matPool != nullptr)
+		_matPool->release(_buffer);
+
+	_matPool = nullptr;
+	_buffer.release();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// MatPool()
+//
+// Create an empty pool.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::MatPool()
+	: _numberOfAllocations(0),
+	_numberOfBytesAllocated(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// acquire()
+//
+// Borrow a buffer of the specified size and type, allocating one only if the
+// pool has none free.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease MatPool::acquire(const Size size, const int type)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+
+		auto freeBuffers = _freeBuffers.find(BufferKey(size.height, size.width, type));
+		if (freeBuffers != _freeBuffers.end() && !freeBuffers->second.empty())
+		{
+			Mat buffer = freeBuffers->second.back();
+			freeBuffers->second.pop_back();
+
+			return Lease(this, buffer);
+		}
+
+		++_numberOfAllocations;
+		_numberOfBytesAllocated += static_cast<size_t>(size.area()) * CV_ELEM_SIZE(type);
+	}
+
+	countThreadAllocation(size, type);
+
+	return Lease(this, Mat(size, type));	// Allocate outside the lock.
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// acquire()
+//
+// Borrow a buffer from the specified pool, or allocate a plain one if the pool is
+// null, so that stages can take an optional pool.
+//////////////////////////////////////////////////////////////////////////////////
+MatPool::Lease MatPool::acquire(MatPool* matPool, const Size size, const int type)
+{
+	if (matPool == nullptr)
+	{
+		countThreadAllocation(size, type);
+		return Lease(nullptr, Mat(size, type));
+	}
+
+	return matPool->acquire(size, type);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// clear()
+//
+// Free every buffer that isn't currently borrowed.
+//////////////////////////////////////////////////////////////////////////////////
+void MatPool::clear()
+{
+	lock_guard<mutex> lock(_mutex);
+	_freeBuffers.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfAllocations()
+//
+// Returns the number of buffers the pool has had to allocate. Once the pool is
+// warmed up this stops growing.
+//////////////////////////////////////////////////////////////////////////////////
+size_t MatPool::getNumberOfAllocations() const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _numberOfAllocations;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfBytesAllocated()
+//
+// Returns the total size of the buffers the pool has had to allocate.
+//////////////////////////////////////////////////////////////////////////////////
+size_t MatPool::getNumberOfBytesAllocated() const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _numberOfBytesAllocated;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfFreeBuffers()
+//
+// Returns the number of buffers waiting to be borrowed.
+//////////////////////////////////////////////////////////////////////////////////
+size_t MatPool::getNumberOfFreeBuffers() const
+{
+	lock_guard<mutex> lock(_mutex);
+
+	size_t numberOfFreeBuffers = 0;
+	for (const auto& freeBuffers : _freeBuffers)
+	{
+		numberOfFreeBuffers += freeBuffers.second.size();
+	}
+
+	return numberOfFreeBuffers;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// setThreadAllocationCounter()
+//
+// Add the bytes of every buffer the calling thread allocates from now on, from
+// any pool or none, to the specified counter, or stop counting them if it is
+// null. Buffers reused from a pool aren't counted. Returns the counter that was
+// set before, so that it can be restored.
+//////////////////////////////////////////////////////////////////////////////////
+size_t* MatPool::setThreadAllocationCounter(size_t* numberOfBytes)
+{
+	size_t* previousNumberOfBytes = threadAllocationCounter;
+	threadAllocationCounter = numberOfBytes;
+
+	return previousNumberOfBytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// countThreadAllocation()
+//
+// Add a buffer of the specified size and type to the counter of the calling
+// thread, if it has one.
+//////////////////////////////////////////////////////////////////////////////////
+void MatPool::countThreadAllocation(const Size size, const int type)
+{
+	if (threadAllocationCounter != nullptr)
+		*threadAllocationCounter += static_cast<size_t>(size.area()) * CV_ELEM_SIZE(type);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// release()
+//
+// Take the specified buffer back. A buffer that something else still refers to
+// (e.g. a region of it was returned to the caller), or that was reallocated by
+// its borrower, is left to be freed normally rather than handed out again.
+//////////////////////////////////////////////////////////////////////////////////
+void MatPool::release(Mat& buffer)
+{
+	if (buffer.empty() || buffer.isSubmatrix() || buffer.u == nullptr || buffer.u->refcount != 1)
+		return;
+
+	lock_guard<mutex> lock(_mutex);
+	_freeBuffers[BufferKey(buffer.rows, buffer.cols, buffer.type())].push_back(buffer);
+}
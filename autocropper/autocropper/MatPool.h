@@ -0,0 +1,76 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// MatPool
+	//
+	// Buffers for the per-frame images of the pipeline, kept by size and type so
+	// that once every stage has seen an image of a given size, later series reuse
+	// the same memory instead of allocating it again. Buffers are borrowed as a
+	// Lease, which gives the buffer back when it goes out of scope. Borrowed
+	// buffers hold whatever their previous borrower left in them. The pool may be
+	// shared between threads. What each thread allocates, from any pool or none,
+	// can be counted on its own, so a stage sharing a pool with other threads is
+	// only charged for its own buffers.
+	//////////////////////////////////////////////////////////////////////////////////
+	class MatPool final
+	{
+	public:
+		//////////////////////////////////////////////////////////////////////////////////
+		// Lease
+		//
+		// A buffer borrowed from a MatPool. A lease without a pool owns a plain Mat.
+		//////////////////////////////////////////////////////////////////////////////////
+		class Lease final
+		{
+		public:
+			Lease();
+			Lease(MatPool* matPool, cv::Mat buffer);
+			Lease(Lease&& other);
+			Lease& operator=(Lease&& other);
+			~Lease();
+
+			cv::Mat& get();
+			const cv::Mat& get() const;
+			void reset();
+		private:
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+
+			MatPool* _matPool;
+			cv::Mat _buffer;
+		};
+
+		MatPool();
+
+		Lease acquire(const cv::Size size, const int type);
+		static Lease acquire(MatPool* matPool, const cv::Size size, const int type);
+		void clear();
+
+		size_t getNumberOfAllocations() const;
+		size_t getNumberOfBytesAllocated() const;
+		size_t getNumberOfFreeBuffers() const;
+
+		static size_t* setThreadAllocationCounter(size_t* numberOfBytes);
+	private:
+		MatPool(const MatPool&) = delete;
+		MatPool& operator=(const MatPool&) = delete;
+
+		typedef std::tuple<int, int, int> BufferKey;	// Rows, columns and type.
+
+		void release(cv::Mat& buffer);
+		static void countThreadAllocation(const cv::Size size, const int type);
+
+		std::map<BufferKey, std::vector<cv::Mat>> _freeBuffers;
+		size_t _numberOfAllocations;
+		size_t _numberOfBytesAllocated;
+		mutable std::mutex _mutex;
+	};
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// NeighborOffsets
+	//
+	// The offsets of the neighbors of a pixel for 4- or 8-connectivity. The
+	// 8-connected neighbors are in the order getNeighboringPixels() returns them.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity> struct NeighborOffsets;
+
+	template<> struct NeighborOffsets<4>
+	{
+		static const int COUNT = 4;
+
+		static cv::Point get(const int index)
+		{
+			static const int dx[COUNT] = { -1, 0, 0, 1 };
+			static const int dy[COUNT] = { 0, -1, 1, 0 };
+			return cv::Point(dx[index], dy[index]);
+		}
+	};
+
+	template<> struct NeighborOffsets<8>
+	{
+		static const int COUNT = 8;
+
+		static cv::Point get(const int index)
+		{
+			static const int dx[COUNT] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+			static const int dy[COUNT] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+			return cv::Point(dx[index], dy[index]);
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// Neighborhood
+	//
+	// The 4- or 8-connected neighbors of a pixel that are inside an image, for use
+	// in range-for loops without allocating, e.g.
+	//
+	//     for (const Point neighbor : Neighborhood<8>(image, point)) { ... }
+	//
+	// Whether the pixel is on the border of the image is worked out once, when the
+	// neighborhood is made, so the neighbors of interior pixels are visited
+	// without any bounds checks.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	class Neighborhood final
+	{
+		static_assert(Connectivity == 4 || Connectivity == 8, "Neighborhoods are 4- or 8-connected.");
+	public:
+		//////////////////////////////////////////////////////////////////////////////////
+		// Iterator
+		//
+		// Steps through the neighbors of a Neighborhood, skipping those outside the
+		// image.
+		//////////////////////////////////////////////////////////////////////////////////
+		class Iterator final
+		{
+		public:
+			Iterator(const Neighborhood* neighborhood, const int index);
+
+			cv::Point operator*() const;
+			Iterator& operator++();
+			bool operator!=(const Iterator& other) const;
+		private:
+			void skipNeighborsOutsideImage();
+
+			const Neighborhood* _neighborhood;
+			int _index;
+		};
+
+		Neighborhood(const cv::Mat& image, const cv::Point& point);
+		Neighborhood(const cv::Size& imageSize, const cv::Point& point);
+
+		Iterator begin() const;
+		Iterator end() const;
+	private:
+		bool isInImage(const cv::Point& neighbor) const;
+
+		cv::Point _point;
+		cv::Size _imageSize;
+		bool _isInterior;	// Every neighbor is in the image.
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// Neighborhood()
+	//
+	// The neighborhood of the specified pixel of the specified image.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	Neighborhood<Connectivity>::Neighborhood(const cv::Mat& image, const cv::Point& point)
+		: Neighborhood(image.size(), point)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// Neighborhood()
+	//
+	// The neighborhood of the specified pixel of an image of the specified size.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	Neighborhood<Connectivity>::Neighborhood(const cv::Size& imageSize, const cv::Point& point)
+		: _point(point),
+		_imageSize(imageSize),
+		_isInterior(point.x > 0 && point.y > 0 && point.x < imageSize.width - 1 && point.y < imageSize.height - 1)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// begin()
+	//
+	// Returns an iterator to the first neighbor in the image.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	typename Neighborhood<Connectivity>::Iterator Neighborhood<Connectivity>::begin() const
+	{
+		return Iterator(this, 0);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// end()
+	//
+	// Returns an iterator past the last neighbor.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	typename Neighborhood<Connectivity>::Iterator Neighborhood<Connectivity>::end() const
+	{
+		return Iterator(this, NeighborOffsets<Connectivity>::COUNT);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// isInImage()
+	//
+	// Returns true if the specified neighbor is inside the image.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	bool Neighborhood<Connectivity>::isInImage(const cv::Point& neighbor) const
+	{
+		return neighbor.x >= 0 && neighbor.y >= 0 && neighbor.x < _imageSize.width && neighbor.y < _imageSize.height;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// Iterator()
+	//
+	// An iterator at the specified neighbor, or at the next one after it in the
+	// image.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	Neighborhood<Connectivity>::Iterator::Iterator(const Neighborhood* neighborhood, const int index)
+		: _neighborhood(neighborhood),
+		_index(index)
+	{
+		skipNeighborsOutsideImage();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// operator*()
+	//
+	// Returns the neighbor the iterator is at.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	cv::Point Neighborhood<Connectivity>::Iterator::operator*() const
+	{
+		return _neighborhood->_point + NeighborOffsets<Connectivity>::get(_index);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// operator++()
+	//
+	// Move to the next neighbor in the image.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	typename Neighborhood<Connectivity>::Iterator& Neighborhood<Connectivity>::Iterator::operator++()
+	{
+		++_index;
+		skipNeighborsOutsideImage();
+
+		return *this;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// operator!=()
+	//
+	// Returns true if the iterators are at different neighbors.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	bool Neighborhood<Connectivity>::Iterator::operator!=(const Iterator& other) const
+	{
+		return _index != other._index;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// skipNeighborsOutsideImage()
+	//
+	// Move past any neighbors outside the image. Interior pixels have none, so
+	// this is a single test for them.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	void Neighborhood<Connectivity>::Iterator::skipNeighborsOutsideImage()
+	{
+		if (_neighborhood->_isInterior)
+			return;
+
+		while (_index < NeighborOffsets<Connectivity>::COUNT && !_neighborhood->isInImage(**this))
+		{
+			++_index;
+		}
+	}
+}
@@ -1,7 +1,13 @@
 #include "OcvUtilities.h"
+#include "Neighborhood.h"
+#include "TiledOperations.h"
+#if CV_SSE2
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 using namespace cv;
+using namespace utility;
 
 namespace OcvUtility
 {
@@ -13,15 +19,8 @@ namespace OcvUtility
 	//////////////////////////////////////////////////////////////////////////////////
 	Mat and(vector<Mat>& images)
 	{
-		if (images.size() == 0)
-			return Mat();
-
-		Mat andImage = images.at(0).clone();
-
-		for (int i = 0; i < images.size(); ++i)
-		{
-			bitwise_and(andImage, images.at(i), andImage);
-		}
+		Mat andImage;
+		and(images, andImage);
 
 		return andImage;
 	}
@@ -34,28 +33,47 @@ namespace OcvUtility
 	//////////////////////////////////////////////////////////////////////////////////
 	Mat or(vector<Mat>& images)
 	{
-		if (images.size() == 0)
-			return Mat();
+		Mat orImage;
+		or(images, orImage);
 
-		Mat orImage = images.at(0).clone();
+		return orImage;
+	}
 
-		for (int i = 0; i < images.size(); ++i)
-		{
-			bitwise_or(orImage, images.at(i), orImage);
-		}
+	//////////////////////////////////////////////////////////////////////////////////
+	// and()
+	//
+	// Combine the images via an and operation into the specified image, a strip
+	// at a time on every core. If it is already the right size and type its buffer
+	// is reused.
+	//////////////////////////////////////////////////////////////////////////////////
+	void and(const vector<Mat>& images, Mat& andImage)
+	{
+		tiledAnd(images, andImage);
+	}
 
-		return orImage;
+	//////////////////////////////////////////////////////////////////////////////////
+	// or()
+	//
+	// Combine the images via an or operation into the specified image, a strip at
+	// a time on every core. If it is already the right size and type its buffer is
+	// reused.
+	//////////////////////////////////////////////////////////////////////////////////
+	void or(const vector<Mat>& images, Mat& orImage)
+	{
+		tiledOr(images, orImage);
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////
 	// keepOnlyLargestContour()
 	//
 	// Remove all contours that are not the largest contour from the specified image.
-	// Returns the contour that was found.
+	// Returns the contour that was found. The padded working image is borrowed from
+	// the specified pool if there is one.
 	//////////////////////////////////////////////////////////////////////////////////
-	vector<Point> keepOnlyLargestContour(Mat& originalImage)
+	vector<Point> keepOnlyLargestContour(Mat& originalImage, MatPool* matPool)
 	{
-		Mat largestContourImage;
+		MatPool::Lease largestContourLease = MatPool::acquire(matPool, Size(originalImage.cols + 2, originalImage.rows + 2), originalImage.type());
+		Mat& largestContourImage = largestContourLease.get();
 		padImage(originalImage, largestContourImage);	// If we don't pad, then findContours will not mark the edge as part of the contour.
 
 		vector<vector<Point>> contours;
@@ -64,12 +82,11 @@ namespace OcvUtility
 
 		int largestContourIndex = getLargestContourIndex(contours);
 
-		originalImage = originalImage.zeros(originalImage.size(), CV_8UC1);	// Clear the existing image before drawing the largest contour back onto it.
-		largestContourImage = largestContourImage.zeros(largestContourImage.size(), CV_8UC1);
+		largestContourImage.setTo(Scalar(0));	// findContours modifies its input, so clear it before drawing the largest contour back onto it.
 
 		drawContours(largestContourImage, contours, largestContourIndex, Scalar(255), CV_FILLED, 8, hierarchy);	//TODO: Instead of 255, use maximumThresholdValue
 
-		removePadding(largestContourImage, originalImage);
+		removePadding(largestContourImage, originalImage);	// Overwrites every pixel of the existing image in place.
 
 		return contours[largestContourIndex];
 	}
@@ -96,6 +113,62 @@ namespace OcvUtility
 		return largestContourIndex;
 	}
 
+	//////////////////////////////////////////////////////////////////////////////////
+	// keepOnlyLargestComponent()
+	//
+	// Remove every 8-connected component of the specified image but the one with
+	// the most pixels, and set the pixels of that one to 255. The image is labelled
+	// in a single pass and rewritten in place, without the padded copy and redraw
+	// of keepOnlyLargestContour(). Returns the bounding box of the component that
+	// was kept, or an empty rectangle if the image is black. The label image is
+	// borrowed from the specified pool if there is one.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect keepOnlyLargestComponent(Mat& image, MatPool* matPool)
+	{
+		MatPool::Lease labelsLease = MatPool::acquire(matPool, image.size(), CV_32SC1);
+		Mat& labels = labelsLease.get();
+		Mat stats;
+		Mat centroids;
+
+		const int numberOfLabels = connectedComponentsWithStats(image, labels, stats, centroids, 8, CV_32S);
+
+		int largestLabel = 0;	// Label 0 is the background.
+		int largestArea = 0;
+		for (int label = 1; label < numberOfLabels; ++label)
+		{
+			const int area = stats.at<int>(label, CC_STAT_AREA);
+			if (area > largestArea)
+			{
+				largestArea = area;
+				largestLabel = label;
+			}
+		}
+
+		if (largestLabel == 0)
+		{
+			image.setTo(Scalar(0));
+			return Rect();
+		}
+
+		compare(labels, Scalar(largestLabel), image, CMP_EQ);	// Writes 255 or 0 into every pixel of the existing image.
+
+		return Rect(stats.at<int>(largestLabel, CC_STAT_LEFT), stats.at<int>(largestLabel, CC_STAT_TOP), stats.at<int>(largestLabel, CC_STAT_WIDTH), stats.at<int>(largestLabel, CC_STAT_HEIGHT));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// keepOnlyLargestComponent()
+	//
+	// Remove everything but the largest blob from the specified image, finding it
+	// with the specified method.
+	//////////////////////////////////////////////////////////////////////////////////
+	void keepOnlyLargestComponent(Mat& image, const LargestComponentMethod method, MatPool* matPool)
+	{
+		if (method == LargestComponentMethod::Contours)
+			keepOnlyLargestContour(image, matPool);
+		else
+			keepOnlyLargestComponent(image, matPool);
+	}
+
 	//////////////////////////////////////////////////////////////////////////////////
 	// isPointInImage()
 	//
@@ -149,27 +222,118 @@ namespace OcvUtility
 	//////////////////////////////////////////////////////////////////////////////////
 	// getNeighboringPixels()
 	//
-	// Returns a list of the 8 neighboring pixels that are in the image.
+	// Returns a list of the 8 neighboring pixels that are in the image. Iterate
+	// over a Neighborhood<8> instead where the list doesn't need to be kept.
 	//////////////////////////////////////////////////////////////////////////////////
 	vector<Point> getNeighboringPixels(const Mat& image, const Point& point)
 	{
 		vector<Point> neighboringPixels;
+		neighboringPixels.reserve(NeighborOffsets<8>::COUNT);
 
-		for (int x = point.x - 1; x <= point.x + 1; ++x)
+		for (const Point neighbor : Neighborhood<8>(image, point))
 		{
-			for (int y = point.y - 1; y <= point.y + 1; ++y)
-			{
-				Point neighbor(x, y);
+			neighboringPixels.push_back(neighbor);
+		}
 
-				if (neighbor == point)
-					continue;	// Don't add yourself as a neighbor.
+		return neighboringPixels;
+	}
 
-				if (isPointInImage(image, neighbor))
-					neighboringPixels.push_back(neighbor);
-			}
+	//////////////////////////////////////////////////////////////////////////////////
+	// scaleRect()
+	//
+	// Returns the specified rectangle with its position and size scaled, e.g. to map
+	// a rectangle found in a reduced image back onto the full resolution image.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect scaleRect(const Rect& rect, const double scale)
+	{
+		Point topLeft = Point(cvRound(rect.x * scale), cvRound(rect.y * scale));
+		Point bottomRight = Point(cvRound((rect.x + rect.width) * scale), cvRound((rect.y + rect.height) * scale));
+
+		return Rect(topLeft, bottomRight);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findFirstNonZero()
+	//
+	// Returns the index of the first nonzero pixel in the specified row, or the
+	// length of the row if every pixel is zero. Zero pixels are skipped 16 at a
+	// time where SSE2 is available.
+	//////////////////////////////////////////////////////////////////////////////////
+	int findFirstNonZero(const uchar* row, const int length)
+	{
+		int x = 0;
+
+#if CV_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 16 <= length; x += 16)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(pixels, zero)) != 0xFFFF)
+				break;	// The first nonzero pixel is in this block; find it below.
 		}
+#endif
 
-		return neighboringPixels;
+		for (; x < length; ++x)
+		{
+			if (row[x] != 0)
+				return x;
+		}
+
+		return length;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLastNonZero()
+	//
+	// Returns the index of the last nonzero pixel in the specified row, or -1 if
+	// every pixel is zero. Zero pixels are skipped 16 at a time where SSE2 is
+	// available.
+	//////////////////////////////////////////////////////////////////////////////////
+	int findLastNonZero(const uchar* row, const int length)
+	{
+		int x = length;
+
+#if CV_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; x >= 16; x -= 16)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 16));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(pixels, zero)) != 0xFFFF)
+				break;	// The last nonzero pixel is in this block; find it below.
+		}
+#endif
+
+		for (; x > 0; --x)
+		{
+			if (row[x - 1] != 0)
+				return x - 1;
+		}
+
+		return -1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeNonZeroBoundingRect()
+	//
+	// Returns the smallest rectangle holding every nonzero pixel of the specified
+	// single channel 8 bit image, or an empty one if there are none. The image is
+	// reduced to its row and column maxima, so only they are searched.
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect computeNonZeroBoundingRect(const Mat& image)
+	{
+		Mat columnMaxima, rowMaxima;
+		reduce(image, columnMaxima, 0, REDUCE_MAX);
+		reduce(image, rowMaxima, 1, REDUCE_MAX);	// A single column, so its pixels are contiguous.
+
+		const int left = findFirstNonZero(columnMaxima.ptr<uchar>(0), columnMaxima.cols);
+		if (left == columnMaxima.cols)
+			return Rect();
+
+		const int right = findLastNonZero(columnMaxima.ptr<uchar>(0), columnMaxima.cols);
+		const int top = findFirstNonZero(rowMaxima.ptr<uchar>(0), rowMaxima.rows);
+		const int bottom = findLastNonZero(rowMaxima.ptr<uchar>(0), rowMaxima.rows);
+
+		return Rect(left, top, right - left + 1, bottom - top + 1);
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////
@@ -179,16 +343,17 @@ namespace OcvUtility
 	//////////////////////////////////////////////////////////////////////////////////
 	void padImage(const Mat& sourceImage, Mat& destinationImage, const int padAmount)
 	{
-		copyMakeBorder(sourceImage, destinationImage, 1, 1, 1, 1, BORDER_CONSTANT);
+		copyMakeBorder(sourceImage, destinationImage, padAmount, padAmount, padAmount, padAmount, BORDER_CONSTANT);
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////
 	// removePadding()
 	//
-	// Removes borders from the specified image by the specified padding amount.
+	// Removes borders from the specified image by the specified padding amount. If
+	// the destination is already the right size and type its buffer is reused.
 	//////////////////////////////////////////////////////////////////////////////////
 	void removePadding(const Mat& sourceImage, Mat& destinationImage, const int padAmount)
 	{
-		sourceImage(Rect(padAmount, padAmount, sourceImage.size().width - 1 - padAmount, sourceImage.size().height - 1 - padAmount)).copyTo(destinationImage);
+		sourceImage(Rect(padAmount, padAmount, sourceImage.size().width - 2 * padAmount, sourceImage.size().height - 2 * padAmount)).copyTo(destinationImage);
 	}
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MatPool.h"
 #include <opencv2/imgproc/imgproc.hpp>
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -9,10 +10,27 @@
 //////////////////////////////////////////////////////////////////////////////////
 namespace OcvUtility
 {
+	//////////////////////////////////////////////////////////////////////////////////
+	// LargestComponentMethod
+	//
+	// How the largest blob of a mask is found. Contours measures each outline by
+	// its polygon area; ConnectedComponents labels the mask in one pass and
+	// measures each blob by its pixel count.
+	//////////////////////////////////////////////////////////////////////////////////
+	enum class LargestComponentMethod
+	{
+		Contours,
+		ConnectedComponents
+	};
+
 	cv::Mat and(std::vector<cv::Mat>& images);
 	cv::Mat or(std::vector<cv::Mat>& images);
-	std::vector<cv::Point> keepOnlyLargestContour(cv::Mat& originalImage);
+	void and(const std::vector<cv::Mat>& images, cv::Mat& andImage);
+	void or(const std::vector<cv::Mat>& images, cv::Mat& orImage);
+	std::vector<cv::Point> keepOnlyLargestContour(cv::Mat& originalImage, utility::MatPool* matPool = nullptr);
 	int getLargestContourIndex(const std::vector<std::vector<cv::Point>>& contours);
+	cv::Rect keepOnlyLargestComponent(cv::Mat& image, utility::MatPool* matPool = nullptr);
+	void keepOnlyLargestComponent(cv::Mat& image, const LargestComponentMethod method, utility::MatPool* matPool = nullptr);
 
 	bool isPointInImage(const cv::Mat& image, const cv::Point& point);
 	bool isPointWhite(const cv::Mat& image, const cv::Point& point);
@@ -20,6 +38,12 @@ namespace OcvUtility
 
 	std::vector<cv::Point> getNeighboringPixels(const cv::Mat& image, const cv::Point& point);
 
+	cv::Rect scaleRect(const cv::Rect& rect, const double scale);
+
+	int findFirstNonZero(const uchar* row, const int length);
+	int findLastNonZero(const uchar* row, const int length);
+	cv::Rect computeNonZeroBoundingRect(const cv::Mat& image);
+
 	void padImage(const cv::Mat& sourceImage, cv::Mat& destinationImage, const int padAmount = 1);
 	void removePadding(const cv::Mat& sourceImage, cv::Mat& destinationImage, const int padAmount = 1);
 
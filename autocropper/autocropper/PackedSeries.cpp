@@ -0,0 +1,299 @@
+#include "PackedSeries.h"
+#include "ImageReader.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+const string PackedSeries::EXTENSION = ".series";
+const char PackedSeries::MAGIC[8] = { 'A', 'C', 'S', 'E', 'R', 'I', 'E', 'S' };
+
+//////////////////////////////////////////////////////////////////////////////////
+// PackedSeries()
+//
+// Map the specified packed series and check its header and index. Throws if the
+// file can't be mapped, isn't a packed series, or is truncated.
+//////////////////////////////////////////////////////////////////////////////////
+PackedSeries::PackedSeries(const string& filename)
+	: _file(filename),
+	_header(nullptr),
+	_index(nullptr)
+{
+	const unsigned char* data = _file.getData();
+	const size_t size = _file.getSize();
+
+	if (size < sizeof(Header) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+		throw runtime_error("Not a packed series: " + filename);
+
+	_header = reinterpret_cast<const Header*>(data);
+
+	if (_header->version != VERSION)
+		throw runtime_error("Unsupported packed series version: " + filename);
+
+	if (_header->encoding > static_cast<uint32_t>(PackedFrameEncoding::Png) || _header->width <= 0 || _header->height <= 0
+		|| sizeof(Header) + _header->seriesNameLength > size
+		|| _header->indexOffset > size || (size - _header->indexOffset) / sizeof(IndexEntry) < _header->numberOfFrames)
+		throw runtime_error("Packed series is corrupt or truncated: " + filename);
+
+	_seriesName.assign(reinterpret_cast<const char*>(data + sizeof(Header)), _header->seriesNameLength);
+	_index = reinterpret_cast<const IndexEntry*>(data + _header->indexOffset);
+
+	const uint64_t rawFrameSize = static_cast<uint64_t>(_header->width) * _header->height;
+
+	for (uint32_t i = 0; i < _header->numberOfFrames; ++i)
+	{
+		if (_index[i].offset > size || _index[i].size > size - _index[i].offset
+			|| (getEncoding() == PackedFrameEncoding::Raw && _index[i].size != rawFrameSize))
+			throw runtime_error("Packed series is corrupt or truncated: " + filename);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfFrames()
+//
+// Returns the number of frames in the series.
+//////////////////////////////////////////////////////////////////////////////////
+size_t PackedSeries::getNumberOfFrames() const
+{
+	return _header->numberOfFrames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFrame()
+//
+// Returns the specified frame. A raw frame is a read only view into the mapped
+// file, so nothing is copied; clone it to modify it or to keep it after the
+// series is gone. A PNG frame is decoded into an image of its own.
+//////////////////////////////////////////////////////////////////////////////////
+Mat PackedSeries::getFrame(const size_t frameIndex) const
+{
+	if (frameIndex >= getNumberOfFrames())
+		throw out_of_range("No such frame in packed series: " + _file.getFilename());
+
+	unsigned char* frameData = const_cast<unsigned char*>(_file.getData() + _index[frameIndex].offset);
+
+	if (getEncoding() == PackedFrameEncoding::Raw)
+		return Mat(_header->height, _header->width, CV_8UC1, frameData);
+
+	Mat frame = imdecode(Mat(1, static_cast<int>(_index[frameIndex].size), CV_8UC1, frameData), IMREAD_GRAYSCALE);
+
+	if (frame.empty())
+		throw runtime_error("Unable to decode frame of packed series: " + _file.getFilename());
+
+	return frame;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFrames()
+//
+// Returns every frame of the series in frame order, as getFrame() does.
+//////////////////////////////////////////////////////////////////////////////////
+vector<Mat> PackedSeries::getFrames() const
+{
+	vector<Mat> frames;
+	frames.reserve(getNumberOfFrames());
+
+	for (size_t i = 0; i < getNumberOfFrames(); ++i)
+	{
+		frames.push_back(getFrame(i));
+	}
+
+	return frames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getImageNumber()
+//
+// Returns the number of the image file the specified frame was packed from.
+//////////////////////////////////////////////////////////////////////////////////
+int PackedSeries::getImageNumber(const size_t frameIndex) const
+{
+	if (frameIndex >= getNumberOfFrames())
+		throw out_of_range("No such frame in packed series: " + _file.getFilename());
+
+	return _index[frameIndex].imageNumber;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSeriesName()
+//
+// Returns the name of the series the frames were packed from.
+//////////////////////////////////////////////////////////////////////////////////
+const string& PackedSeries::getSeriesName() const
+{
+	return _seriesName;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFrameSize()
+//
+// Returns the size every frame of the series has.
+//////////////////////////////////////////////////////////////////////////////////
+Size PackedSeries::getFrameSize() const
+{
+	return Size(_header->width, _header->height);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getEncoding()
+//
+// Returns how the frames are stored.
+//////////////////////////////////////////////////////////////////////////////////
+PackedFrameEncoding PackedSeries::getEncoding() const
+{
+	return static_cast<PackedFrameEncoding>(_header->encoding);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFilename()
+//
+// Returns the name of the packed file.
+//////////////////////////////////////////////////////////////////////////////////
+const string& PackedSeries::getFilename() const
+{
+	return _file.getFilename();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// pack()
+//
+// Pack the series beginning with the specified starting file into the specified
+// file, decoding its images on the specified thread pool. Frames are written as
+// they are decoded, so the series is never all in memory. The file only appears
+// once it is complete. Returns the number of frames packed; throws if none could
+// be read, they differ in size, or the file can't be written.
+//////////////////////////////////////////////////////////////////////////////////
+int PackedSeries::pack(const string& startingFilename, const string& packedFilename, const PackedFrameEncoding encoding, ThreadPool& threadPool)
+{
+	const vector<string> filenames = ImageReader::getDatasetFilenames(startingFilename);
+	const string seriesName = ImageReader::getSeriesName(startingFilename);
+	const string temporaryFilename = packedFilename + ".tmp";
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.encoding = static_cast<uint32_t>(encoding);
+	header.seriesNameLength = static_cast<uint32_t>(seriesName.size());
+
+	vector<IndexEntry> index;
+
+	{
+		ofstream stream(temporaryFilename, ios::binary | ios::trunc);
+		if (!stream)
+			throw runtime_error("Unable to write packed series: " + packedFilename);
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));	// Rewritten once the frames are known.
+		stream.write(seriesName.data(), seriesName.size());
+
+		const vector<int> pngParameters = { IMWRITE_PNG_COMPRESSION, 1 };
+		vector<uchar> encodedFrame;
+
+		try
+		{
+			ImageReader::streamImages(filenames, threadPool, [&](size_t imageIndex, const Mat& image)
+			{
+				if (index.empty())
+				{
+					header.width = image.cols;
+					header.height = image.rows;
+				}
+				else if (image.cols != header.width || image.rows != header.height)
+				{
+					throw runtime_error("Every frame of a packed series must be the same size: " + filenames[imageIndex]);
+				}
+
+				writePadding(stream, FRAME_ALIGNMENT);
+
+				IndexEntry entry;
+				memset(&entry, 0, sizeof(entry));
+				entry.offset = static_cast<uint64_t>(stream.tellp());
+				entry.imageNumber = ImageReader::getImageNumber(filenames[imageIndex]);
+
+				if (encoding == PackedFrameEncoding::Raw)
+				{
+					for (int y = 0; y < image.rows; ++y)
+					{
+						stream.write(reinterpret_cast<const char*>(image.ptr(y)), image.cols);
+					}
+				}
+				else
+				{
+					imencode(".png", image, encodedFrame, pngParameters);
+					stream.write(reinterpret_cast<const char*>(encodedFrame.data()), encodedFrame.size());
+				}
+
+				entry.size = static_cast<uint64_t>(stream.tellp()) - entry.offset;
+				index.push_back(entry);
+			}, threadPool.getNumberOfThreads() * 2);
+		}
+		catch (...)
+		{
+			stream.close();
+			remove(temporaryFilename.c_str());
+			throw;
+		}
+
+		if (index.empty())
+		{
+			stream.close();
+			remove(temporaryFilename.c_str());
+			throw runtime_error("No images could be read to pack: " + startingFilename);
+		}
+
+		writePadding(stream, sizeof(uint64_t));
+		header.indexOffset = static_cast<uint64_t>(stream.tellp());
+		header.numberOfFrames = static_cast<uint32_t>(index.size());
+		stream.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(IndexEntry));
+
+		stream.seekp(0);
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		if (!stream)
+		{
+			stream.close();
+			remove(temporaryFilename.c_str());
+			throw runtime_error("Unable to write packed series: " + packedFilename);
+		}
+	}
+
+	remove(packedFilename.c_str());	// rename() won't replace an existing file on Windows.
+
+	if (rename(temporaryFilename.c_str(), packedFilename.c_str()) != 0)
+		throw runtime_error("Unable to write packed series: " + packedFilename);
+
+	return static_cast<int>(index.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isPackedSeries()
+//
+// Returns true if the specified file is named as a packed series.
+//////////////////////////////////////////////////////////////////////////////////
+bool PackedSeries::isPackedSeries(const string& filename)
+{
+	return filename.size() > EXTENSION.size() && filename.compare(filename.size() - EXTENSION.size(), EXTENSION.size(), EXTENSION) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writePadding()
+//
+// Write zeros until the stream is at a multiple of the specified alignment.
+//////////////////////////////////////////////////////////////////////////////////
+void PackedSeries::writePadding(ostream& stream, const size_t alignment)
+{
+	const size_t position = static_cast<size_t>(stream.tellp());
+	const size_t padding = (alignment - position % alignment) % alignment;
+
+	for (size_t i = 0; i < padding; ++i)
+	{
+		stream.put(0);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	// How the frames of a packed series are stored.
+	enum class PackedFrameEncoding
+	{
+		Raw,	// Uncompressed rows, handed out as views into the mapped file.
+		Png		// PNG at the fastest compression level, decoded when asked for.
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// PackedSeries
+	//
+	// A whole series in one file, so reading it costs one open instead of one per
+	// frame. The file starts with a header and the series name, the frames follow
+	// on page boundaries, and an index of where each frame is ends the file. The
+	// file is memory mapped; raw frames are returned as views into the mapping,
+	// which are read only and must not outlive the series. Integers are stored
+	// little endian, as on every machine this runs on.
+	//////////////////////////////////////////////////////////////////////////////////
+	class PackedSeries final
+	{
+	public:
+		explicit PackedSeries(const std::string& filename);
+
+		size_t getNumberOfFrames() const;
+		cv::Mat getFrame(const size_t frameIndex) const;
+		std::vector<cv::Mat> getFrames() const;
+		int getImageNumber(const size_t frameIndex) const;
+		const std::string& getSeriesName() const;
+		cv::Size getFrameSize() const;
+		PackedFrameEncoding getEncoding() const;
+		const std::string& getFilename() const;
+
+		static int pack(const std::string& startingFilename, const std::string& packedFilename, const PackedFrameEncoding encoding, utility::ThreadPool& threadPool);
+		static bool isPackedSeries(const std::string& filename);
+
+		static const std::string EXTENSION;
+	private:
+		struct Header
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t encoding;
+			int32_t width;
+			int32_t height;
+			uint32_t numberOfFrames;
+			uint32_t seriesNameLength;	// The name follows the header, without a terminator.
+			uint64_t indexOffset;
+		};
+
+		struct IndexEntry
+		{
+			uint64_t offset;
+			uint64_t size;
+			int32_t imageNumber;	// The number of the file the frame was packed from.
+			uint32_t reserved;
+		};
+
+		static void writePadding(std::ostream& stream, const size_t alignment);
+
+		utility::MappedFile _file;
+		const Header* _header;
+		const IndexEntry* _index;
+		std::string _seriesName;
+
+		static const char MAGIC[8];
+		static const uint32_t VERSION = 1;
+		static const size_t FRAME_ALIGNMENT = 4096;	// Frames start on a page, so each is mapped in whole pages.
+	};
+}
@@ -0,0 +1,243 @@
+#include "ParameterSweep.h"
+#include "CropRegionMemo.h"
+#include "CropSidecar.h"
+#include "FileUtilities.h"
+#include "ImageReader.h"
+#include "WorkStealingThreadPool.h"
+#include <opencv2/core.hpp>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// SweepGrid()
+//
+// Create a grid of the single point the specified options are at.
+//////////////////////////////////////////////////////////////////////////////////
+SweepGrid::SweepGrid(const CropRegionOptions& options)
+	: verticalLineFractions(1, options.verticalLineFraction),
+	horizontalLineFractions(1, options.horizontalLineFraction),
+	closingElementSizes(1, options.closingElementSize),
+	rootRowSearchFractions(1, options.rootRowSearchFraction)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfPoints()
+//
+// Returns the number of combinations of the parameter values.
+//////////////////////////////////////////////////////////////////////////////////
+size_t SweepGrid::getNumberOfPoints() const
+{
+	return verticalLineFractions.size() * horizontalLineFractions.size() * closingElementSizes.size() * rootRowSearchFractions.size();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getPoint()
+//
+// Returns the specified options with the swept parameters set to the values of
+// the point with the specified index. The root row search fraction varies
+// fastest, then the closing element, the horizontal fraction, and the vertical
+// fraction slowest.
+//////////////////////////////////////////////////////////////////////////////////
+CropRegionOptions SweepGrid::getPoint(const size_t index, const CropRegionOptions& baseOptions) const
+{
+	CropRegionOptions options = baseOptions;
+	size_t remainder = index;
+
+	options.rootRowSearchFraction = rootRowSearchFractions.at(remainder % rootRowSearchFractions.size());
+	remainder /= rootRowSearchFractions.size();
+	options.closingElementSize = closingElementSizes.at(remainder % closingElementSizes.size());
+	remainder /= closingElementSizes.size();
+	options.horizontalLineFraction = horizontalLineFractions.at(remainder % horizontalLineFractions.size());
+	remainder /= horizontalLineFractions.size();
+	options.verticalLineFraction = verticalLineFractions.at(remainder);
+
+	return options;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// sweepSeries()
+//
+// Sweep every specified series over the grid. Series are swept concurrently,
+// and the points of each series' grid run in parallel on a pool of their own.
+// Returns the results of every point of the first series, then of the next,
+// and so on. A series that fails has a single result recording the error.
+//////////////////////////////////////////////////////////////////////////////////
+vector<SweepResult> ParameterSweep::sweepSeries(const vector<string>& startingFilenames, const CropRegionOptions& baseOptions, const SweepGrid& grid, const CropResultCache* resultCache, SeriesIndex* seriesIndex)
+{
+	if (grid.getNumberOfPoints() == 0)
+		throw invalid_argument("Every parameter of a sweep needs at least one value.");
+
+	SeriesIndex sweepSeriesIndex;
+	SeriesIndex& activeSeriesIndex = (seriesIndex != nullptr) ? *seriesIndex : sweepSeriesIndex;
+
+	// Series tasks block on decodes and grid points, so those go to pools of their own.
+	ThreadPool readerThreadPool;
+	ThreadPool gridThreadPool;
+	MatPool matPool;
+	vector<future<vector<SweepResult>>> pendingResults;
+	vector<SweepResult> results;
+
+	{
+		WorkStealingThreadPool seriesThreadPool;
+
+		for (const auto& startingFilename : startingFilenames)
+		{
+			pendingResults.push_back(seriesThreadPool.submit([startingFilename, &baseOptions, &grid, resultCache, &activeSeriesIndex, &readerThreadPool, &gridThreadPool, &matPool]()
+			{
+				return sweepOneSeries(startingFilename, baseOptions, grid, resultCache, activeSeriesIndex, readerThreadPool, gridThreadPool, matPool);
+			}));
+		}
+
+		for (auto& pendingResult : pendingResults)
+		{
+			const vector<SweepResult> seriesResults = pendingResult.get();
+			results.insert(results.end(), seriesResults.begin(), seriesResults.end());
+		}
+	}
+
+	return results;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// sweepForegroundUnion()
+//
+// Find the gel and crop regions at every point of the grid in the specified
+// foreground union, running the points in parallel on the specified pool. Each
+// result is the region computeCropRegion() finds with the options of its point.
+// A point that fails records the error in its result. The union isn't modified.
+//////////////////////////////////////////////////////////////////////////////////
+vector<SweepResult> ParameterSweep::sweepForegroundUnion(const Mat& foregroundUnion, const CropRegionOptions& baseOptions, const SweepGrid& grid, ThreadPool& threadPool)
+{
+	CropRegionMemo cropRegionMemo(foregroundUnion);
+	vector<future<SweepResult>> pendingResults;
+
+	for (size_t point = 0; point < grid.getNumberOfPoints(); ++point)
+	{
+		const CropRegionOptions options = grid.getPoint(point, baseOptions);
+
+		pendingResults.push_back(threadPool.submit([&cropRegionMemo, options]()
+		{
+			SweepResult result;
+			result.options = options;
+			result.succeeded = false;
+
+			try
+			{
+				result.cropRegion = cropRegionMemo.computeCropRegion(options, &result.gelRegion);
+				result.succeeded = true;
+			}
+			catch (const exception& e)
+			{
+				result.errorMessage = e.what();
+			}
+
+			return result;
+		}));
+	}
+
+	vector<SweepResult> results;
+
+	for (auto& pendingResult : pendingResults)
+	{
+		results.push_back(pendingResult.get());
+	}
+
+	return results;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeTable()
+//
+// Write the swept parameters and the regions they found as CSV, one point of
+// one series per line.
+//////////////////////////////////////////////////////////////////////////////////
+void ParameterSweep::writeTable(const vector<SweepResult>& results, ostream& stream)
+{
+	stream << "series,vertical_fraction,horizontal_fraction,closing_width,closing_height,root_search,status,gel_x,gel_y,gel_width,gel_height,x,y,width,height,error" << endl;
+
+	for (const auto& result : results)
+	{
+		stream << FileUtilities::quoteCsv(result.seriesName) << ","
+			<< result.options.verticalLineFraction << "," << result.options.horizontalLineFraction << ","
+			<< result.options.closingElementSize.width << "," << result.options.closingElementSize.height << ","
+			<< result.options.rootRowSearchFraction << ","
+			<< (result.succeeded ? "ok" : "failed") << ","
+			<< result.gelRegion.x << "," << result.gelRegion.y << ","
+			<< result.gelRegion.width << "," << result.gelRegion.height << ","
+			<< result.cropRegion.x << "," << result.cropRegion.y << ","
+			<< result.cropRegion.width << "," << result.cropRegion.height << ","
+			<< FileUtilities::quoteCsv(result.errorMessage) << endl;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// sweepOneSeries()
+//
+// Sweep a single series over the grid. Any error finding its foreground union
+// is caught and recorded, so the rest of the sweep carries on.
+//////////////////////////////////////////////////////////////////////////////////
+vector<SweepResult> ParameterSweep::sweepOneSeries(const string& startingFilename, const CropRegionOptions& baseOptions, const SweepGrid& grid, const CropResultCache* resultCache, SeriesIndex& seriesIndex, ThreadPool& readerThreadPool, ThreadPool& gridThreadPool, MatPool& matPool)
+{
+	const string seriesName = ImageReader::getSeriesName(startingFilename);
+	vector<SweepResult> results;
+
+	try
+	{
+		const Mat foregroundUnion = computeSeriesForegroundUnion(startingFilename, baseOptions, resultCache, seriesIndex, readerThreadPool, matPool);
+		results = sweepForegroundUnion(foregroundUnion, baseOptions, grid, gridThreadPool);
+	}
+	catch (const exception& e)
+	{
+		SweepResult result;
+		result.options = baseOptions;
+		result.succeeded = false;
+		result.errorMessage = e.what();
+		results.assign(1, result);
+		cerr << "Failed to sweep series " << startingFilename << ": " << result.errorMessage << endl;
+	}
+
+	for (auto& result : results)
+	{
+		result.seriesName = seriesName;
+	}
+
+	return results;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeSeriesForegroundUnion()
+//
+// Returns the foreground union of a series, as the base options find it. The
+// union is taken from the result cache if it was stored there; otherwise the
+// series is read and its crop region found at the base options, which stores
+// both in the cache for the next sweep.
+//////////////////////////////////////////////////////////////////////////////////
+Mat ParameterSweep::computeSeriesForegroundUnion(const string& startingFilename, const CropRegionOptions& baseOptions, const CropResultCache* resultCache, SeriesIndex& seriesIndex, ThreadPool& readerThreadPool, MatPool& matPool)
+{
+	const vector<string> filenames = seriesIndex.getFilenames(startingFilename);
+	if (filenames.empty())
+		throw runtime_error("No frames of the series were found.");
+
+	CropSidecar sidecar = CropSidecar::create(ImageReader::getSeriesName(startingFilename), filenames, Rect(), Rect());
+	const string cacheKey = (resultCache != nullptr) ? CropResultCache::computeKey(filenames, baseOptions) : string();
+	Mat foregroundUnion;
+
+	if (resultCache != nullptr && resultCache->lookup(cacheKey, sidecar, &foregroundUnion))
+		return foregroundUnion;
+
+	const vector<Mat> originalImages = ImageReader::readImages(filenames, readerThreadPool);
+	sidecar.cropRegion = computeSeriesCropRegion(originalImages, baseOptions, &matPool, nullptr, &sidecar.gelRegion, &foregroundUnion);
+
+	if (resultCache != nullptr)
+		resultCache->store(cacheKey, sidecar, foregroundUnion);
+
+	return foregroundUnion;
+}
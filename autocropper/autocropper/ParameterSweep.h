@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CropPipeline.h"
+#include "CropResultCache.h"
+#include "MatPool.h"
+#include "SeriesIndex.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// SweepGrid
+	//
+	// The values of each crop region detection parameter to try. Every combination
+	// of them is a point of the grid.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct SweepGrid
+	{
+		explicit SweepGrid(const CropRegionOptions& options = CropRegionOptions());
+
+		std::vector<double> verticalLineFractions;
+		std::vector<double> horizontalLineFractions;
+		std::vector<cv::Size> closingElementSizes;
+		std::vector<double> rootRowSearchFractions;
+
+		size_t getNumberOfPoints() const;
+		CropRegionOptions getPoint(const size_t index, const CropRegionOptions& baseOptions) const;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// SweepResult
+	//
+	// The regions one point of a sweep found in one series.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct SweepResult
+	{
+		std::string seriesName;
+		CropRegionOptions options;
+		cv::Rect gelRegion;
+		cv::Rect cropRegion;
+		bool succeeded;
+		std::string errorMessage;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// ParameterSweep
+	//
+	// Find the crop region of many series at every point of a parameter grid. The
+	// foreground union of a series doesn't depend on the swept parameters, so it
+	// is computed once, or taken from the result cache, and the points of its
+	// grid share the later stages through a CropRegionMemo.
+	//////////////////////////////////////////////////////////////////////////////////
+	class ParameterSweep final
+	{
+	public:
+		static std::vector<SweepResult> sweepSeries(const std::vector<std::string>& startingFilenames, const CropRegionOptions& baseOptions, const SweepGrid& grid, const CropResultCache* resultCache = nullptr, SeriesIndex* seriesIndex = nullptr);
+		static std::vector<SweepResult> sweepForegroundUnion(const cv::Mat& foregroundUnion, const CropRegionOptions& baseOptions, const SweepGrid& grid, utility::ThreadPool& threadPool);
+		static void writeTable(const std::vector<SweepResult>& results, std::ostream& stream);
+	private:
+		static std::vector<SweepResult> sweepOneSeries(const std::string& startingFilename, const CropRegionOptions& baseOptions, const SweepGrid& grid, const CropResultCache* resultCache, SeriesIndex& seriesIndex, utility::ThreadPool& readerThreadPool, utility::ThreadPool& gridThreadPool, utility::MatPool& matPool);
+		static cv::Mat computeSeriesForegroundUnion(const std::string& startingFilename, const CropRegionOptions& baseOptions, const CropResultCache* resultCache, SeriesIndex& seriesIndex, utility::ThreadPool& readerThreadPool, utility::MatPool& matPool);
+	};
+}
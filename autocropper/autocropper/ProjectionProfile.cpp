@@ -0,0 +1,398 @@
+#include "ProjectionProfile.h"
+#include "OcvUtilities.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace cv;
+using namespace std;
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// ProjectionProfile()
+	//
+	// Create the profile of an empty mask.
+	//////////////////////////////////////////////////////////////////////////////////
+	ProjectionProfile::ProjectionProfile()
+		: _rowPrefixSums(1, 0),
+		_columnPrefixSums(1, 0)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// ProjectionProfile()
+	//
+	// Compute the profile of the nonzero pixels of the specified CV_8UC1 mask, which
+	// may be a region of a larger image. The integral image is only computed if
+	// rectangle sums are wanted.
+	//////////////////////////////////////////////////////////////////////////////////
+	ProjectionProfile::ProjectionProfile(const Mat& mask, const bool hasRectangleSums)
+	{
+		build(mask, hasRectangleSums);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// ProjectionProfile()
+	//
+	// Compute the profile of the set pixels of the specified packed mask.
+	//////////////////////////////////////////////////////////////////////////////////
+	ProjectionProfile::ProjectionProfile(const BinaryMask& mask, const bool hasRectangleSums)
+	{
+		build(mask, hasRectangleSums);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// build()
+	//
+	// Compute every projection of the specified mask in one pass over its rows.
+	// Within a row only the pixels from its first to its last nonzero pixel are
+	// visited, apart from filling in the integral image.
+	//////////////////////////////////////////////////////////////////////////////////
+	void ProjectionProfile::build(const Mat& mask, const bool hasRectangleSums)
+	{
+		if (mask.type() != CV_8UC1)
+			throw invalid_argument("A projection profile can only be computed from a CV_8UC1 mask.");
+
+		const int width = mask.size().width;
+		const int height = mask.size().height;
+
+		reset(mask.size(), hasRectangleSums);
+
+		for (int y = 0; y < height; ++y)
+		{
+			const uchar* pixels = mask.ptr<uchar>(y);
+			const int first = findFirstNonZero(pixels, width);
+			const int last = (first < width) ? findLastNonZero(pixels, width) : -1;
+			_firstInRow[y] = first;
+			_lastInRow[y] = last;
+
+			int rowCount = 0;
+			for (int x = first; x <= last; ++x)
+			{
+				if (pixels[x] == 0)
+					continue;
+
+				++rowCount;
+				++_columnCounts[x];
+				if (_firstInColumn[x] == height)
+					_firstInColumn[x] = y;
+				_lastInColumn[x] = y;
+			}
+			_rowCounts[y] = rowCount;
+
+			if (hasRectangleSums)
+			{
+				// Each integral row is the row above plus the running count of this row.
+				const int* sumsAbove = &_integralImage[static_cast<size_t>(y) * (width + 1)];
+				int* sums = &_integralImage[static_cast<size_t>(y + 1) * (width + 1)];
+				int runningCount = 0;
+				for (int x = 0; x < width; ++x)
+				{
+					if (x >= first && x <= last && pixels[x] != 0)
+						++runningCount;
+					sums[x + 1] = sumsAbove[x + 1] + runningCount;
+				}
+			}
+		}
+
+		computePrefixSums();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// build()
+	//
+	// Compute every projection of the specified packed mask a word at a time. A row
+	// is counted by popcounts and its ends found by bit scans of its first and last
+	// set words, and only the set bits are visited for the column projections.
+	// Only the integral image, if wanted, is filled in a pixel at a time.
+	//////////////////////////////////////////////////////////////////////////////////
+	void ProjectionProfile::build(const BinaryMask& mask, const bool hasRectangleSums)
+	{
+		const int width = mask.size().width;
+		const int height = mask.size().height;
+		const int wordsPerRow = (width + BinaryMask::BITS_PER_WORD - 1) / BinaryMask::BITS_PER_WORD;
+
+		reset(mask.size(), hasRectangleSums);
+
+		for (int y = 0; y < height; ++y)
+		{
+			const uint64_t* words = mask.ptr(y);
+
+			int rowCount = 0;
+			for (int word = 0; word < wordsPerRow; ++word)
+			{
+				if (words[word] == 0)
+					continue;
+
+				const int wordStart = word * BinaryMask::BITS_PER_WORD;
+				rowCount += BinaryMask::countBits(words[word]);
+				if (_firstInRow[y] == width)
+					_firstInRow[y] = wordStart + BinaryMask::findLowestBit(words[word]);
+				_lastInRow[y] = wordStart + BinaryMask::findHighestBit(words[word]);
+
+				for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+				{
+					const int x = wordStart + BinaryMask::findLowestBit(bits);
+					++_columnCounts[x];
+					if (_firstInColumn[x] == height)
+						_firstInColumn[x] = y;
+					_lastInColumn[x] = y;
+				}
+			}
+			_rowCounts[y] = rowCount;
+
+			if (hasRectangleSums)
+			{
+				const int* sumsAbove = &_integralImage[static_cast<size_t>(y) * (width + 1)];
+				int* sums = &_integralImage[static_cast<size_t>(y + 1) * (width + 1)];
+				int runningCount = 0;
+				for (int x = 0; x < width; ++x)
+				{
+					runningCount += static_cast<int>((words[x / BinaryMask::BITS_PER_WORD] >> (x % BinaryMask::BITS_PER_WORD)) & 1);
+					sums[x + 1] = sumsAbove[x + 1] + runningCount;
+				}
+			}
+		}
+
+		computePrefixSums();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// reset()
+	//
+	// Size the projections for a mask of the specified size with no nonzero pixels.
+	//////////////////////////////////////////////////////////////////////////////////
+	void ProjectionProfile::reset(const Size size, const bool hasRectangleSums)
+	{
+		_size = size;
+		_rowCounts.assign(size.height, 0);
+		_columnCounts.assign(size.width, 0);
+		_firstInRow.assign(size.height, size.width);
+		_lastInRow.assign(size.height, -1);
+		_firstInColumn.assign(size.width, size.height);
+		_lastInColumn.assign(size.width, -1);
+		_integralImage.assign(hasRectangleSums ? static_cast<size_t>(size.width + 1) * (size.height + 1) : 0, 0);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computePrefixSums()
+	//
+	// Prefix sum the row and column counts.
+	//////////////////////////////////////////////////////////////////////////////////
+	void ProjectionProfile::computePrefixSums()
+	{
+		_rowPrefixSums.assign(_size.height + 1, 0);
+		for (int y = 0; y < _size.height; ++y)
+		{
+			_rowPrefixSums[y + 1] = _rowPrefixSums[y] + _rowCounts[y];
+		}
+
+		_columnPrefixSums.assign(_size.width + 1, 0);
+		for (int x = 0; x < _size.width; ++x)
+		{
+			_columnPrefixSums[x + 1] = _columnPrefixSums[x] + _columnCounts[x];
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countRow()
+	//
+	// Returns the number of nonzero pixels in the specified row.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::countRow(const int y) const
+	{
+		return _rowCounts[y];
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countColumn()
+	//
+	// Returns the number of nonzero pixels in the specified column.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::countColumn(const int x) const
+	{
+		return _columnCounts[x];
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countRectangle()
+	//
+	// Returns the number of nonzero pixels in the specified rectangle, which must
+	// be within the mask. A rectangle spanning every column or every row is counted
+	// from the prefix sums; any other needs the integral image.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::countRectangle(const Rect& rect) const
+	{
+		const int top = rect.y;
+		const int bottom = rect.y + rect.height;
+		const int left = rect.x;
+		const int right = rect.x + rect.width;
+
+		if (left == 0 && right == _size.width)
+			return _rowPrefixSums[bottom] - _rowPrefixSums[top];
+		if (top == 0 && bottom == _size.height)
+			return _columnPrefixSums[right] - _columnPrefixSums[left];
+
+		if (!hasRectangleSums())
+			throw runtime_error("The projection profile was computed without rectangle sums.");
+
+		return getIntegral(bottom, right) - getIntegral(top, right) - getIntegral(bottom, left) + getIntegral(top, left);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findFirstInRow()
+	//
+	// Returns the column of the first nonzero pixel of the specified row, or the
+	// width if the row is empty, as findFirstNonZero() does.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findFirstInRow(const int y) const
+	{
+		return _firstInRow[y];
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLastInRow()
+	//
+	// Returns the column of the last nonzero pixel of the specified row, or -1 if
+	// the row is empty, as findLastNonZero() does.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findLastInRow(const int y) const
+	{
+		return _lastInRow[y];
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findFirstInColumn()
+	//
+	// Returns the row of the first nonzero pixel of the specified column, or the
+	// height if the column is empty.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findFirstInColumn(const int x) const
+	{
+		return _firstInColumn[x];
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLastInColumn()
+	//
+	// Returns the row of the last nonzero pixel of the specified column, or -1 if
+	// the column is empty.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findLastInColumn(const int x) const
+	{
+		return _lastInColumn[x];
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findFirstRow()
+	//
+	// Returns the first of the specified rows with at least the specified number of
+	// nonzero pixels within the specified columns, or rows.end if there is none.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findFirstRow(const Range& rows, const Range& columns, const int minimumCount) const
+	{
+		for (int y = rows.start; y < rows.end; ++y)
+		{
+			if (countRectangle(Rect(columns.start, y, columns.size(), 1)) >= minimumCount)
+				return y;
+		}
+
+		return rows.end;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLastRow()
+	//
+	// Returns the last of the specified rows with at least the specified number of
+	// nonzero pixels within the specified columns, or rows.start - 1 if there is
+	// none.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findLastRow(const Range& rows, const Range& columns, const int minimumCount) const
+	{
+		for (int y = rows.end - 1; y >= rows.start; --y)
+		{
+			if (countRectangle(Rect(columns.start, y, columns.size(), 1)) >= minimumCount)
+				return y;
+		}
+
+		return rows.start - 1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findFirstColumn()
+	//
+	// Returns the first of the specified columns with at least the specified number
+	// of nonzero pixels within the specified rows, or columns.end if there is none.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findFirstColumn(const Range& columns, const Range& rows, const int minimumCount) const
+	{
+		for (int x = columns.start; x < columns.end; ++x)
+		{
+			if (countRectangle(Rect(x, rows.start, 1, rows.size())) >= minimumCount)
+				return x;
+		}
+
+		return columns.end;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// findLastColumn()
+	//
+	// Returns the last of the specified columns with at least the specified number
+	// of nonzero pixels within the specified rows, or columns.start - 1 if there is
+	// none.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::findLastColumn(const Range& columns, const Range& rows, const int minimumCount) const
+	{
+		for (int x = columns.end - 1; x >= columns.start; --x)
+		{
+			if (countRectangle(Rect(x, rows.start, 1, rows.size())) >= minimumCount)
+				return x;
+		}
+
+		return columns.start - 1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// size()
+	//
+	// Returns the size of the mask the profile was computed from.
+	//////////////////////////////////////////////////////////////////////////////////
+	Size ProjectionProfile::size() const
+	{
+		return _size;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// empty()
+	//
+	// Returns whether the profile was computed from an empty mask.
+	//////////////////////////////////////////////////////////////////////////////////
+	bool ProjectionProfile::empty() const
+	{
+		return _size.area() == 0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// hasRectangleSums()
+	//
+	// Returns whether the integral image was computed, so that any rectangle can be
+	// counted.
+	//////////////////////////////////////////////////////////////////////////////////
+	bool ProjectionProfile::hasRectangleSums() const
+	{
+		return !_integralImage.empty();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getIntegral()
+	//
+	// Returns the number of nonzero pixels above and left of the specified corner.
+	//////////////////////////////////////////////////////////////////////////////////
+	int ProjectionProfile::getIntegral(const int y, const int x) const
+	{
+		return _integralImage[static_cast<size_t>(y) * (_size.width + 1) + x];
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "BinaryMask.h"
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// ProjectionProfile
+	//
+	// The row and column projections of a mask, computed in one pass so that every
+	// rectangle search over the mask can share them. Each row and column keeps its
+	// count of nonzero pixels and its first and last nonzero pixel, and the counts
+	// are prefix summed, so rectangles that span every row or every column are
+	// counted by two lookups. A search within a band is done on the profile of the
+	// band alone. Only if rectangle sums are asked for is an integral image kept as
+	// well, at four bytes a pixel, so the count of any rectangle is four lookups.
+	// A packed mask is profiled from its words, without unpacking it.
+	//////////////////////////////////////////////////////////////////////////////////
+	class ProjectionProfile final
+	{
+	public:
+		ProjectionProfile();
+		explicit ProjectionProfile(const cv::Mat& mask, const bool hasRectangleSums = false);
+		explicit ProjectionProfile(const BinaryMask& mask, const bool hasRectangleSums = false);
+
+		int countRow(const int y) const;
+		int countColumn(const int x) const;
+		int countRectangle(const cv::Rect& rect) const;
+		int findFirstInRow(const int y) const;
+		int findLastInRow(const int y) const;
+		int findFirstInColumn(const int x) const;
+		int findLastInColumn(const int x) const;
+		int findFirstRow(const cv::Range& rows, const cv::Range& columns, const int minimumCount) const;
+		int findLastRow(const cv::Range& rows, const cv::Range& columns, const int minimumCount) const;
+		int findFirstColumn(const cv::Range& columns, const cv::Range& rows, const int minimumCount) const;
+		int findLastColumn(const cv::Range& columns, const cv::Range& rows, const int minimumCount) const;
+
+		cv::Size size() const;
+		bool empty() const;
+		bool hasRectangleSums() const;
+	private:
+		void build(const cv::Mat& mask, const bool hasRectangleSums);
+		void build(const BinaryMask& mask, const bool hasRectangleSums);
+		void reset(const cv::Size size, const bool hasRectangleSums);
+		void computePrefixSums();
+		int getIntegral(const int y, const int x) const;
+
+		cv::Size _size;
+		std::vector<int> _rowCounts;
+		std::vector<int> _columnCounts;
+		std::vector<int> _rowPrefixSums;		// The count of the rows above each row; one longer than the height.
+		std::vector<int> _columnPrefixSums;		// The count of the columns left of each column; one longer than the width.
+		std::vector<int> _firstInRow;			// The width where a row is empty.
+		std::vector<int> _lastInRow;			// -1 where a row is empty.
+		std::vector<int> _firstInColumn;		// The height where a column is empty.
+		std::vector<int> _lastInColumn;			// -1 where a column is empty.
+		std::vector<int> _integralImage;		// (height + 1) x (width + 1), or empty if there are no rectangle sums.
+	};
+}
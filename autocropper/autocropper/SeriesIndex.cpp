@@ -0,0 +1,132 @@
+#include "SeriesIndex.h"
+#include "FileUtilities.h"
+#include "ImageReader.h"
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// SeriesIndex()
+//
+// Create an empty index. Nothing is listed until a series is asked for.
+//////////////////////////////////////////////////////////////////////////////////
+SeriesIndex::SeriesIndex()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getStartingFilenames()
+//
+// Returns the first frame of every series in the specified directory, in the
+// order of the series names.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> SeriesIndex::getStartingFilenames(const string& directory)
+{
+	lock_guard<mutex> lock(_mutex);
+
+	const string directoryPrefix = FileUtilities::joinPath(directory, "");
+	scanDirectory(directoryPrefix);
+
+	vector<string> startingFilenames;
+
+	for (auto series = _series.lower_bound(directoryPrefix); series != _series.end() && series->first.compare(0, directoryPrefix.size(), directoryPrefix) == 0; ++series)
+	{
+		if (getDirectory(series->second.begin()->second) == directoryPrefix)	// Not a series of a subdirectory sharing the prefix.
+			startingFilenames.push_back(series->second.begin()->second);
+	}
+
+	return startingFilenames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFilenames()
+//
+// Returns every frame of the series the specified frame belongs to, in order of
+// image number. Returns nothing if there are no frames of that series. Throws if
+// two of its frames have the same image number.
+//////////////////////////////////////////////////////////////////////////////////
+vector<string> SeriesIndex::getFilenames(const string& frameFilename)
+{
+	lock_guard<mutex> lock(_mutex);
+
+	const string directory = getDirectory(frameFilename);
+	scanDirectory(directory);
+
+	vector<string> filenames;
+	const string seriesKey = getSeriesKey(directory, frameFilename.substr(directory.size()));
+	const auto series = _series.find(seriesKey);
+
+	if (series == _series.end())
+		return filenames;
+
+	const auto duplicateFrames = _duplicateFrames.find(seriesKey);
+	if (duplicateFrames != _duplicateFrames.end())
+		throw runtime_error(duplicateFrames->second);
+
+	for (const auto& frame : series->second)
+	{
+		filenames.push_back(frame.second);
+	}
+
+	return filenames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// scanDirectory()
+//
+// List the specified directory, unless it already has been, and index every
+// frame in it. The directory is as it prefixes the names of its files, ending
+// in a separator or empty for the working directory. Files that aren't images
+// are skipped, and the first clash of image numbers in a series is recorded.
+//////////////////////////////////////////////////////////////////////////////////
+void SeriesIndex::scanDirectory(const string& directory)
+{
+	if (!_scannedDirectories.insert(directory).second)
+		return;
+
+	for (const auto& filename : FileUtilities::listDirectory(directory.empty() ? "." : directory))
+	{
+		const int imageNumber = ImageReader::getImageNumber(filename);
+
+		if (imageNumber <= 0 || !ImageReader::isImageFilename(filename))
+			continue;
+
+		const string seriesKey = getSeriesKey(directory, filename);
+		map<int, string>& frames = _series[seriesKey];
+		const auto frame = frames.find(imageNumber);
+
+		if (frame == frames.end())
+			frames[imageNumber] = directory + filename;
+		else if (_duplicateFrames.find(seriesKey) == _duplicateFrames.end())
+			_duplicateFrames[seriesKey] = "Frames " + frame->second + " and " + directory + filename + " both have image number " + to_string(imageNumber) + ".";
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getDirectory()
+//
+// Returns the directory part of the specified filename, up to and including its
+// last separator, or an empty string if it has none.
+//////////////////////////////////////////////////////////////////////////////////
+string SeriesIndex::getDirectory(const string& filename)
+{
+	const size_t directoryEnd = filename.find_last_of("/\\");
+
+	return (directoryEnd == string::npos) ? string() : filename.substr(0, directoryEnd + 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSeriesKey()
+//
+// Returns the key of the series the specified file, in the specified directory,
+// belongs to: the same for every frame of one series, and only for them.
+//////////////////////////////////////////////////////////////////////////////////
+string SeriesIndex::getSeriesKey(const string& directory, const string& filename)
+{
+	const size_t extensionStart = filename.find_last_of(".");
+	const string extension = (extensionStart == string::npos) ? string() : filename.substr(extensionStart);
+
+	return directory + ImageReader::getSeriesName(filename) + "|" + extension;
+}
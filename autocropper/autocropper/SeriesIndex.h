@@ -0,0 +1,44 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// SeriesIndex
+	//
+	// Find the frames of series by listing their directories once, instead of
+	// checking for every frame a series might have. Files named
+	// [Prefix]_[Image Number].[File Extension] are grouped into a series by prefix
+	// and extension, with any number of frames, numbered with any number of
+	// digits, and with gaps. Only files ImageReader can decode are indexed. Two
+	// frames of a series with the same image number, such as x_01.png and
+	// x_001.png, make the series an error rather than one silently hiding the
+	// other. A directory is listed the first time a series in it is asked for, and
+	// the index can be shared by the threads of a batch.
+	//////////////////////////////////////////////////////////////////////////////////
+	class SeriesIndex final
+	{
+	public:
+		SeriesIndex();
+
+		std::vector<std::string> getStartingFilenames(const std::string& directory);
+		std::vector<std::string> getFilenames(const std::string& frameFilename);
+	private:
+		SeriesIndex(const SeriesIndex&) = delete;
+		SeriesIndex& operator=(const SeriesIndex&) = delete;
+
+		void scanDirectory(const std::string& directory);
+		static std::string getDirectory(const std::string& filename);
+		static std::string getSeriesKey(const std::string& directory, const std::string& filename);
+
+		std::mutex _mutex;
+		std::set<std::string> _scannedDirectories;
+		std::map<std::string, std::map<int, std::string>> _series;	// The frames of each series by image number, keyed by getSeriesKey().
+		std::map<std::string, std::string> _duplicateFrames;		// The first clash of image numbers in each series that has one, keyed by getSeriesKey().
+	};
+}
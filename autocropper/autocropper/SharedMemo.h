@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// SharedMemo
+	//
+	// Values computed at most once per key, by whichever thread asks for a key
+	// first. Threads that ask for a key while its value is being computed wait for
+	// it, and an exception thrown computing a value is rethrown to all of them.
+	// A memo with a maximum number of values forgets all of them once it is full.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename Key, typename Value>
+	class SharedMemo final
+	{
+	public:
+		explicit SharedMemo(const size_t maximumNumberOfValues = 0);
+
+		Value get(const Key& key, const std::function<Value()>& computeValue);
+		void clear();
+	private:
+		SharedMemo(const SharedMemo&) = delete;
+		SharedMemo& operator=(const SharedMemo&) = delete;
+
+		std::map<Key, std::shared_future<Value>> _values;
+		size_t _maximumNumberOfValues;	// 0 keeps every value.
+		std::mutex _mutex;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// SharedMemo()
+	//
+	// Create an empty memo which holds at most the specified number of values, or
+	// any number of them if it is 0.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename Key, typename Value>
+	SharedMemo<Key, Value>::SharedMemo(const size_t maximumNumberOfValues)
+		: _maximumNumberOfValues(maximumNumberOfValues)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// get()
+	//
+	// Returns the value of the specified key, computing it with computeValue if no
+	// thread has yet. Rethrows any exception computing the value threw.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename Key, typename Value>
+	Value SharedMemo<Key, Value>::get(const Key& key, const std::function<Value()>& computeValue)
+	{
+		std::promise<Value> computedValue;
+		std::shared_future<Value> value;
+		bool isComputing = false;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto entry = _values.find(key);
+
+			if (entry != _values.end())
+			{
+				value = entry->second;
+			}
+			else
+			{
+				// Threads waiting on a forgotten value hold their own future of it, so it can be dropped at any time.
+				if (_maximumNumberOfValues > 0 && _values.size() >= _maximumNumberOfValues)
+					_values.clear();
+
+				value = computedValue.get_future().share();
+				_values[key] = value;
+				isComputing = true;
+			}
+		}
+
+		if (isComputing)
+		{
+			try
+			{
+				computedValue.set_value(computeValue());
+			}
+			catch (...)
+			{
+				computedValue.set_exception(std::current_exception());
+			}
+		}
+
+		return value.get();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// clear()
+	//
+	// Forget every value.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename Key, typename Value>
+	void SharedMemo<Key, Value>::clear()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_values.clear();
+	}
+}
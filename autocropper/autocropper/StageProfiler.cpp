@@ -0,0 +1,360 @@
+#include "StageProfiler.h"
+#include "FileUtilities.h"
+#include <opencv2/core.hpp>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// StageStatistics()
+//
+// Statistics of a stage that hasn't run yet.
+//////////////////////////////////////////////////////////////////////////////////
+StageStatistics::StageStatistics()
+	: numberOfCalls(0),
+	wallSeconds(0),
+	cpuSeconds(0),
+	bytesAllocated(0),
+	framesProcessed(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// SeriesProfile()
+//
+// The profile of a series with no stages.
+//////////////////////////////////////////////////////////////////////////////////
+SeriesProfile::SeriesProfile()
+	: peakResidentBytes(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ScopedStage()
+//
+// Start timing the specified stage. Does nothing if the profiler is null.
+//////////////////////////////////////////////////////////////////////////////////
+StageProfiler::ScopedStage::ScopedStage(StageProfiler* profiler, const string& stageName)
+	: _profiler(profiler),
+	_startTicks(0),
+	_startCpuSeconds(0),
+	_poolBytes(0),
+	_enclosingPoolBytes(nullptr),
+	_bytesAllocated(0),
+	_framesProcessed(0)
+{
+	if (_profiler == nullptr)
+		return;
+
+	_stageName = stageName;
+	_enclosingPoolBytes = MatPool::setThreadAllocationCounter(&_poolBytes);
+	_startCpuSeconds = getThreadCpuSeconds();
+	_startTicks = getTickCount();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~ScopedStage()
+//
+// Stop timing and record the stage with the profiler.
+//////////////////////////////////////////////////////////////////////////////////
+StageProfiler::ScopedStage::~ScopedStage()
+{
+	if (_profiler == nullptr)
+		return;
+
+	const double wallSeconds = (getTickCount() - _startTicks) / getTickFrequency();
+	const double cpuSeconds = getThreadCpuSeconds() - _startCpuSeconds;
+
+	MatPool::setThreadAllocationCounter(_enclosingPoolBytes);
+	if (_enclosingPoolBytes != nullptr)
+		*_enclosingPoolBytes += _poolBytes;
+
+	_profiler->record(_stageName, wallSeconds, cpuSeconds, _bytesAllocated + _poolBytes, _framesProcessed);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// addFrames()
+//
+// Count the specified number of frames as processed by the stage.
+//////////////////////////////////////////////////////////////////////////////////
+void StageProfiler::ScopedStage::addFrames(const long long numberOfFrames)
+{
+	_framesProcessed += numberOfFrames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// addBytes()
+//
+// Count the specified number of bytes as allocated by the stage.
+//////////////////////////////////////////////////////////////////////////////////
+void StageProfiler::ScopedStage::addBytes(const size_t numberOfBytes)
+{
+	_bytesAllocated += numberOfBytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// addImage()
+//
+// Count the specified image as a frame the stage allocated and processed.
+//////////////////////////////////////////////////////////////////////////////////
+void StageProfiler::ScopedStage::addImage(const Mat& image)
+{
+	addFrames(1);
+	addBytes(image.total() * image.elemSize());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// StageProfiler()
+//
+// Create a profiler for the specified series.
+//////////////////////////////////////////////////////////////////////////////////
+StageProfiler::StageProfiler(const string& seriesName)
+	: _seriesName(seriesName)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// record()
+//
+// Add one run of the specified stage to its statistics.
+//////////////////////////////////////////////////////////////////////////////////
+void StageProfiler::record(const string& stageName, const double wallSeconds, const double cpuSeconds, const size_t bytesAllocated, const long long framesProcessed)
+{
+	lock_guard<mutex> lock(_mutex);
+
+	StageStatistics* stage = nullptr;
+	for (auto& existingStage : _stages)
+	{
+		if (existingStage.stageName == stageName)
+		{
+			stage = &existingStage;
+			break;
+		}
+	}
+
+	if (stage == nullptr)
+	{
+		_stages.push_back(StageStatistics());
+		stage = &_stages.back();
+		stage->stageName = stageName;
+	}
+
+	++stage->numberOfCalls;
+	stage->wallSeconds += wallSeconds;
+	stage->cpuSeconds += cpuSeconds;
+	stage->bytesAllocated += bytesAllocated;
+	stage->framesProcessed += framesProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getProfile()
+//
+// Returns the statistics recorded so far.
+//////////////////////////////////////////////////////////////////////////////////
+SeriesProfile StageProfiler::getProfile() const
+{
+	lock_guard<mutex> lock(_mutex);
+
+	SeriesProfile profile;
+	profile.seriesName = _seriesName;
+	profile.stages = _stages;
+	profile.peakResidentBytes = getPeakResidentBytes();
+
+	return profile;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeJson()
+//
+// Write the specified profiles as a JSON array with one object per series.
+//////////////////////////////////////////////////////////////////////////////////
+void StageProfiler::writeJson(const vector<SeriesProfile>& profiles, ostream& stream)
+{
+	stream << "[" << endl;
+
+	for (size_t i = 0; i < profiles.size(); ++i)
+	{
+		const SeriesProfile& profile = profiles[i];
+
+		stream << "  {\"series\": \"" << escapeJson(profile.seriesName) << "\", \"peak_resident_bytes\": " << profile.peakResidentBytes << ", \"stages\": [" << endl;
+
+		for (size_t j = 0; j < profile.stages.size(); ++j)
+		{
+			const StageStatistics& stage = profile.stages[j];
+
+			stream << "    {\"stage\": \"" << escapeJson(stage.stageName) << "\", \"calls\": " << stage.numberOfCalls
+				<< ", \"wall_seconds\": " << stage.wallSeconds << ", \"cpu_seconds\": " << stage.cpuSeconds
+				<< ", \"bytes_allocated\": " << stage.bytesAllocated << ", \"frames\": " << stage.framesProcessed << "}"
+				<< (j + 1 < profile.stages.size() ? "," : "") << endl;
+		}
+
+		stream << "  ]}" << (i + 1 < profiles.size() ? "," : "") << endl;
+	}
+
+	stream << "]" << endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeCsv()
+//
+// Write the specified profiles as CSV, one stage of one series per line.
+//////////////////////////////////////////////////////////////////////////////////
+void StageProfiler::writeCsv(const vector<SeriesProfile>& profiles, ostream& stream)
+{
+	stream << "series,stage,calls,wall_seconds,cpu_seconds,bytes_allocated,frames,peak_resident_bytes" << endl;
+
+	for (const auto& profile : profiles)
+	{
+		for (const auto& stage : profile.stages)
+		{
+			stream << FileUtilities::quoteCsv(profile.seriesName) << "," << FileUtilities::quoteCsv(stage.stageName) << "," << stage.numberOfCalls << ","
+				<< stage.wallSeconds << "," << stage.cpuSeconds << ","
+				<< stage.bytesAllocated << "," << stage.framesProcessed << ","
+				<< profile.peakResidentBytes << endl;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// writeProfiles()
+//
+// Write the specified profiles to the specified file, as CSV if its name ends in
+// .csv and as JSON otherwise. Returns false if the file couldn't be written.
+//////////////////////////////////////////////////////////////////////////////////
+bool StageProfiler::writeProfiles(const vector<SeriesProfile>& profiles, const string& filename)
+{
+	ofstream stream(filename);
+
+	if (!stream)
+		return false;
+
+	const string csvExtension = ".csv";
+	const bool isCsv = filename.size() >= csvExtension.size() && filename.compare(filename.size() - csvExtension.size(), csvExtension.size(), csvExtension) == 0;
+
+	if (isCsv)
+		writeCsv(profiles, stream);
+	else
+		writeJson(profiles, stream);
+
+	return static_cast<bool>(stream);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getThreadCpuSeconds()
+//
+// Returns the CPU time, user and kernel, the calling thread has used so far.
+//////////////////////////////////////////////////////////////////////////////////
+double StageProfiler::getThreadCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0;
+
+	ULARGE_INTEGER kernelTicks, userTicks;
+	kernelTicks.LowPart = kernelTime.dwLowDateTime;
+	kernelTicks.HighPart = kernelTime.dwHighDateTime;
+	userTicks.LowPart = userTime.dwLowDateTime;
+	userTicks.HighPart = userTime.dwHighDateTime;
+
+	return (kernelTicks.QuadPart + userTicks.QuadPart) * 1e-7;	// FILETIME counts 100 ns intervals.
+#else
+	timespec cpuTime;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuTime) != 0)
+		return 0;
+
+	return cpuTime.tv_sec + cpuTime.tv_nsec * 1e-9;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getPeakResidentBytes()
+//
+// Returns the most memory the process has had resident at once.
+//////////////////////////////////////////////////////////////////////////////////
+size_t StageProfiler::getPeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memoryCounters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+		return 0;
+
+	return memoryCounters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;	// Linux reports kilobytes.
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getResidentBytes()
+//
+// Returns the memory the process has resident now.
+//////////////////////////////////////////////////////////////////////////////////
+size_t StageProfiler::getResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memoryCounters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+		return 0;
+
+	return memoryCounters.WorkingSetSize;
+#else
+	ifstream statm("/proc/self/statm");
+	size_t totalPages = 0, residentPages = 0;
+	if (!(statm >> totalPages >> residentPages))
+		return 0;
+
+	return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// escapeJson()
+//
+// Returns the specified text with the characters JSON strings can't hold
+// escaped.
+//////////////////////////////////////////////////////////////////////////////////
+string StageProfiler::escapeJson(const string& text)
+{
+	string escapedText;
+
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escapedText += '\\';
+			escapedText += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			ostringstream escape;
+			escape << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c);
+			escapedText += escape.str();
+		}
+		else
+		{
+			escapedText += c;
+		}
+	}
+
+	return escapedText;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "MatPool.h"
+#include <opencv2/core.hpp>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// StageStatistics
+	//
+	// What a pipeline stage cost, summed over every time it ran.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct StageStatistics
+	{
+		StageStatistics();
+
+		std::string stageName;
+		int numberOfCalls;
+		double wallSeconds;
+		double cpuSeconds;			// CPU time of the thread that ran the stage; work it hands to other threads isn't included.
+		size_t bytesAllocated;		// Bytes of images the stage reported, or its thread had MatPool allocate; as with CPU time, other threads' aren't included.
+		long long framesProcessed;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// SeriesProfile
+	//
+	// The statistics of every stage of one series, in the order the stages first ran.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct SeriesProfile
+	{
+		SeriesProfile();
+
+		std::string seriesName;
+		std::vector<StageStatistics> stages;
+		size_t peakResidentBytes;	// Of the whole process, when the profile was taken.
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// StageProfiler
+	//
+	// Collects how long each stage of the pipeline takes for a series. Stages are
+	// timed by a ScopedStage, which costs two clock reads when profiling is on and
+	// nothing when its profiler is null.
+	//////////////////////////////////////////////////////////////////////////////////
+	class StageProfiler final
+	{
+	public:
+		//////////////////////////////////////////////////////////////////////////////////
+		// ScopedStage
+		//
+		// Times the enclosing scope as the specified stage. The bytes the calling
+		// thread has MatPool allocate meanwhile, from any pool or none, are counted
+		// against the stage, so series sharing a pool don't count each other's. A
+		// stage within another is counted against both.
+		//////////////////////////////////////////////////////////////////////////////////
+		class ScopedStage final
+		{
+		public:
+			ScopedStage(StageProfiler* profiler, const std::string& stageName);
+			~ScopedStage();
+
+			void addFrames(const long long numberOfFrames);
+			void addBytes(const size_t numberOfBytes);
+			void addImage(const cv::Mat& image);
+		private:
+			ScopedStage(const ScopedStage&) = delete;
+			ScopedStage& operator=(const ScopedStage&) = delete;
+
+			StageProfiler* _profiler;
+			std::string _stageName;
+			int64 _startTicks;
+			double _startCpuSeconds;
+			size_t _poolBytes;				// What the thread has had MatPool allocate since the stage began.
+			size_t* _enclosingPoolBytes;	// The counter of the stage this one is within, if any.
+			size_t _bytesAllocated;
+			long long _framesProcessed;
+		};
+
+		explicit StageProfiler(const std::string& seriesName);
+
+		void record(const std::string& stageName, const double wallSeconds, const double cpuSeconds, const size_t bytesAllocated, const long long framesProcessed);
+		SeriesProfile getProfile() const;
+
+		static void writeJson(const std::vector<SeriesProfile>& profiles, std::ostream& stream);
+		static void writeCsv(const std::vector<SeriesProfile>& profiles, std::ostream& stream);
+		static bool writeProfiles(const std::vector<SeriesProfile>& profiles, const std::string& filename);
+
+		static double getThreadCpuSeconds();
+		static size_t getPeakResidentBytes();
+		static size_t getResidentBytes();
+	private:
+		StageProfiler(const StageProfiler&) = delete;
+		StageProfiler& operator=(const StageProfiler&) = delete;
+
+		static std::string escapeJson(const std::string& text);
+
+		std::string _seriesName;
+		std::vector<StageStatistics> _stages;
+		mutable std::mutex _mutex;
+	};
+}
@@ -0,0 +1,209 @@
+#include "StaticBackground.h"
+#include "ExperimentalFunctions.h"
+#include "TiledOperations.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////
+// MedianStripBody
+//
+// Takes the per-pixel median of the images, one strip of rows at a time. The
+// values of each pixel are gathered next to each other before the median of
+// them is selected, so the images are read a row at a time.
+//////////////////////////////////////////////////////////////////////////////////
+class MedianStripBody final : public ParallelLoopBody
+{
+public:
+	MedianStripBody(const vector<Mat>& images, Mat& median, const int stripLength)
+		: _images(images),
+		_median(median),
+		_stripLength(stripLength)
+	{
+	}
+
+	void operator()(const Range& strips) const override
+	{
+		const size_t numberOfImages = _images.size();
+		const size_t middle = numberOfImages / 2;
+		vector<uchar> values(_median.cols * numberOfImages);
+
+		for (int y = strips.start * _stripLength; y < min(_median.rows, strips.end * _stripLength); ++y)
+		{
+			for (size_t i = 0; i < numberOfImages; ++i)
+			{
+				const uchar* row = _images[i].ptr<uchar>(y);
+
+				for (int x = 0; x < _median.cols; ++x)
+				{
+					values[x * numberOfImages + i] = row[x];
+				}
+			}
+
+			uchar* medianRow = _median.ptr<uchar>(y);
+
+			for (int x = 0; x < _median.cols; ++x)
+			{
+				const auto pixelValues = values.begin() + x * numberOfImages;
+				nth_element(pixelValues, pixelValues + middle, pixelValues + numberOfImages);
+				medianRow[x] = pixelValues[middle];
+			}
+		}
+	}
+private:
+	MedianStripBody& operator=(const MedianStripBody&) = delete;
+
+	const vector<Mat>& _images;
+	Mat& _median;
+	const int _stripLength;
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+// ForegroundStripBody
+//
+// Ors the foreground of every image into the union, one strip of rows at a
+// time. A pixel is foreground if it differs from the background by more than
+// the threshold. The difference, the threshold and the or are done in the same
+// loop, and each strip of the union stays in cache while every image is ored
+// into it.
+//////////////////////////////////////////////////////////////////////////////////
+class ForegroundStripBody final : public ParallelLoopBody
+{
+public:
+	ForegroundStripBody(const vector<Mat>& images, const Mat& background, const int threshold, Mat& foregroundUnion, const int stripLength)
+		: _images(images),
+		_background(background),
+		_threshold(threshold),
+		_foregroundUnion(foregroundUnion),
+		_stripLength(stripLength)
+	{
+	}
+
+	void operator()(const Range& strips) const override
+	{
+		for (int y = strips.start * _stripLength; y < min(_foregroundUnion.rows, strips.end * _stripLength); ++y)
+		{
+			const uchar* backgroundRow = _background.ptr<uchar>(y);
+			uchar* unionRow = _foregroundUnion.ptr<uchar>(y);
+
+			for (const auto& image : _images)
+			{
+				const uchar* row = image.ptr<uchar>(y);
+
+				for (int x = 0; x < _foregroundUnion.cols; ++x)
+				{
+					const int difference = row[x] - backgroundRow[x];
+					const uchar mask = (difference > _threshold || difference < -_threshold) ? 0xFF : 0;	// Branch free, so the loop vectorizes.
+					unionRow[x] |= row[x] & mask;
+				}
+			}
+		}
+	}
+private:
+	ForegroundStripBody& operator=(const ForegroundStripBody&) = delete;
+
+	const vector<Mat>& _images;
+	const Mat& _background;
+	const int _threshold;
+	Mat& _foregroundUnion;
+	const int _stripLength;
+};
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeBackground()
+//
+// Returns the background of the series under the specified model, the mean or
+// the median of its images.
+//////////////////////////////////////////////////////////////////////////////////
+Mat StaticBackground::computeBackground(const vector<Mat>& images, const BackgroundModel model)
+{
+	checkImages(images);
+
+	switch (model)
+	{
+	case BackgroundModel::Mean:
+		return experimental::computeAverageImage(images);
+	case BackgroundModel::Median:
+		return computeMedianImage(images);
+	default:
+		throw invalid_argument("Only the mean and median background models have a static background.");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeMedianImage()
+//
+// Returns the per-pixel median of the images, computed a strip of rows at a time
+// on every core. Of an even number of images, the upper of the middle two is
+// taken.
+//////////////////////////////////////////////////////////////////////////////////
+Mat StaticBackground::computeMedianImage(const vector<Mat>& images)
+{
+	checkImages(images);
+
+	Mat median(images[0].size(), CV_8UC1);
+
+	const int stripLength = OcvUtility::computeStripLength(images[0].cols * images.size(), 0);
+	const int numberOfStrips = (median.rows + stripLength - 1) / stripLength;
+
+	parallel_for_(Range(0, numberOfStrips), MedianStripBody(images, median, stripLength));
+
+	return median;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeForegroundUnion()
+//
+// Compute the or of the foreground images of the series against the specified
+// background in one pass over the series, without building a foreground image
+// per frame. The union is written into the specified image, which is reused if
+// it already has the right size and type.
+//////////////////////////////////////////////////////////////////////////////////
+void StaticBackground::computeForegroundUnion(const vector<Mat>& images, const Mat& background, const int threshold, Mat& foregroundUnion)
+{
+	checkImages(images);
+
+	if (background.size() != images[0].size() || background.type() != CV_8UC1)
+		throw invalid_argument("The background must be a single channel 8 bit image of the size of the series.");
+
+	foregroundUnion.create(images[0].size(), CV_8UC1);
+	foregroundUnion.setTo(Scalar(0));
+
+	const int stripLength = OcvUtility::computeStripLength(images[0].cols, 0);
+	const int numberOfStrips = (foregroundUnion.rows + stripLength - 1) / stripLength;
+
+	parallel_for_(Range(0, numberOfStrips), ForegroundStripBody(images, background, threshold, foregroundUnion, stripLength));
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeForegroundUnion()
+//
+// Compute the or of the foreground images of the series under the specified
+// model: one pass over the series for its background, and one for the union.
+//////////////////////////////////////////////////////////////////////////////////
+void StaticBackground::computeForegroundUnion(const vector<Mat>& images, const BackgroundModel model, const int threshold, Mat& foregroundUnion)
+{
+	computeForegroundUnion(images, computeBackground(images, model), threshold, foregroundUnion);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// checkImages()
+//
+// Throws unless there are images, and they are all single channel 8 bit images
+// of the same size.
+//////////////////////////////////////////////////////////////////////////////////
+void StaticBackground::checkImages(const vector<Mat>& images)
+{
+	if (images.empty())
+		throw invalid_argument("A background can't be found without images.");
+
+	for (const auto& image : images)
+	{
+		if (image.size() != images[0].size() || image.type() != CV_8UC1)
+			throw invalid_argument("Every image of the series must be a single channel 8 bit image of the same size.");
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace autocropper
+{
+	// How the foreground of a series is separated from its background.
+	enum class BackgroundModel
+	{
+		Mog2,	// A per-pixel Gaussian mixture, updated one frame at a time.
+		Mean,	// The mean of the series, thresholded.
+		Median	// The median of the series, thresholded.
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// StaticBackground
+	//
+	// Background subtraction for a fixed camera, where the container behind the
+	// plant doesn't change. The background of the whole series is taken in one
+	// pass, and the foreground union in a second one, rather than keeping a
+	// mixture of Gaussians per pixel. Both passes need the whole series, so these
+	// can't be used on a streamed or incremental series.
+	//////////////////////////////////////////////////////////////////////////////////
+	class StaticBackground final
+	{
+	public:
+		static cv::Mat computeBackground(const std::vector<cv::Mat>& images, const BackgroundModel model);
+		static cv::Mat computeMedianImage(const std::vector<cv::Mat>& images);
+		static void computeForegroundUnion(const std::vector<cv::Mat>& images, const cv::Mat& background, const int threshold, cv::Mat& foregroundUnion);
+		static void computeForegroundUnion(const std::vector<cv::Mat>& images, const BackgroundModel model, const int threshold, cv::Mat& foregroundUnion);
+	private:
+		static void checkImages(const std::vector<cv::Mat>& images);
+	};
+}
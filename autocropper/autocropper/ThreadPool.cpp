@@ -0,0 +1,88 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// ThreadPool()
+//
+// Start the specified number of worker threads. At least one worker is always
+// started.
+//////////////////////////////////////////////////////////////////////////////////
+ThreadPool::ThreadPool(const unsigned int numberOfThreads)
+	: _isStopping(false)
+{
+	const unsigned int numberOfWorkers = max(1u, numberOfThreads);
+
+	for (unsigned int i = 0; i < numberOfWorkers; ++i)
+	{
+		_workers.push_back(thread(&ThreadPool::runWorker, this));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~ThreadPool()
+//
+// Finish all queued tasks, then join the worker threads.
+//////////////////////////////////////////////////////////////////////////////////
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_isStopping = true;
+	}
+
+	_taskAvailable.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfThreads()
+//
+// Returns the number of worker threads in the pool.
+//////////////////////////////////////////////////////////////////////////////////
+unsigned int ThreadPool::getNumberOfThreads() const
+{
+	return static_cast<unsigned int>(_workers.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getDefaultNumberOfThreads()
+//
+// Returns the number of hardware threads, or 1 if that cannot be determined.
+//////////////////////////////////////////////////////////////////////////////////
+unsigned int ThreadPool::getDefaultNumberOfThreads()
+{
+	return max(1u, thread::hardware_concurrency());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// runWorker()
+//
+// Execute queued tasks until the pool is stopped and the queue is drained.
+//////////////////////////////////////////////////////////////////////////////////
+void ThreadPool::runWorker()
+{
+	while (true)
+	{
+		function<void()> task;
+
+		{
+			unique_lock<mutex> lock(_mutex);
+			_taskAvailable.wait(lock, [this]() { return _isStopping || !_tasks.empty(); });
+
+			if (_tasks.empty())
+				return;	// Only reachable when stopping.
+
+			task = move(_tasks.front());
+			_tasks.pop();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// ThreadPool
+	//
+	// A fixed number of worker threads which execute submitted tasks in the order
+	// they were submitted. The number of workers bounds how much work (e.g. image
+	// decodes) can be in flight at once.
+	//////////////////////////////////////////////////////////////////////////////////
+	class ThreadPool final
+	{
+	public:
+		explicit ThreadPool(const unsigned int numberOfThreads = getDefaultNumberOfThreads());
+		~ThreadPool();
+
+		template<typename Task> std::future<typename std::result_of<Task()>::type> submit(Task task);
+
+		unsigned int getNumberOfThreads() const;
+		static unsigned int getDefaultNumberOfThreads();
+	private:
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void runWorker();
+
+		std::vector<std::thread> _workers;
+		std::queue<std::function<void()>> _tasks;
+		std::mutex _mutex;
+		std::condition_variable _taskAvailable;
+		bool _isStopping;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// submit()
+	//
+	// Queue the specified task for execution. The returned future holds the task's
+	// result, or rethrows any exception the task threw.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename Task>
+	std::future<typename std::result_of<Task()>::type> ThreadPool::submit(Task task)
+	{
+		typedef typename std::result_of<Task()>::type ResultType;
+
+		// packaged_task is move-only, but std::function requires a copyable target.
+		auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(task);
+		std::future<ResultType> result = packagedTask->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.push([packagedTask]() { (*packagedTask)(); });
+		}
+
+		_taskAvailable.notify_one();
+
+		return result;
+	}
+}
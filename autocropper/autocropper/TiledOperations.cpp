@@ -0,0 +1,225 @@
+#include "TiledOperations.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace cv;
+using namespace std;
+
+namespace OcvUtility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// BitwiseStripBody
+	//
+	// Combines every image into the result, one strip of rows at a time. Each
+	// strip is ored or anded with every image while it is still in cache.
+	//////////////////////////////////////////////////////////////////////////////////
+	class BitwiseStripBody final : public ParallelLoopBody
+	{
+	public:
+		BitwiseStripBody(const vector<Mat>& images, Mat& result, const bool isOr, const int stripLength)
+			: _images(images),
+			_result(result),
+			_isOr(isOr),
+			_stripLength(stripLength)
+		{
+		}
+
+		void operator()(const Range& strips) const override
+		{
+			for (int strip = strips.start; strip < strips.end; ++strip)
+			{
+				const Range rows(strip * _stripLength, min(_result.rows, (strip + 1) * _stripLength));
+				Mat resultStrip = _result.rowRange(rows);
+
+				_images[0].rowRange(rows).copyTo(resultStrip);
+
+				for (size_t i = 1; i < _images.size(); ++i)
+				{
+					if (_isOr)
+						bitwise_or(resultStrip, _images[i].rowRange(rows), resultStrip);
+					else
+						bitwise_and(resultStrip, _images[i].rowRange(rows), resultStrip);
+				}
+			}
+		}
+	private:
+		BitwiseStripBody& operator=(const BitwiseStripBody&) = delete;
+
+		const vector<Mat>& _images;
+		Mat& _result;
+		const bool _isOr;
+		const int _stripLength;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// MorphologyStripBody
+	//
+	// Applies a morphological operation one strip at a time. Each strip is read
+	// with a halo of the lines around it that the operation can reach, so only its
+	// own lines are written and no seams appear between strips.
+	//////////////////////////////////////////////////////////////////////////////////
+	class MorphologyStripBody final : public ParallelLoopBody
+	{
+	public:
+		MorphologyStripBody(const Mat& source, Mat& destination, const bool isRowStrips, const int stripLength, const int halo, const int operation, const Mat& element, const Point anchor, const int iterations, const int borderType, const Scalar& borderValue)
+			: _source(source),
+			_destination(destination),
+			_isRowStrips(isRowStrips),
+			_stripLength(stripLength),
+			_halo(halo),
+			_operation(operation),
+			_element(element),
+			_anchor(anchor),
+			_iterations(iterations),
+			_borderType(borderType),
+			_borderValue(borderValue)
+		{
+		}
+
+		void operator()(const Range& strips) const override
+		{
+			const int numberOfLines = _isRowStrips ? _source.rows : _source.cols;
+
+			for (int strip = strips.start; strip < strips.end; ++strip)
+			{
+				const Range lines(strip * _stripLength, min(numberOfLines, (strip + 1) * _stripLength));
+				const Range haloLines(max(0, lines.start - _halo), min(numberOfLines, lines.end + _halo));
+				const Range linesInHalo(lines.start - haloLines.start, lines.end - haloLines.start);
+
+				// At the edges of the image the halo stops at the edge, so the border is handled as it is untiled.
+				Mat result;
+				morphologyEx(getLines(_source, haloLines), result, _operation, _element, _anchor, _iterations, _borderType, _borderValue);
+
+				Mat destinationStrip = getLines(_destination, lines);
+				getLines(result, linesInHalo).copyTo(destinationStrip);
+			}
+		}
+	private:
+		MorphologyStripBody& operator=(const MorphologyStripBody&) = delete;
+
+		Mat getLines(const Mat& image, const Range& lines) const
+		{
+			return _isRowStrips ? image.rowRange(lines) : image.colRange(lines);
+		}
+
+		const Mat& _source;
+		Mat& _destination;
+		const bool _isRowStrips;
+		const int _stripLength;
+		const int _halo;
+		const int _operation;
+		const Mat& _element;
+		const Point _anchor;
+		const int _iterations;
+		const int _borderType;
+		const Scalar _borderValue;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// tiledBitwise()
+	//
+	// Combine the images via an or or an and operation into the specified image,
+	// a strip at a time on every core. If the image is already the right size and
+	// type its buffer is reused.
+	//////////////////////////////////////////////////////////////////////////////////
+	void tiledBitwise(const vector<Mat>& images, Mat& result, const bool isOr)
+	{
+		if (images.empty())
+		{
+			result.release();
+			return;
+		}
+
+		for (const auto& image : images)
+		{
+			if (image.size() != images[0].size() || image.type() != images[0].type())
+				throw invalid_argument("Every image combined must have the same size and type.");
+
+			if (result.data == image.data)
+				result = Mat();	// Don't overwrite an image while it is still being read.
+		}
+
+		result.create(images[0].size(), images[0].type());
+
+		const int stripLength = computeStripLength(images[0].cols * images[0].elemSize(), 0);
+		const int numberOfStrips = (result.rows + stripLength - 1) / stripLength;
+
+		parallel_for_(Range(0, numberOfStrips), BitwiseStripBody(images, result, isOr, stripLength));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// tiledOr()
+	//
+	// Combine the images via an or operation into the specified image, a strip at
+	// a time on every core. Every image of a strip is ored into it before moving on,
+	// rather than reducing pairs of whole images, so each strip's result is read
+	// and written from cache and the reduction isn't limited by memory bandwidth.
+	//////////////////////////////////////////////////////////////////////////////////
+	void tiledOr(const vector<Mat>& images, Mat& orImage)
+	{
+		tiledBitwise(images, orImage, true);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// tiledAnd()
+	//
+	// Combine the images via an and operation into the specified image, a strip at
+	// a time on every core.
+	//////////////////////////////////////////////////////////////////////////////////
+	void tiledAnd(const vector<Mat>& images, Mat& andImage)
+	{
+		tiledBitwise(images, andImage, false);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// tiledMorphologyEx()
+	//
+	// morphologyEx() a strip at a time on every core. Strips run across the short
+	// side of the element -- rows for a horizontal line, columns for a vertical
+	// one -- so the halo each strip needs is as small as possible, and is none at
+	// all for a line. Images too small to be worth splitting are done in one go.
+	//////////////////////////////////////////////////////////////////////////////////
+	void tiledMorphologyEx(const Mat& source, Mat& destination, const int operation, const Mat& element, const Point anchor, const int iterations, const int borderType, const Scalar& borderValue)
+	{
+		const bool isRowStrips = (element.rows <= element.cols);
+		const int elementLength = isRowStrips ? element.rows : element.cols;
+		const int numberOfPasses = (operation == MORPH_ERODE || operation == MORPH_DILATE || operation == MORPH_GRADIENT) ? 1 : 2;	// Openings, closings and hats erode and dilate in turn.
+		const int halo = (elementLength - 1) * max(1, iterations) * numberOfPasses;
+
+		const size_t bytesPerLine = (isRowStrips ? source.cols : source.rows) * source.elemSize();
+		const int stripLength = computeStripLength(bytesPerLine, halo);
+		const int numberOfLines = isRowStrips ? source.rows : source.cols;
+		const int numberOfStrips = (numberOfLines + stripLength - 1) / stripLength;
+
+		if (numberOfStrips < 2 || getNumThreads() < 2)
+		{
+			morphologyEx(source, destination, operation, element, anchor, iterations, borderType, borderValue);
+			return;
+		}
+
+		Mat sourceImage = source;
+		if (destination.data == source.data)
+			sourceImage = source.clone();	// In place: every strip must read the original pixels.
+
+		destination.create(source.size(), source.type());
+
+		parallel_for_(Range(0, numberOfStrips), MorphologyStripBody(sourceImage, destination, isRowStrips, stripLength, halo, operation, element, anchor, iterations, borderType, borderValue));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeStripLength()
+	//
+	// Returns how many lines of the specified size go in a strip: enough to fill
+	// about TARGET_STRIP_BYTES, but never so few that reading the halo on either
+	// side costs more than the strip itself.
+	//////////////////////////////////////////////////////////////////////////////////
+	int computeStripLength(const size_t bytesPerLine, const int halo)
+	{
+		const int minimumStripLength = 8;
+		const int cacheStripLength = static_cast<int>(TARGET_STRIP_BYTES / max(bytesPerLine, static_cast<size_t>(1)));
+
+		return max(max(minimumStripLength, cacheStripLength), 2 * halo);
+	}
+}
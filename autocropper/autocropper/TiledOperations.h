@@ -0,0 +1,24 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////////
+// TiledOperations
+//
+// Whole-image operations split into strips small enough to stay in cache and
+// run on every core with cv::parallel_for_. Each gives exactly the image its
+// untiled OpenCV counterpart does.
+//////////////////////////////////////////////////////////////////////////////////
+namespace OcvUtility
+{
+	void tiledOr(const std::vector<cv::Mat>& images, cv::Mat& orImage);
+	void tiledAnd(const std::vector<cv::Mat>& images, cv::Mat& andImage);
+	void tiledBitwise(const std::vector<cv::Mat>& images, cv::Mat& result, const bool isOr);
+	void tiledMorphologyEx(const cv::Mat& source, cv::Mat& destination, const int operation, const cv::Mat& element, const cv::Point anchor = cv::Point(-1, -1), const int iterations = 1, const int borderType = cv::BORDER_CONSTANT, const cv::Scalar& borderValue = cv::morphologyDefaultBorderValue());
+
+	int computeStripLength(const size_t bytesPerLine, const int halo);
+
+	const size_t TARGET_STRIP_BYTES = 256 * 1024;	// About the size of a core's L2 cache.
+}
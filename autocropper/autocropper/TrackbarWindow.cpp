@@ -24,14 +24,14 @@ void TrackbarWindow::show(const Mat& image)
 	createTrackbar(_trackbarName, _windowName, &_sliderValue, _sliderMax, &onTrackbar, (void*)this);
 
 	onTrackbar(_sliderValue, (void*)this);
+	waitKey();	// The slider redraws the window from within here until a key is pressed.
 }
 
 void TrackbarWindow::onTrackbar(int trackbarPosition, void* userData)
 {
-	TrackbarWindow trackbarWindow = *(TrackbarWindow*)userData;
+	const TrackbarWindow& trackbarWindow = *(TrackbarWindow*)userData;
 
 	Mat dst = trackbarWindow._trackbarBody(trackbarWindow._image, trackbarWindow._sliderValue);
 
 	imshow(trackbarWindow._windowName, dst);
-	waitKey();
 }
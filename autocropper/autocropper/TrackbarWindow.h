@@ -7,7 +7,8 @@ namespace utility
 	//////////////////////////////////////////////////////////////////////////////////
 	// TrackbarWindow
 	//
-	// Encapsulate work required to create an OpenCV window with a trackbar.
+	// Encapsulate work required to create an OpenCV window with a trackbar. For
+	// tuning several crop region parameters at once, see TuningWindow.
 	//////////////////////////////////////////////////////////////////////////////////
 	class TrackbarWindow final
 	{
@@ -0,0 +1,220 @@
+#include "TuningWindow.h"
+#include "OcvUtilities.h"
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <iostream>
+
+using namespace autocropper;
+using namespace cv;
+using namespace std;
+using namespace utility;
+using namespace OcvUtility;
+
+const double TuningWindow::DEFAULT_PREVIEW_SCALE = 0.25;
+
+//////////////////////////////////////////////////////////////////////////////////
+// TuningWindow()
+//
+// Create a window for tuning the specified options on the specified foreground
+// union, which isn't modified. The preview is found at the specified scale.
+//////////////////////////////////////////////////////////////////////////////////
+TuningWindow::TuningWindow(const string& windowName, const Mat& foregroundUnion, const CropRegionOptions& options, const double previewScale)
+	: _windowName(windowName),
+	_baseOptions(options),
+	_previewScale(previewScale),
+	_verticalLinePercent(cvRound(options.verticalLineFraction * 100)),
+	_horizontalLinePercent(cvRound(options.horizontalLineFraction * 100)),
+	_closingElementWidth(options.closingElementSize.width),
+	_closingElementHeight(options.closingElementSize.height),
+	_rootRowSearchPercent(cvRound(options.rootRowSearchFraction * 100)),
+	_previewMemo(reduceForegroundUnion(foregroundUnion, previewScale), MEMO_VALUES_PER_STAGE),
+	_fullResolutionMemo(foregroundUnion, MEMO_VALUES_PER_STAGE),
+	_generation(0),
+	_fullResolutionGeneration(0),
+	_isFullResolutionUpdated(false),
+	_fullResolutionThreadPool(1)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// run()
+//
+// Show the window until Esc or Enter is pressed, then close it and return the
+// options the sliders were left at.
+//////////////////////////////////////////////////////////////////////////////////
+CropRegionOptions TuningWindow::run()
+{
+	const int ESCAPE_KEY = 27;
+	const int ENTER_KEY = 13;
+
+	namedWindow(_windowName, 0);
+	createTrackbar("Vertical %", _windowName, &_verticalLinePercent, 100, &onTrackbar, this);
+	createTrackbar("Horizontal %", _windowName, &_horizontalLinePercent, 100, &onTrackbar, this);
+	createTrackbar("Closing width", _windowName, &_closingElementWidth, 51, &onTrackbar, this);
+	createTrackbar("Closing height", _windowName, &_closingElementHeight, 51, &onTrackbar, this);
+	createTrackbar("Root search %", _windowName, &_rootRowSearchPercent, 100, &onTrackbar, this);
+
+	update();
+
+	while (true)
+	{
+		const int key = waitKey(FRAME_MILLISECONDS);	// Slider callbacks run in here, on this thread.
+		if (key == ESCAPE_KEY || key == ENTER_KEY)
+			break;
+
+		bool isFullResolutionUpdated = false;
+		{
+			lock_guard<mutex> lock(_mutex);
+			swap(isFullResolutionUpdated, _isFullResolutionUpdated);
+		}
+
+		if (isFullResolutionUpdated)
+			render();
+	}
+
+	destroyWindow(_windowName);
+
+	return getOptions();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getOptions()
+//
+// Returns the base options with the parameters the sliders are at. A slider at
+// 0 counts as its smallest usable value.
+//////////////////////////////////////////////////////////////////////////////////
+CropRegionOptions TuningWindow::getOptions() const
+{
+	CropRegionOptions options = _baseOptions;
+
+	options.verticalLineFraction = max(_verticalLinePercent, 1) / 100.0;
+	options.horizontalLineFraction = max(_horizontalLinePercent, 1) / 100.0;
+	options.closingElementSize = Size(max(_closingElementWidth, 1), max(_closingElementHeight, 1));
+	options.rootRowSearchFraction = max(_rootRowSearchPercent, 1) / 100.0;
+
+	return options;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// onTrackbar()
+//
+// Called by highgui when any slider of the window moves.
+//////////////////////////////////////////////////////////////////////////////////
+void TuningWindow::onTrackbar(int trackbarPosition, void* userData)
+{
+	static_cast<TuningWindow*>(userData)->update();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// reduceForegroundUnion()
+//
+// Returns the foreground union at the specified scale. A reduced pixel is set
+// wherever any of the pixels it covers is set, as the multi-resolution gel
+// detection does, so thin container edges survive the reduction.
+//////////////////////////////////////////////////////////////////////////////////
+Mat TuningWindow::reduceForegroundUnion(const Mat& foregroundUnion, const double scale)
+{
+	Mat nonZero, reducedImage;
+
+	compare(foregroundUnion, 0, nonZero, CMP_GT);
+	resize(nonZero, reducedImage, Size(), scale, scale, INTER_AREA);
+	threshold(reducedImage, reducedImage, 0, 255, THRESH_BINARY);
+
+	return reducedImage;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// update()
+//
+// Find the preview regions for the sliders' options and show them, and queue a
+// full resolution run, which makes any earlier run stale.
+//////////////////////////////////////////////////////////////////////////////////
+void TuningWindow::update()
+{
+	const CropRegionOptions options = getOptions();
+	const unsigned int generation = ++_generation;
+
+	CropRegionOptions previewOptions = options;
+	previewOptions.workingScale = 1.0;
+	previewOptions.closingElementSize = Size(max(1, cvRound(options.closingElementSize.width * _previewScale)), max(1, cvRound(options.closingElementSize.height * _previewScale)));
+
+	try
+	{
+		_previewRegion = _previewMemo.computeCropRegion(previewOptions);
+	}
+	catch (const exception&)
+	{
+		_previewRegion = Rect();	// Nothing found at these options; the full resolution run reports why.
+	}
+
+	render();
+
+	_fullResolutionThreadPool.submit([this, generation, options]()
+	{
+		computeFullResolutionRegion(generation, options);
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// render()
+//
+// Show the reduced union with the preview crop region in red, and the full
+// resolution one in green if it was found with the current options.
+//////////////////////////////////////////////////////////////////////////////////
+void TuningWindow::render()
+{
+	Mat display;
+	cvtColor(_previewMemo.getForegroundUnion(), display, COLOR_GRAY2BGR);
+	rectangle(display, _previewRegion, Scalar(0, 0, 255), 1);
+
+	{
+		lock_guard<mutex> lock(_mutex);
+
+		if (_fullResolutionGeneration == _generation)
+			rectangle(display, scaleRect(_fullResolutionRegion, _previewScale), Scalar(0, 255, 0), 1);
+	}
+
+	imshow(_windowName, display);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// computeFullResolutionRegion()
+//
+// Find the full resolution crop region for the specified options, unless a
+// slider has moved since they were queued. Staleness is checked again between
+// the gel and root system stages, so a stale run stops early.
+//////////////////////////////////////////////////////////////////////////////////
+void TuningWindow::computeFullResolutionRegion(const unsigned int generation, const CropRegionOptions& options)
+{
+	if (generation != _generation)
+		return;
+
+	Rect cropRegion;
+
+	try
+	{
+		_fullResolutionMemo.computeGelRegion(options);
+
+		if (generation != _generation)
+			return;
+
+		cropRegion = _fullResolutionMemo.computeCropRegion(options);	// The gel region is memoized by now.
+	}
+	catch (const exception& e)
+	{
+		cerr << "No crop region found at these options: " << e.what() << endl;
+	}
+
+	lock_guard<mutex> lock(_mutex);
+
+	if (generation == _generation)
+	{
+		_fullResolutionGeneration = generation;
+		_fullResolutionRegion = cropRegion;
+		_isFullResolutionUpdated = true;
+	}
+}
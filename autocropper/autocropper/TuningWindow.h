@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CropPipeline.h"
+#include "CropRegionMemo.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace autocropper
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// TuningWindow
+	//
+	// A window with a slider for each crop region detection parameter, showing the
+	// regions found in the foreground union of a series. Moving a slider redraws a
+	// reduced preview straight away, in red, while the full resolution regions
+	// are found on a background thread and drawn in green once they are current.
+	// A run that a later slider change has made stale stops at its next stage.
+	// Both resolutions keep a CropRegionMemo, so only the stages a slider affects
+	// are computed again.
+	//////////////////////////////////////////////////////////////////////////////////
+	class TuningWindow final
+	{
+	public:
+		TuningWindow(const std::string& windowName, const cv::Mat& foregroundUnion, const CropRegionOptions& options = CropRegionOptions(), const double previewScale = DEFAULT_PREVIEW_SCALE);
+
+		CropRegionOptions run();
+		CropRegionOptions getOptions() const;
+
+		static const double DEFAULT_PREVIEW_SCALE;
+	private:
+		TuningWindow(const TuningWindow&) = delete;
+		TuningWindow& operator=(const TuningWindow&) = delete;
+
+		static void onTrackbar(int trackbarPosition, void* userData);
+		static cv::Mat reduceForegroundUnion(const cv::Mat& foregroundUnion, const double scale);
+		void update();
+		void render();
+		void computeFullResolutionRegion(const unsigned int generation, const CropRegionOptions& options);
+
+		static const int FRAME_MILLISECONDS = 30;		// How often the window looks for a finished full resolution run.
+		static const size_t MEMO_VALUES_PER_STAGE = 16;	// Each full resolution closed container is the size of the gel.
+
+		std::string _windowName;
+		CropRegionOptions _baseOptions;
+		double _previewScale;
+		int _verticalLinePercent;
+		int _horizontalLinePercent;
+		int _closingElementWidth;
+		int _closingElementHeight;
+		int _rootRowSearchPercent;
+		CropRegionMemo _previewMemo;
+		CropRegionMemo _fullResolutionMemo;
+		cv::Rect _previewRegion;
+		std::atomic<unsigned int> _generation;			// Bumped by every slider change.
+		std::mutex _mutex;								// Guards the full resolution result below.
+		unsigned int _fullResolutionGeneration;
+		cv::Rect _fullResolutionRegion;
+		bool _isFullResolutionUpdated;
+		utility::ThreadPool _fullResolutionThreadPool;	// Last, so it finishes its runs before the members they use are destroyed.
+	};
+}
@@ -0,0 +1,157 @@
+#include "WorkStealingThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+using namespace utility;
+
+//////////////////////////////////////////////////////////////////////////////////
+// WorkStealingThreadPool()
+//
+// Start the specified number of worker threads, each with an empty task queue.
+// At least one worker is always started.
+//////////////////////////////////////////////////////////////////////////////////
+WorkStealingThreadPool::WorkStealingThreadPool(const unsigned int numberOfThreads)
+	: _isStopping(false)
+{
+	const unsigned int numberOfWorkers = max(1u, numberOfThreads);
+
+	_nextTaskQueue = 0;
+	_numberOfQueuedTasks = 0;
+
+	for (unsigned int i = 0; i < numberOfWorkers; ++i)
+	{
+		_taskQueues.push_back(unique_ptr<TaskQueue>(new TaskQueue()));
+	}
+
+	for (unsigned int i = 0; i < numberOfWorkers; ++i)
+	{
+		_workers.push_back(thread(&WorkStealingThreadPool::runWorker, this, i));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ~WorkStealingThreadPool()
+//
+// Finish all queued tasks, then join the worker threads.
+//////////////////////////////////////////////////////////////////////////////////
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+	{
+		lock_guard<mutex> lock(_idleMutex);
+		_isStopping = true;
+	}
+
+	_taskAvailable.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getNumberOfThreads()
+//
+// Returns the number of worker threads in the pool.
+//////////////////////////////////////////////////////////////////////////////////
+unsigned int WorkStealingThreadPool::getNumberOfThreads() const
+{
+	return static_cast<unsigned int>(_workers.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// push()
+//
+// Deal the specified task to the next worker's queue and wake an idle worker.
+//////////////////////////////////////////////////////////////////////////////////
+void WorkStealingThreadPool::push(function<void()> task)
+{
+	TaskQueue& taskQueue = *_taskQueues[_nextTaskQueue++ % _taskQueues.size()];
+
+	{
+		lock_guard<mutex> lock(taskQueue.mutex);
+		taskQueue.tasks.push_back(move(task));
+	}
+
+	{
+		lock_guard<mutex> lock(_idleMutex);	// Increment under the lock so an idle worker can't miss the notification.
+		++_numberOfQueuedTasks;
+	}
+
+	_taskAvailable.notify_one();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// tryPopOwnTask()
+//
+// Take the newest task from the specified worker's own queue.
+// Returns false if that queue is empty.
+//////////////////////////////////////////////////////////////////////////////////
+bool WorkStealingThreadPool::tryPopOwnTask(const unsigned int workerIndex, function<void()>& task)
+{
+	TaskQueue& taskQueue = *_taskQueues[workerIndex];
+	lock_guard<mutex> lock(taskQueue.mutex);
+
+	if (taskQueue.tasks.empty())
+		return false;
+
+	task = move(taskQueue.tasks.back());
+	taskQueue.tasks.pop_back();
+	--_numberOfQueuedTasks;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// tryStealTask()
+//
+// Take the oldest task from any other worker's queue, starting with the
+// specified worker's neighbor. Returns false if every other queue is empty.
+//////////////////////////////////////////////////////////////////////////////////
+bool WorkStealingThreadPool::tryStealTask(const unsigned int workerIndex, function<void()>& task)
+{
+	const unsigned int numberOfQueues = static_cast<unsigned int>(_taskQueues.size());
+
+	for (unsigned int offset = 1; offset < numberOfQueues; ++offset)
+	{
+		TaskQueue& taskQueue = *_taskQueues[(workerIndex + offset) % numberOfQueues];
+		lock_guard<mutex> lock(taskQueue.mutex);
+
+		if (taskQueue.tasks.empty())
+			continue;
+
+		task = move(taskQueue.tasks.front());
+		taskQueue.tasks.pop_front();
+		--_numberOfQueuedTasks;
+
+		return true;
+	}
+
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// runWorker()
+//
+// Execute tasks from the worker's own queue, or stolen from other queues, until
+// the pool is stopped and every queue is drained.
+//////////////////////////////////////////////////////////////////////////////////
+void WorkStealingThreadPool::runWorker(const unsigned int workerIndex)
+{
+	while (true)
+	{
+		function<void()> task;
+
+		if (tryPopOwnTask(workerIndex, task) || tryStealTask(workerIndex, task))
+		{
+			task();
+			continue;
+		}
+
+		unique_lock<mutex> lock(_idleMutex);
+		_taskAvailable.wait(lock, [this]() { return _isStopping || _numberOfQueuedTasks > 0; });
+
+		if (_isStopping && _numberOfQueuedTasks == 0)
+			return;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace utility
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// WorkStealingThreadPool
+	//
+	// A fixed number of worker threads, each with its own task queue. A worker runs
+	// the newest task in its own queue, and once that is empty steals the oldest
+	// task from another worker. Long and short tasks (e.g. plant series of very
+	// different sizes) therefore even out across the workers.
+	//////////////////////////////////////////////////////////////////////////////////
+	class WorkStealingThreadPool final
+	{
+	public:
+		explicit WorkStealingThreadPool(const unsigned int numberOfThreads = ThreadPool::getDefaultNumberOfThreads());
+		~WorkStealingThreadPool();
+
+		template<typename Task> std::future<typename std::result_of<Task()>::type> submit(Task task);
+
+		unsigned int getNumberOfThreads() const;
+	private:
+		WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+		WorkStealingThreadPool& operator=(const WorkStealingThreadPool&) = delete;
+
+		struct TaskQueue
+		{
+			std::deque<std::function<void()>> tasks;
+			std::mutex mutex;
+		};
+
+		void push(std::function<void()> task);
+		bool tryPopOwnTask(const unsigned int workerIndex, std::function<void()>& task);
+		bool tryStealTask(const unsigned int workerIndex, std::function<void()>& task);
+		void runWorker(const unsigned int workerIndex);
+
+		std::vector<std::unique_ptr<TaskQueue>> _taskQueues;
+		std::vector<std::thread> _workers;
+		std::atomic<unsigned int> _nextTaskQueue;
+		std::atomic<int> _numberOfQueuedTasks;
+		std::mutex _idleMutex;
+		std::condition_variable _taskAvailable;
+		bool _isStopping;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// submit()
+	//
+	// Queue the specified task for execution. The returned future holds the task's
+	// result, or rethrows any exception the task threw.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename Task>
+	std::future<typename std::result_of<Task()>::type> WorkStealingThreadPool::submit(Task task)
+	{
+		typedef typename std::result_of<Task()>::type ResultType;
+
+		// packaged_task is move-only, but std::function requires a copyable target.
+		auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(task);
+		std::future<ResultType> result = packagedTask->get_future();
+
+		push([packagedTask]() { (*packagedTask)(); });
+
+		return result;
+	}
+}
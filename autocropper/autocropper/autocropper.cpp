@@ -1,12 +1,31 @@
+#include "Accelerator.h"
+#include "BatchProcessor.h"
+#include "CommandLineArguments.h"
+#include "CropPipeline.h"
+#include "CropResultCache.h"
+#include "CropService.h"
+#include "CropSidecar.h"
+#include "DebugImageSink.h"
 #include "ExperimentalFunctions.h"
 #include "FileUtilities.h"
 #include "ImageReader.h"
+#include "IncrementalSeries.h"
 #include "OcvUtilities.h"
+#include "PackedSeries.h"
+#include "ParameterSweep.h"
+#include "SeriesIndex.h"
+#include "StageProfiler.h"
+#include "ThreadPool.h"
 #include "TrackbarWindow.h"
+#include "TuningWindow.h"
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 
 using namespace autocropper;
 using namespace cv;
@@ -15,114 +34,545 @@ using namespace std;
 using namespace utility;
 using namespace OcvUtility;
 
-Rect computeVerticalContainerBoundaries(Mat originalImage)
+CropRegionOptions parseCropRegionOptions(const CommandLineArguments& arguments)
 {
-	Mat verticalContainerBoundaries = findLargestVerticalLines(originalImage, 0.65);
-	imwrite("TestImages/DEBUG/VerticalContainerLines.png", verticalContainerBoundaries);
-	
-	// If the container is not centered perfectly in front of the camera (which is likely),
-	// then the vertical edges of the container will appear as thick lines in the background subtracted image.
-	Rect verticalContainerRegion = computeInnermostRectangle(verticalContainerBoundaries);
-	
-	return verticalContainerRegion;
+	CropRegionOptions options;
+
+	options.workingScale = arguments.getDoubleOption("scale", options.workingScale);
+	options.refinementBand = arguments.getIntegerOption("refine-band", options.refinementBand);
+	options.rootRowSearchFraction = arguments.getDoubleOption("root-search", options.rootRowSearchFraction);
+
+	const string lineDetectionMethod = arguments.getOption("lines", "morphology");
+	if (lineDetectionMethod == "morphology")
+		options.lineDetectionMethod = LineDetectionMethod::Morphology;
+	else if (lineDetectionMethod == "runlength")
+		options.lineDetectionMethod = LineDetectionMethod::RunLength;
+	else
+		throw invalid_argument("--lines must be morphology or runlength.");
+
+	const string largestComponentMethod = arguments.getOption("component", "pixels");
+	if (largestComponentMethod == "pixels")
+		options.largestComponentMethod = LargestComponentMethod::ConnectedComponents;
+	else if (largestComponentMethod == "contours")
+		options.largestComponentMethod = LargestComponentMethod::Contours;
+	else
+		throw invalid_argument("--component must be pixels or contours.");
+
+	const string backgroundModel = arguments.getOption("background", "mog2");
+	if (backgroundModel == "mog2")
+		options.backgroundModel = BackgroundModel::Mog2;
+	else if (backgroundModel == "mean")
+		options.backgroundModel = BackgroundModel::Mean;
+	else if (backgroundModel == "median")
+		options.backgroundModel = BackgroundModel::Median;
+	else
+		throw invalid_argument("--background must be mog2, mean or median.");
+
+	options.backgroundThreshold = arguments.getIntegerOption("background-threshold", options.backgroundThreshold);
+	options.coarseFrameStride = arguments.getIntegerOption("subsample", options.coarseFrameStride);
+	options.convergenceFraction = arguments.getDoubleOption("converge", options.convergenceFraction);
+
+	if (options.coarseFrameStride < 1)
+		throw invalid_argument("--subsample must be at least 1.");
+
+	if (options.convergenceFraction < 0)
+		throw invalid_argument("--converge must not be negative.");
+
+	if (options.backgroundThreshold < 0 || options.backgroundThreshold > 255)
+		throw invalid_argument("--background-threshold must be from 0 to 255.");
+
+	if (options.workingScale <= 0 || options.workingScale > 1)
+		throw invalid_argument("--scale must be greater than 0 and at most 1.");
+
+	if (options.rootRowSearchFraction <= 0 || options.rootRowSearchFraction > 1)
+		throw invalid_argument("--root-search must be greater than 0 and at most 1.");
+
+	if (options.refinementBand < 0)
+		throw invalid_argument("--refine-band must not be negative.");
+
+	return options;
+}
+
+void configureAccelerator(const CommandLineArguments& arguments)
+{
+	const string accelerator = arguments.getOption("accelerator", "cpu");
+	if (accelerator == "opencl")
+	{
+		if (Accelerator::enable())
+			cout << "Running on OpenCL device: " << Accelerator::getDeviceName() << endl;
+		else
+			cerr << "No OpenCL device is available; running on the CPU." << endl;
+	}
+	else if (accelerator != "cpu")
+	{
+		throw invalid_argument("--accelerator must be opencl or cpu.");
+	}
+}
+
+CropOutputOptions parseCropOutputOptions(const CommandLineArguments& arguments)
+{
+	CropOutputOptions outputOptions;
+
+	outputOptions.format = arguments.getOption("output-format", outputOptions.format);
+	outputOptions.pngCompressionLevel = arguments.getIntegerOption("png-compression", outputOptions.pngCompressionLevel);
+
+	const string output = arguments.getOption("output", "images");
+	if (output != "images" && output != "sidecar" && output != "both")
+		throw invalid_argument("--output must be images, sidecar or both.");
+
+	outputOptions.writeImages = (output != "sidecar");
+	outputOptions.writeSidecar = (output != "images");
+
+	if (!outputOptions.isValid())
+		throw invalid_argument("--output-format must be png, bmp, pgm or tif, and --png-compression must be from 0 to 9.");
+
+	return outputOptions;
+}
+
+unique_ptr<CropResultCache> createResultCache(const CommandLineArguments& arguments)
+{
+	if (!arguments.hasOption("cache"))
+		return nullptr;
+
+	return unique_ptr<CropResultCache>(new CropResultCache(arguments.getOption("cache"), arguments.hasOption("cache-union")));
+}
+
+void runStreamingPipeline(const string& startingFilename, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, StageProfiler* profiler)
+{
+	ThreadPool threadPool;
+	SeriesIndex seriesIndex;
+	const vector<string> filenames = seriesIndex.getFilenames(startingFilename);	// Listed once, so both passes and the sidecar see the same frames.
+	CropSidecar sidecar = CropSidecar::create(ImageReader::getSeriesName(startingFilename), filenames, Rect(), Rect());
+	const string cacheKey = (resultCache != nullptr) ? CropResultCache::computeKey(sidecar.sourceFilenames, options, profiler) : string();
+
+	if (resultCache == nullptr || !resultCache->lookup(cacheKey, sidecar))
+	{
+		Mat foregroundUnion;
+		Mat* foregroundUnionOut = (resultCache != nullptr && resultCache->isStoringForegroundUnion()) ? &foregroundUnion : nullptr;
+		int framesUsed = 0;
+		sidecar.cropRegion = computeCropRegionStreaming(filenames, threadPool, options, nullptr, profiler, &sidecar.gelRegion, foregroundUnionOut, &framesUsed);
+		cout << "Frames used: " << framesUsed << endl;
+
+		if (resultCache != nullptr)
+			resultCache->store(cacheKey, sidecar, foregroundUnion);
+	}
+
+	if (outputOptions.writeSidecar)
+		sidecar.write(DEFAULT_OUTPUT_DIRECTORY + CropSidecar::DEFAULT_FILENAME);
+
+	// Without images to write, the second pass over the series isn't needed.
+	if (outputOptions.writeImages)
+		cropOriginalImagesStreaming(filenames, threadPool, sidecar.cropRegion, DEFAULT_OUTPUT_DIRECTORY, outputOptions, profiler);
 }
 
-Rect computeHorizontalContainerBoundaries(Mat verticalContainerImage)
+void runPipeline(const string& startingFilename, const CropRegionOptions& options, const CropOutputOptions& outputOptions, const CropResultCache* resultCache, StageProfiler* profiler)
 {
-	Mat horizontalContainerBoundaries = findLargestHorizontalLines(verticalContainerImage, 0.9);
-	imwrite("TestImages/DEBUG/HorizontalContainerLines.png", horizontalContainerBoundaries);
-	Rect horizontalContainerRegion = computeInnermostRectangle(horizontalContainerBoundaries);
+	const bool isPackedSeries = PackedSeries::isPackedSeries(startingFilename);
+	SeriesIndex seriesIndex;
+	const vector<string> filenames = isPackedSeries ? vector<string>() : seriesIndex.getFilenames(startingFilename);
+	CropSidecar sidecar = isPackedSeries ? CropSidecar::create(startingFilename, Rect(), Rect()) : CropSidecar::create(ImageReader::getSeriesName(startingFilename), filenames, Rect(), Rect());
+	const string cacheKey = (resultCache != nullptr) ? CropResultCache::computeKey(sidecar.sourceFilenames, options, profiler) : string();
+	const bool isCached = (resultCache != nullptr && resultCache->lookup(cacheKey, sidecar));
 
-	return horizontalContainerRegion;
+	// A cached series only needs reading if its images are to be cropped. A packed series is mapped, so its frames are views that keep it open.
+	unique_ptr<PackedSeries> packedSeries;
+	vector<Mat> originalImages;
+	if (!isCached || outputOptions.writeImages)
+	{
+		StageProfiler::ScopedStage stage(profiler, "readDataset");
+
+		if (isPackedSeries)
+		{
+			packedSeries.reset(new PackedSeries(startingFilename));
+			originalImages = packedSeries->getFrames();
+		}
+		else
+		{
+			ThreadPool threadPool;
+			originalImages = ImageReader::readImages(filenames, threadPool);
+		}
+
+		for (const auto& image : originalImages)
+		{
+			stage.addImage(image);
+		}
+	}
+
+	if (!isCached)
+	{
+		Mat foregroundUnion;
+		Mat* foregroundUnionOut = (resultCache != nullptr && resultCache->isStoringForegroundUnion()) ? &foregroundUnion : nullptr;
+		int framesUsed = 0;
+		sidecar.cropRegion = computeSeriesCropRegion(originalImages, options, nullptr, profiler, &sidecar.gelRegion, foregroundUnionOut, &framesUsed);
+		cout << "Frames used: " << framesUsed << " of " << originalImages.size() << endl;
+
+		if (resultCache != nullptr)
+			resultCache->store(cacheKey, sidecar, foregroundUnion);
+	}
+
+	if (outputOptions.writeSidecar)
+		sidecar.write(DEFAULT_OUTPUT_DIRECTORY + CropSidecar::DEFAULT_FILENAME);
+
+	if (outputOptions.writeImages)
+		cropOriginalImages(originalImages, sidecar.cropRegion, DEFAULT_OUTPUT_DIRECTORY, outputOptions, profiler);
 }
 
-//TODO: Elaborate via comments how this is really the gel and not the container.
-Rect computeGelRegion(Mat originalImage)
+void runIncrementalPipeline(const string& startingFilename, const string& stateDirectory, const CropRegionOptions& options, const CropOutputOptions& outputOptions, StageProfiler* profiler)
 {
-	Rect verticalContainerLines = computeVerticalContainerBoundaries(originalImage);
-	Mat verticalContainerImage = originalImage(verticalContainerLines);
-	imwrite("TestImages/DEBUG/VerticalContainerImage.png", verticalContainerImage);
+	ThreadPool threadPool;
+	IncrementalSeries series(startingFilename, options);
 
-	auto elem = getStructuringElement(MORPH_RECT, Size(11, 9));
-	Mat tmpVerticalContainerImage;
-	morphologyEx(verticalContainerImage, tmpVerticalContainerImage, MORPH_CLOSE, elem);
+	const bool isResumed = series.load(stateDirectory, threadPool);
+	const Rect previousCropRegion = series.getCropRegion();
+	const vector<string> addedFilenames = series.update(threadPool, profiler);
 
-	Rect horizontalContainerLines = computeHorizontalContainerBoundaries(tmpVerticalContainerImage);
-	Mat containerImage = verticalContainerImage(horizontalContainerLines);
-	imwrite("TestImages/DEBUG/ContainerImage.png", containerImage);
+	cout << "Frames added: " << addedFilenames.size() << " of " << series.getSidecar().sourceFilenames.size() << endl;
 
-	Rect gelRegionWRToriginal = Rect(verticalContainerLines.x + horizontalContainerLines.x, verticalContainerLines.y + horizontalContainerLines.y, horizontalContainerLines.width, horizontalContainerLines.height);
+	if (!FileUtilities::createDirectories(stateDirectory))
+		throw runtime_error("Unable to create state directory: " + stateDirectory);
 
-	return gelRegionWRToriginal;
+	series.save(stateDirectory);	// Saved even when too few frames have arrived, so they needn't be processed again.
+
+	if (series.getNumberOfFramesProcessed() < 2)
+		throw runtime_error("At least two images are needed to separate the foreground from the background.");
+
+	if (outputOptions.writeSidecar)
+		series.getSidecar().write(DEFAULT_OUTPUT_DIRECTORY + CropSidecar::DEFAULT_FILENAME);
+
+	// Frames cropped on an earlier run are still right if the crop region didn't move.
+	if (outputOptions.writeImages)
+	{
+		const bool isCropRegionUnchanged = isResumed && series.getCropRegion() == previousCropRegion;
+		cropOriginalFrames(isCropRegionUnchanged ? addedFilenames : series.getSidecar().sourceFilenames, threadPool, series.getCropRegion(), DEFAULT_OUTPUT_DIRECTORY, outputOptions, profiler);
+	}
 }
 
-Rect computeCropRegion(Mat img)
+int runPack(const CommandLineArguments& arguments, const string& startingFilename)
 {
-	// Draw original image.
-	Mat orig = img.clone();
-	imwrite("TestImages/1foregroundORImage.png", orig);
+	const string encoding = arguments.getOption("pack-encoding", "raw");
+	if (encoding != "raw" && encoding != "png")
+		throw invalid_argument("--pack-encoding must be raw or png.");
 
-	// Compute image cropped to the gel boundary.
-	Rect gelRegion = computeGelRegion(img);
-	imwrite("TestImages/2highlightedGel.png", drawRedRectOnImage(orig, gelRegion, 3));
-	Mat containerImage = img(gelRegion);
+	string packedFilename = arguments.getOption("pack");
+	if (!PackedSeries::isPackedSeries(packedFilename))
+		packedFilename += PackedSeries::EXTENSION;
 
-	// Find the root system within the gel.
-	keepOnlyLargestContour(containerImage);
-	Mat rootSystem = containerImage;
-	imwrite("TestImages/DEBUG/PossibleRootSystem.png", containerImage);
+	ThreadPool threadPool;
+	const int numberOfFrames = PackedSeries::pack(startingFilename, packedFilename, encoding == "raw" ? PackedFrameEncoding::Raw : PackedFrameEncoding::Png, threadPool);
 
-	int rowPositionWithMaximumBlackPixels = computeRowWithMaximumBlackPixels(containerImage);
-	Rect rootRectangle = computeMaximumRootExtents(containerImage, rowPositionWithMaximumBlackPixels);
-	Rect rootRectangleWRToriginal = Rect(rootRectangle.x + gelRegion.x, rootRectangle.y + gelRegion.y, rootRectangle.width, rootRectangle.height);
-	Mat rootImage = containerImage(rootRectangle);
-	imwrite("TestImages/DEBUG/AA_FINALTEST_ROOT.png", rootImage);
-	imwrite("TestImages/3highlightedRoots.png", drawRedRectOnImage(orig, rootRectangleWRToriginal, 3));
+	cout << "Frames packed: " << numberOfFrames << " into " << packedFilename << endl;
 
-	return rootRectangleWRToriginal;
+	return EXIT_SUCCESS;
 }
 
-void cropOriginalImages(vector<Mat> originalImages, Rect cropRegion)
+bool writeProfiles(const CommandLineArguments& arguments, const vector<SeriesProfile>& profiles)
 {
-	const string outputDirectory = "TestImages/CroppedImages/";
-	const string outputExtension = ".png";
-	int i = 1;
+	const string profileFilename = arguments.getOption("profile");
 
-	for (auto image : originalImages)
+	if (!StageProfiler::writeProfiles(profiles, profileFilename))
 	{
-		stringstream ss;
-		ss << outputDirectory << i++ << outputExtension;
-		string str = ss.str();
-		imwrite(str, image(cropRegion));
-		ss.clear();
+		cerr << "Unable to write profile: " << profileFilename << endl;
+		return false;
 	}
+
+	return true;
 }
 
-int main(int argc, char** argv)
+int runBatch(const CommandLineArguments& arguments)
+{
+	const string directoryOrManifest = arguments.getOption("batch");
+
+	if (!FileUtilities::fileExists(directoryOrManifest))
+	{
+		cerr << "Specified batch directory or manifest doesn't exist: " << directoryOrManifest << endl;
+		cerr << "Exiting..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	SeriesIndex seriesIndex;	// Each directory of the batch is listed once, by whichever of findSeries() and processSeries() needs it first.
+	vector<string> startingFilenames = BatchProcessor::findSeries(directoryOrManifest, &seriesIndex);
+	cout << "Number of series found: " << startingFilenames.size() << endl;
+
+	const unique_ptr<CropResultCache> resultCache = createResultCache(arguments);
+	const CropRegionOptions options = parseCropRegionOptions(arguments);
+	const CropOutputOptions outputOptions = parseCropOutputOptions(arguments);
+	vector<SeriesResult> results;
+
+	if (arguments.hasOption("pipeline"))
+	{
+		const int queueCapacity = arguments.getIntegerOption("queue", BatchProcessor::DEFAULT_QUEUE_CAPACITY);
+
+		if (queueCapacity < 1)
+			throw invalid_argument("--queue must be at least 1.");
+
+		results = BatchProcessor::processSeriesPipelined(startingFilenames, DEFAULT_OUTPUT_DIRECTORY, options, outputOptions, resultCache.get(), &seriesIndex, queueCapacity);
+	}
+	else
+	{
+		results = BatchProcessor::processSeries(startingFilenames, DEFAULT_OUTPUT_DIRECTORY, options, outputOptions, resultCache.get(), &seriesIndex);
+	}
+
+	if (arguments.hasOption("summary"))
+	{
+		ofstream summary(arguments.getOption("summary"));
+		BatchProcessor::writeSummary(results, summary);
+	}
+	else
+	{
+		BatchProcessor::writeSummary(results, cout);
+	}
+
+	if (arguments.hasOption("profile") && !writeProfiles(arguments, BatchProcessor::getProfiles(results)))
+		return EXIT_FAILURE;
+
+	for (const auto& result : results)
+	{
+		if (!result.succeeded)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int runTuning(const string& startingFilename, const CropRegionOptions& options)
+{
+	Mat foregroundUnion;
+	{
+		unique_ptr<PackedSeries> packedSeries;
+		vector<Mat> originalImages;
+
+		if (PackedSeries::isPackedSeries(startingFilename))
+		{
+			packedSeries.reset(new PackedSeries(startingFilename));
+			originalImages = packedSeries->getFrames();
+		}
+		else
+		{
+			SeriesIndex seriesIndex;
+			ThreadPool threadPool;
+			originalImages = ImageReader::readImages(seriesIndex.getFilenames(startingFilename), threadPool);
+		}
+
+		// The union is tuned on as a full run sees it, so every frame is added even if the options subsample.
+		CropRegionOptions unionOptions = options;
+		unionOptions.coarseFrameStride = 1;
+		accumulateSeriesForegroundUnion(originalImages, unionOptions, foregroundUnion);
+	}	// Only the union is tuned on, so the frames needn't stay in memory.
+
+	TuningWindow tuningWindow(ImageReader::getSeriesName(startingFilename), foregroundUnion, options);
+	const CropRegionOptions tunedOptions = tuningWindow.run();
+
+	cout << "Vertical fraction: " << tunedOptions.verticalLineFraction << endl;
+	cout << "Horizontal fraction: " << tunedOptions.horizontalLineFraction << endl;
+	cout << "Closing element: " << tunedOptions.closingElementSize.width << "x" << tunedOptions.closingElementSize.height << endl;
+	cout << "Root search fraction: " << tunedOptions.rootRowSearchFraction << endl;
+
+	return EXIT_SUCCESS;
+}
+
+SweepGrid parseSweepGrid(const CommandLineArguments& arguments, const CropRegionOptions& options)
+{
+	SweepGrid grid(options);
+
+	grid.verticalLineFractions = arguments.getDoubleListOption("sweep-vertical", options.verticalLineFraction);
+	grid.horizontalLineFractions = arguments.getDoubleListOption("sweep-horizontal", options.horizontalLineFraction);
+	grid.rootRowSearchFractions = arguments.getDoubleListOption("sweep-root-search", options.rootRowSearchFraction);
+
+	if (arguments.hasOption("sweep-closing"))
+	{
+		grid.closingElementSizes.clear();
+
+		for (const auto& value : arguments.getListOption("sweep-closing"))
+		{
+			istringstream size(value);
+			int width = 0, height = 0;
+			char separator = 0;
+
+			if (!(size >> width >> separator >> height) || separator != 'x' || !size.eof() || width < 1 || height < 1)
+				throw invalid_argument("--sweep-closing must be a list of sizes such as 11x9, got: " + value);
+
+			grid.closingElementSizes.push_back(Size(width, height));
+		}
+	}
+
+	for (const auto& fractions : { grid.verticalLineFractions, grid.horizontalLineFractions, grid.rootRowSearchFractions })
+	{
+		for (const auto fraction : fractions)
+		{
+			if (fraction <= 0 || fraction > 1)
+				throw invalid_argument("Swept fractions must be greater than 0 and at most 1.");
+		}
+	}
+
+	return grid;
+}
+
+int runSweep(const CommandLineArguments& arguments)
+{
+	const string directoryOrManifest = arguments.getOption("sweep");
+
+	if (!FileUtilities::fileExists(directoryOrManifest))
+	{
+		cerr << "Specified sweep directory or manifest doesn't exist: " << directoryOrManifest << endl;
+		cerr << "Exiting..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	const CropRegionOptions options = parseCropRegionOptions(arguments);
+	const SweepGrid grid = parseSweepGrid(arguments, options);
+
+	SeriesIndex seriesIndex;
+	vector<string> startingFilenames = BatchProcessor::findSeries(directoryOrManifest, &seriesIndex);
+	cout << "Number of series found: " << startingFilenames.size() << ", points per series: " << grid.getNumberOfPoints() << endl;
+
+	const unique_ptr<CropResultCache> resultCache = createResultCache(arguments);
+	const vector<SweepResult> results = ParameterSweep::sweepSeries(startingFilenames, options, grid, resultCache.get(), &seriesIndex);
+
+	if (arguments.hasOption("summary"))
+	{
+		ofstream summary(arguments.getOption("summary"));
+		ParameterSweep::writeTable(results, summary);
+	}
+	else
+	{
+		ParameterSweep::writeTable(results, cout);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int runService(const CommandLineArguments& arguments)
+{
+	const int pollMilliseconds = arguments.getIntegerOption("poll-ms", 50);
+
+	if (pollMilliseconds < 1)
+		throw invalid_argument("--poll-ms must be at least 1.");
+
+	const unique_ptr<CropResultCache> resultCache = createResultCache(arguments);
+	CropService service(arguments.getOption("serve"), parseCropRegionOptions(arguments), parseCropOutputOptions(arguments), resultCache.get(), pollMilliseconds);
+	service.run();
+
+	return EXIT_SUCCESS;
+}
+
+int run(const CommandLineArguments& arguments)
 {
-	if (argv[1] == 0)
+	configureAccelerator(arguments);
+
+	if (arguments.hasOption("serve"))
+		return runService(arguments);
+
+	if (arguments.hasOption("sweep"))
+		return runSweep(arguments);
+
+	if (arguments.hasOption("batch"))
+		return runBatch(arguments);
+
+	if (arguments.getPositionalArguments().empty())
 	{
 		cerr << "No starting file specified." << endl;
+		cerr << "Usage: autocropper <starting file> [--stream | --state=<directory>] [options]" << endl;
+		cerr << "       autocropper --batch=<directory or manifest> [--summary=<csv file>] [--pipeline [--queue=<n>]] [options]" << endl;
+		cerr << "       autocropper <starting file> --pack=<file> [--pack-encoding=raw|png]" << endl;
+		cerr << "       autocropper <starting file> --tune [options]" << endl;
+		cerr << "       autocropper --serve=<directory> [--poll-ms=<n>] [options]" << endl;
+		cerr << "       autocropper --sweep=<directory or manifest> [--summary=<csv file>] [--sweep-<parameter>=<values>] [options]" << endl;
+		cerr << "Options:" << endl;
+		cerr << "  --serve=<directory>   Crop the series named by each <name>" << CropService::JOB_EXTENSION << " file that appears here, writing <name>" << CropService::RESULT_EXTENSION << ", until a file named " << CropService::STOP_FILENAME << " appears." << endl;
+		cerr << "  --tune                Tune the crop region parameters on the series with sliders; Esc or Enter prints them." << endl;
+		cerr << "  --sweep-vertical=<fracs>     Vertical container edge fractions to sweep, separated by commas; the default is 0.65." << endl;
+		cerr << "  --sweep-horizontal=<fracs>   Horizontal container edge fractions to sweep; the default is 0.9." << endl;
+		cerr << "  --sweep-closing=<sizes>      Closing element sizes to sweep, such as 11x9,15x9; the default is 11x9." << endl;
+		cerr << "  --sweep-root-search=<fracs>  Root search fractions to sweep; the default is --root-search." << endl;
+		cerr << "  --pipeline            Read, analyze and write the series of a batch in separate stages that overlap." << endl;
+		cerr << "  --queue=<n>           Series --pipeline reads ahead of the analyze threads, which bounds how many are held in memory; the default is " << BatchProcessor::DEFAULT_QUEUE_CAPACITY << "." << endl;
+		cerr << "  --poll-ms=<n>         How often, in milliseconds, --serve looks for new jobs; the default is 50." << endl;
+		cerr << "  --pack=<file>         Pack the series into one memory mapped " << PackedSeries::EXTENSION << " file, which can be given as the starting file." << endl;
+		cerr << "  --pack-encoding=<enc> Store packed frames raw (default), or as PNG for a smaller file that has to be decoded." << endl;
+		cerr << "  --state=<directory>   Keep the series state here and process only frames added since the last run." << endl;
+		cerr << "  --debug-images        Write intermediate images to TestImages/DEBUG (debug builds only)." << endl;
+		cerr << "  --scale=<factor>      Find the container at this scale, then refine it at full resolution." << endl;
+		cerr << "  --refine-band=<px>    How far, in scaled pixels, each container edge is refined." << endl;
+		cerr << "  --component=<method>  Keep the root blob with the most pixels (default), or with the largest contour area." << endl;
+		cerr << "  --root-search=<frac>  Search this fraction of the gel, from the top, for the top of the roots; the default is 0.1." << endl;
+		cerr << "  --background=<model>  Separate the foreground with mog2 (default), or against the mean or median of the series (not with --stream or --state)." << endl;
+		cerr << "  --background-threshold=<n>  Grey levels a pixel must differ from a mean or median background by; the default is 25." << endl;
+		cerr << "  --subsample=<stride>  Add every <stride>th frame first, then the frames between, stopping once the root extent converges." << endl;
+		cerr << "  --converge=<frac>     Stop subsampling once a pass changes the root region by no more than this fraction; the default is 0.01." << endl;
+		cerr << "  --lines=<method>      Find the container edges with morphology (default) or runlength." << endl;
+		cerr << "  --output=<what>       Write the cropped images (default), only a sidecar with the crop regions, or both." << endl;
+		cerr << "  --output-format=<fmt> Write the cropped images as png (default), bmp, pgm or tif." << endl;
+		cerr << "  --png-compression=<n> PNG compression level from 0 (fastest) to 9 (smallest); the default is 3." << endl;
+		cerr << "  --accelerator=<dev>   Run background subtraction and morphology on the cpu (default), or on an opencl device." << endl;
+		cerr << "  --cache=<directory>   Reuse the crop regions of series seen before with the same options, keyed by image content." << endl;
+		cerr << "  --cache-union         Also cache the foreground union of each series." << endl;
+		cerr << "  --profile=<file>      Write the time and memory of each stage, as CSV if <file> ends in .csv, otherwise JSON." << endl;
 		cerr << "Exiting..." << endl;
 		return EXIT_FAILURE;
 	}
 
-	if (!FileUtilities::fileExists(argv[1]))
+	const string startingFilename = arguments.getPositionalArguments().front();
+
+	if (!FileUtilities::fileExists(startingFilename))
 	{
-		cerr << "Specified starting file doesn't exist: " << argv[1] << endl;
+		cerr << "Specified starting file doesn't exist: " << startingFilename << endl;
 		cerr << "Exiting..." << endl;
 		return EXIT_FAILURE;
 	}
 
-	vector<Mat> originalImages = ImageReader::readDataset(argv[1]);
+	if (arguments.hasOption("pack"))
+		return runPack(arguments, startingFilename);
+
+	const bool isPackedSeries = PackedSeries::isPackedSeries(startingFilename);
+	if (isPackedSeries && arguments.hasOption("state"))
+		throw invalid_argument("--state needs a series of image files, so frames can be added to it; a packed series is complete.");
+
+	const CropRegionOptions options = parseCropRegionOptions(arguments);
+
+	if (arguments.hasOption("tune"))
+		return runTuning(startingFilename, options);
+
+	const CropOutputOptions outputOptions = parseCropOutputOptions(arguments);
+	const unique_ptr<CropResultCache> resultCache = createResultCache(arguments);
+	StageProfiler profiler(ImageReader::getSeriesName(startingFilename));
+	StageProfiler* activeProfiler = arguments.hasOption("profile") ? &profiler : nullptr;
 
-	vector<Mat> foregroundImages = computeForegroundImages(originalImages);
-	
-	Mat orImage = or(foregroundImages);
+	if (arguments.hasOption("stream") && isPackedSeries)
+		cerr << "--stream is ignored for a packed series: it is mapped, so its frames are paged in on demand rather than held in memory." << endl;
 
-	Rect cropRegion = computeCropRegion(orImage);
+	if (arguments.hasOption("state"))
+		runIncrementalPipeline(startingFilename, arguments.getOption("state"), options, outputOptions, activeProfiler);
+	else if (arguments.hasOption("stream") && !isPackedSeries)
+		runStreamingPipeline(startingFilename, options, outputOptions, resultCache.get(), activeProfiler);
+	else
+		runPipeline(startingFilename, options, outputOptions, resultCache.get(), activeProfiler);
 
-	cropOriginalImages(originalImages, cropRegion);
+	if (activeProfiler != nullptr && !writeProfiles(arguments, vector<SeriesProfile>(1, profiler.getProfile())))
+		return EXIT_FAILURE;
 
 	return EXIT_SUCCESS;
 }
+
+int main(int argc, char** argv)
+{
+	CommandLineArguments arguments(argc, argv);
+
+	if (arguments.hasOption("debug-images") && !DebugImageSink::enable())
+		cerr << "Debug images are not compiled into this build; ignoring --debug-images." << endl;
+
+	int exitCode = EXIT_FAILURE;
+
+	try
+	{
+		exitCode = run(arguments);
+	}
+	catch (const exception& e)
+	{
+		cerr << "Error: " << e.what() << endl;
+		cerr << "Exiting..." << endl;
+	}
+
+	DebugImageSink::disable();	// Wait for any queued debug images to be written.
+
+	return exitCode;
+}
@@ -0,0 +1,556 @@
+#include "Benchmark.h"
+#include "FileUtilities.h"
+#include "StageProfiler.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+
+using namespace benchmark;
+using namespace cv;
+using namespace std;
+using namespace utility;
+
+namespace
+{
+	const int64 MAXIMUM_ITERATIONS = 1000000000;
+	const double MAXIMUM_ITERATION_GROWTH = 10.0;	// Don't overshoot the minimum time on the strength of one very short run.
+
+	vector<unique_ptr<Benchmark>>& getRegisteredBenchmarks()
+	{
+		static vector<unique_ptr<Benchmark>> registeredBenchmarks;
+		return registeredBenchmarks;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// State()
+//
+// Create the state of a run of the specified number of iterations with the
+// specified arguments.
+//////////////////////////////////////////////////////////////////////////////////
+State::State(const int64 maximumIterations, const vector<int64>& arguments)
+	: _maximumIterations(maximumIterations),
+	_completedIterations(0),
+	_arguments(arguments),
+	_isStarted(false),
+	_isTiming(false),
+	_startTicks(0),
+	_startCpuSeconds(0),
+	_wallSeconds(0),
+	_cpuSeconds(0),
+	_itemsProcessed(0),
+	_bytesProcessed(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// keepRunning()
+//
+// Returns true while there are iterations left to run. Timing starts on the
+// first call, so setup before the loop isn't timed.
+//////////////////////////////////////////////////////////////////////////////////
+bool State::keepRunning()
+{
+	if (hasError())
+		return false;
+
+	if (!_isStarted)
+	{
+		_isStarted = true;
+		startTimer();
+	}
+	else
+	{
+		++_completedIterations;
+	}
+
+	if (_completedIterations < _maximumIterations)
+		return true;
+
+	if (_isTiming)
+		stopTimer();
+
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// pauseTiming()
+//
+// Stop timing, e.g. while restoring an input the benchmark modifies.
+//////////////////////////////////////////////////////////////////////////////////
+void State::pauseTiming()
+{
+	if (_isTiming)
+		stopTimer();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// resumeTiming()
+//
+// Start timing again after pauseTiming().
+//////////////////////////////////////////////////////////////////////////////////
+void State::resumeTiming()
+{
+	if (!_isTiming)
+		startTimer();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// skipWithError()
+//
+// Give up on the run, reporting the specified message instead of a timing.
+//////////////////////////////////////////////////////////////////////////////////
+void State::skipWithError(const string& message)
+{
+	_errorMessage = message;
+
+	if (_isTiming)
+		stopTimer();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// range()
+//
+// Returns the argument at the specified index of the run's argument set.
+//////////////////////////////////////////////////////////////////////////////////
+int64 State::range(const size_t index) const
+{
+	return _arguments.at(index);
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// iterations()
+//
+// Returns the number of iterations completed so far.
+//////////////////////////////////////////////////////////////////////////////////
+int64 State::iterations() const
+{
+	return _completedIterations;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// setItemsProcessed()
+//
+// Report the total number of items (e.g. frames) processed over every iteration.
+//////////////////////////////////////////////////////////////////////////////////
+void State::setItemsProcessed(const int64 itemsProcessed)
+{
+	_itemsProcessed = itemsProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// setBytesProcessed()
+//
+// Report the total number of bytes processed over every iteration.
+//////////////////////////////////////////////////////////////////////////////////
+void State::setBytesProcessed(const int64 bytesProcessed)
+{
+	_bytesProcessed = bytesProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// setLabel()
+//
+// Attach the specified label (e.g. where the input came from) to the result.
+//////////////////////////////////////////////////////////////////////////////////
+void State::setLabel(const string& label)
+{
+	_label = label;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getWallSeconds()
+//
+// Returns the time spent in the timed loop, excluding paused intervals.
+//////////////////////////////////////////////////////////////////////////////////
+double State::getWallSeconds() const
+{
+	return _wallSeconds;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getCpuSeconds()
+//
+// Returns the CPU time the thread spent in the timed loop.
+//////////////////////////////////////////////////////////////////////////////////
+double State::getCpuSeconds() const
+{
+	return _cpuSeconds;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getItemsProcessed()
+//
+// Returns the number of items the benchmark reported processing.
+//////////////////////////////////////////////////////////////////////////////////
+int64 State::getItemsProcessed() const
+{
+	return _itemsProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getBytesProcessed()
+//
+// Returns the number of bytes the benchmark reported processing.
+//////////////////////////////////////////////////////////////////////////////////
+int64 State::getBytesProcessed() const
+{
+	return _bytesProcessed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getLabel()
+//
+// Returns the label the benchmark attached to the run.
+//////////////////////////////////////////////////////////////////////////////////
+const string& State::getLabel() const
+{
+	return _label;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getErrorMessage()
+//
+// Returns the reason the run was skipped, or an empty string.
+//////////////////////////////////////////////////////////////////////////////////
+const string& State::getErrorMessage() const
+{
+	return _errorMessage;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// hasError()
+//
+// Returns true if the run was skipped.
+//////////////////////////////////////////////////////////////////////////////////
+bool State::hasError() const
+{
+	return !_errorMessage.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// startTimer()
+//
+// Start a timed interval.
+//////////////////////////////////////////////////////////////////////////////////
+void State::startTimer()
+{
+	_isTiming = true;
+	_startCpuSeconds = StageProfiler::getThreadCpuSeconds();
+	_startTicks = getTickCount();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// stopTimer()
+//
+// End the current timed interval and add it to the totals.
+//////////////////////////////////////////////////////////////////////////////////
+void State::stopTimer()
+{
+	_wallSeconds += (getTickCount() - _startTicks) / getTickFrequency();
+	_cpuSeconds += StageProfiler::getThreadCpuSeconds() - _startCpuSeconds;
+	_isTiming = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// Benchmark()
+//
+// Create a benchmark of the specified function with no argument sets yet.
+//////////////////////////////////////////////////////////////////////////////////
+Benchmark::Benchmark(const string& name, BenchmarkFunction function)
+	: _name(name),
+	_function(function)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// arg()
+//
+// Also run the benchmark with the specified single argument.
+//////////////////////////////////////////////////////////////////////////////////
+Benchmark* Benchmark::arg(const int64 argument)
+{
+	_argumentSets.push_back(vector<int64>(1, argument));
+	return this;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// args()
+//
+// Also run the benchmark with the specified set of arguments.
+//////////////////////////////////////////////////////////////////////////////////
+Benchmark* Benchmark::args(const vector<int64>& arguments)
+{
+	_argumentSets.push_back(arguments);
+	return this;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// apply()
+//
+// Let the specified function add argument sets, so that benchmarks run over the
+// same inputs can share one list of them.
+//////////////////////////////////////////////////////////////////////////////////
+Benchmark* Benchmark::apply(void (*addArguments)(Benchmark*))
+{
+	addArguments(this);
+	return this;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getName()
+//
+// Returns the name the benchmark was registered with.
+//////////////////////////////////////////////////////////////////////////////////
+const string& Benchmark::getName() const
+{
+	return _name;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getFunction()
+//
+// Returns the function that runs the benchmark.
+//////////////////////////////////////////////////////////////////////////////////
+BenchmarkFunction Benchmark::getFunction() const
+{
+	return _function;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getArgumentSets()
+//
+// Returns the argument sets to run the benchmark with. A benchmark given none is
+// run once with no arguments.
+//////////////////////////////////////////////////////////////////////////////////
+vector<vector<int64>> Benchmark::getArgumentSets() const
+{
+	if (_argumentSets.empty())
+		return vector<vector<int64>>(1);
+
+	return _argumentSets;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// RunResult()
+//
+// An empty result.
+//////////////////////////////////////////////////////////////////////////////////
+RunResult::RunResult()
+	: iterations(0),
+	wallNanosecondsPerIteration(0),
+	cpuNanosecondsPerIteration(0),
+	itemsPerSecond(0),
+	bytesPerSecond(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// RunOptions()
+//
+// Run every benchmark for at least half a second.
+//////////////////////////////////////////////////////////////////////////////////
+RunOptions::RunOptions()
+	: minimumSeconds(0.5)
+{
+}
+
+namespace benchmark
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// registerBenchmark()
+	//
+	// Register the specified function as a benchmark. Used by BENCHMARK().
+	//////////////////////////////////////////////////////////////////////////////////
+	Benchmark* registerBenchmark(const string& name, BenchmarkFunction function)
+	{
+		getRegisteredBenchmarks().push_back(unique_ptr<Benchmark>(new Benchmark(name, function)));
+		return getRegisteredBenchmarks().back().get();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// runBenchmarks()
+	//
+	// Run every registered benchmark whose name matches the filter, with each of
+	// its argument sets, writing the name of each to the progress stream as it
+	// starts.
+	//////////////////////////////////////////////////////////////////////////////////
+	vector<RunResult> runBenchmarks(const RunOptions& options, ostream& progress)
+	{
+		const regex filter(options.filter.empty() ? string(".") : options.filter);
+		vector<RunResult> results;
+
+		for (const auto& benchmark : getRegisteredBenchmarks())
+		{
+			for (const auto& arguments : benchmark->getArgumentSets())
+			{
+				if (!regex_search(getRunName(*benchmark, arguments), filter))
+					continue;
+
+				progress << "Running " << getRunName(*benchmark, arguments) << "..." << endl;
+				results.push_back(runBenchmark(*benchmark, arguments, options));
+			}
+		}
+
+		return results;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// runBenchmark()
+	//
+	// Run the specified benchmark with the specified arguments, increasing the
+	// number of iterations until a run takes at least the minimum time.
+	//////////////////////////////////////////////////////////////////////////////////
+	RunResult runBenchmark(const Benchmark& benchmark, const vector<int64>& arguments, const RunOptions& options)
+	{
+		RunResult result;
+		result.name = getRunName(benchmark, arguments);
+
+		int64 iterations = 1;
+
+		while (true)
+		{
+			State state(iterations, arguments);
+			benchmark.getFunction()(state);
+
+			if (state.hasError())
+			{
+				result.errorMessage = state.getErrorMessage();
+				return result;
+			}
+
+			const double seconds = state.getWallSeconds();
+
+			if (seconds >= options.minimumSeconds || iterations >= MAXIMUM_ITERATIONS)
+			{
+				result.iterations = iterations;
+				result.wallNanosecondsPerIteration = seconds * 1e9 / iterations;
+				result.cpuNanosecondsPerIteration = state.getCpuSeconds() * 1e9 / iterations;
+				result.itemsPerSecond = (seconds > 0) ? state.getItemsProcessed() / seconds : 0;
+				result.bytesPerSecond = (seconds > 0) ? state.getBytesProcessed() / seconds : 0;
+				result.label = state.getLabel();
+				return result;
+			}
+
+			// Aim a little past the minimum time so the next run is very likely the last.
+			const double growth = (seconds > 0) ? min(MAXIMUM_ITERATION_GROWTH, options.minimumSeconds * 1.4 / seconds) : MAXIMUM_ITERATION_GROWTH;
+			iterations = min(MAXIMUM_ITERATIONS, max(iterations + 1, static_cast<int64>(iterations * growth)));
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getRunName()
+	//
+	// Returns the name of the benchmark followed by its arguments, e.g.
+	// benchmarkOr/1024.
+	//////////////////////////////////////////////////////////////////////////////////
+	string getRunName(const Benchmark& benchmark, const vector<int64>& arguments)
+	{
+		stringstream ss;
+		ss << benchmark.getName();
+
+		for (const auto argument : arguments)
+		{
+			ss << "/" << argument;
+		}
+
+		return ss.str();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeConsole()
+	//
+	// Write the results as a table.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeConsole(const vector<RunResult>& results, ostream& stream)
+	{
+		const ios_base::fmtflags flags = stream.flags();
+		const streamsize precision = stream.precision();
+
+		size_t nameWidth = string("Benchmark").size();
+		for (const auto& result : results)
+		{
+			nameWidth = max(nameWidth, result.name.size());
+		}
+
+		stream << left << setw(nameWidth) << "Benchmark" << right
+			<< setw(16) << "Wall (ns)" << setw(16) << "CPU (ns)" << setw(12) << "Iterations"
+			<< setw(14) << "Items/s" << setw(14) << "MB/s" << "  Label" << endl;
+		stream << string(nameWidth + 16 + 16 + 12 + 14 + 14 + 7, '-') << endl;
+
+		for (const auto& result : results)
+		{
+			stream << left << setw(nameWidth) << result.name << right;
+
+			if (!result.errorMessage.empty())
+			{
+				stream << "  SKIPPED: " << result.errorMessage << endl;
+				continue;
+			}
+
+			stream << fixed << setprecision(0)
+				<< setw(16) << result.wallNanosecondsPerIteration << setw(16) << result.cpuNanosecondsPerIteration
+				<< setw(12) << result.iterations
+				<< setprecision(1) << setw(14) << result.itemsPerSecond << setw(14) << result.bytesPerSecond / (1024 * 1024)
+				<< "  " << result.label << endl;
+		}
+
+		stream.flags(flags);
+		stream.precision(precision);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeCsv()
+	//
+	// Write the results as CSV, one run per line.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeCsv(const vector<RunResult>& results, ostream& stream)
+	{
+		stream << "name,iterations,wall_ns,cpu_ns,items_per_second,bytes_per_second,label,error" << endl;
+
+		for (const auto& result : results)
+		{
+			stream << FileUtilities::quoteCsv(result.name) << "," << result.iterations << ","
+				<< result.wallNanosecondsPerIteration << "," << result.cpuNanosecondsPerIteration << ","
+				<< result.itemsPerSecond << "," << result.bytesPerSecond << ","
+				<< FileUtilities::quoteCsv(result.label) << "," << FileUtilities::quoteCsv(result.errorMessage) << endl;
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeJson()
+	//
+	// Write the results as a JSON object holding an array of runs. Names, labels
+	// and errors are written as they are; none of them contain quotes.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeJson(const vector<RunResult>& results, ostream& stream)
+	{
+		stream << "{" << endl << "  \"benchmarks\": [" << endl;
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const RunResult& result = results[i];
+
+			stream << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+				<< ", \"wall_ns\": " << result.wallNanosecondsPerIteration << ", \"cpu_ns\": " << result.cpuNanosecondsPerIteration
+				<< ", \"items_per_second\": " << result.itemsPerSecond << ", \"bytes_per_second\": " << result.bytesPerSecond
+				<< ", \"label\": \"" << result.label << "\", \"error\": \"" << result.errorMessage << "\"}"
+				<< (i + 1 < results.size() ? "," : "") << endl;
+		}
+
+		stream << "  ]" << endl << "}" << endl;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// useCharPointer()
+	//
+	// Does nothing, but is opaque to the optimizer. See doNotOptimize().
+	//////////////////////////////////////////////////////////////////////////////////
+	void useCharPointer(const volatile char* pointer)
+	{
+		static const volatile char* volatile sink;
+		sink = pointer;
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////////
+// Benchmark
+//
+// A small benchmark harness in the style of Google Benchmark. A benchmark is a
+// function taking a State, registered with BENCHMARK() and given one or more
+// argument sets (e.g. image widths). The timed part is the body of
+// while (state.keepRunning()), which is run until it has taken long enough to
+// time reliably.
+//////////////////////////////////////////////////////////////////////////////////
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(function) static ::benchmark::Benchmark* BENCHMARK_CONCAT(registeredBenchmark, __LINE__) = ::benchmark::registerBenchmark(#function, function)
+
+namespace benchmark
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// State
+	//
+	// Controls the timed loop of one run of a benchmark, and collects what it
+	// processed.
+	//////////////////////////////////////////////////////////////////////////////////
+	class State final
+	{
+	public:
+		State(const int64 maximumIterations, const std::vector<int64>& arguments);
+
+		bool keepRunning();
+		void pauseTiming();
+		void resumeTiming();
+		void skipWithError(const std::string& message);
+
+		int64 range(const size_t index = 0) const;
+		int64 iterations() const;
+
+		void setItemsProcessed(const int64 itemsProcessed);
+		void setBytesProcessed(const int64 bytesProcessed);
+		void setLabel(const std::string& label);
+
+		double getWallSeconds() const;
+		double getCpuSeconds() const;
+		int64 getItemsProcessed() const;
+		int64 getBytesProcessed() const;
+		const std::string& getLabel() const;
+		const std::string& getErrorMessage() const;
+		bool hasError() const;
+	private:
+		void startTimer();
+		void stopTimer();
+
+		int64 _maximumIterations;
+		int64 _completedIterations;
+		std::vector<int64> _arguments;
+		bool _isStarted;
+		bool _isTiming;
+		int64 _startTicks;
+		double _startCpuSeconds;
+		double _wallSeconds;
+		double _cpuSeconds;
+		int64 _itemsProcessed;
+		int64 _bytesProcessed;
+		std::string _label;
+		std::string _errorMessage;
+	};
+
+	typedef void (*BenchmarkFunction)(State&);
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// Benchmark
+	//
+	// A registered benchmark and the argument sets it is run with.
+	//////////////////////////////////////////////////////////////////////////////////
+	class Benchmark final
+	{
+	public:
+		Benchmark(const std::string& name, BenchmarkFunction function);
+
+		Benchmark* arg(const int64 argument);
+		Benchmark* args(const std::vector<int64>& arguments);
+		Benchmark* apply(void (*addArguments)(Benchmark*));
+
+		const std::string& getName() const;
+		BenchmarkFunction getFunction() const;
+		std::vector<std::vector<int64>> getArgumentSets() const;
+	private:
+		std::string _name;
+		BenchmarkFunction _function;
+		std::vector<std::vector<int64>> _argumentSets;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// RunResult
+	//
+	// The timing of one benchmark with one argument set.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct RunResult
+	{
+		RunResult();
+
+		std::string name;
+		int64 iterations;
+		double wallNanosecondsPerIteration;
+		double cpuNanosecondsPerIteration;	// Of the benchmark's thread; OpenCV's own worker threads aren't included.
+		double itemsPerSecond;
+		double bytesPerSecond;
+		std::string label;
+		std::string errorMessage;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// RunOptions
+	//
+	// Which benchmarks to run, and how long to run each for.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct RunOptions
+	{
+		RunOptions();
+
+		std::string filter;			// A regular expression the full benchmark name must contain a match for. Empty runs everything.
+		double minimumSeconds;		// Iterations are added until a run takes at least this long.
+	};
+
+	Benchmark* registerBenchmark(const std::string& name, BenchmarkFunction function);
+	std::vector<RunResult> runBenchmarks(const RunOptions& options, std::ostream& progress);
+	RunResult runBenchmark(const Benchmark& benchmark, const std::vector<int64>& arguments, const RunOptions& options);
+	std::string getRunName(const Benchmark& benchmark, const std::vector<int64>& arguments);
+
+	void writeConsole(const std::vector<RunResult>& results, std::ostream& stream);
+	void writeCsv(const std::vector<RunResult>& results, std::ostream& stream);
+	void writeJson(const std::vector<RunResult>& results, std::ostream& stream);
+
+	void useCharPointer(const volatile char* pointer);
+	template<typename T> void doNotOptimize(const T& value);
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// doNotOptimize()
+	//
+	// Keep the compiler from optimizing away the computation of the specified
+	// value, so that a benchmark whose result is otherwise unused still measures
+	// something.
+	//////////////////////////////////////////////////////////////////////////////////
+	template<typename T>
+	void doNotOptimize(const T& value)
+	{
+		useCharPointer(&reinterpret_cast<const volatile char&>(value));
+	}
+}
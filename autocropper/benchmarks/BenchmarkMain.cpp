@@ -0,0 +1,60 @@
+#include "Benchmark.h"
+#include "CommandLineArguments.h"
+#include "PlateImages.h"
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+using namespace benchmark;
+using namespace std;
+using namespace utility;
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		CommandLineArguments arguments(argc, argv);
+
+		if (arguments.hasOption("help"))
+		{
+			cerr << "Usage: benchmarks [options]" << endl;
+			cerr << "Options:" << endl;
+			cerr << "  --filter=<regex>       Only run benchmarks whose name, e.g. benchmarkOr/1296, matches." << endl;
+			cerr << "  --min-time=<seconds>   Run each benchmark for at least this long (default 0.5)." << endl;
+			cerr << "  --format=<format>      Write the results as console (default), csv or json." << endl;
+			cerr << "  --images=<file>        Also run on the recorded series starting with this file." << endl;
+			return EXIT_SUCCESS;
+		}
+
+		if (arguments.hasOption("images") && !PlateImages::loadRecordedSeries(arguments.getOption("images")))
+		{
+			cerr << "Unable to read the recorded series: " << arguments.getOption("images") << endl;
+			return EXIT_FAILURE;
+		}
+
+		RunOptions options;
+		options.filter = arguments.getOption("filter");
+		options.minimumSeconds = arguments.getDoubleOption("min-time", options.minimumSeconds);
+
+		const string format = arguments.getOption("format", "console");
+		if (format != "console" && format != "csv" && format != "json")
+			throw invalid_argument("--format must be console, csv or json.");
+
+		vector<RunResult> results = runBenchmarks(options, cerr);
+
+		if (format == "csv")
+			writeCsv(results, cout);
+		else if (format == "json")
+			writeJson(results, cout);
+		else
+			writeConsole(results, cout);
+	}
+	catch (const exception& e)
+	{
+		cerr << "Error: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,661 @@
+#include "Benchmark.h"
+#include "BinaryMask.h"
+#include "CropPipeline.h"
+#include "ExperimentalFunctions.h"
+#include "ForegroundAccumulator.h"
+#include "MatPool.h"
+#include "Neighborhood.h"
+#include "OcvUtilities.h"
+#include "PlateImages.h"
+#include "ProjectionProfile.h"
+#include "StaticBackground.h"
+#include <opencv2/core.hpp>
+#include <sstream>
+#include <vector>
+
+using namespace autocropper;
+using namespace benchmark;
+using namespace cv;
+using namespace experimental;
+using namespace std;
+using namespace utility;
+using OcvUtility::BinaryMask;
+using OcvUtility::ProjectionProfile;
+
+//////////////////////////////////////////////////////////////////////////////////
+// The kernels of OcvUtility and experimental, each timed on synthetic plates at
+// several resolutions and on the recorded series, if one was loaded.
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	const int64 PLATE_WIDTHS[] = { 640, 1296, 2592, PlateImages::RECORDED };
+	const int64 LINE_DETECTION_METHODS[] = { static_cast<int64>(LineDetectionMethod::Morphology), static_cast<int64>(LineDetectionMethod::RunLength) };
+	const int64 BACKGROUND_MODELS[] = { static_cast<int64>(BackgroundModel::Mog2), static_cast<int64>(BackgroundModel::Mean), static_cast<int64>(BackgroundModel::Median) };
+	const CropRegionOptions DEFAULT_OPTIONS;	// The kernels run with the parameters a default crop uses.
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// atPlateWidths()
+	//
+	// Run a benchmark at every plate width.
+	//////////////////////////////////////////////////////////////////////////////////
+	void atPlateWidths(Benchmark* benchmark)
+	{
+		for (const auto width : PLATE_WIDTHS)
+		{
+			benchmark->arg(width);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// atPlateWidthsWithEachLineDetectionMethod()
+	//
+	// Run a benchmark at every plate width with each line detection method.
+	//////////////////////////////////////////////////////////////////////////////////
+	void atPlateWidthsWithEachLineDetectionMethod(Benchmark* benchmark)
+	{
+		for (const auto width : PLATE_WIDTHS)
+		{
+			for (const auto method : LINE_DETECTION_METHODS)
+			{
+				benchmark->args({ width, method });
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// atPlateWidthsWithAndWithoutFlag()
+	//
+	// Run a benchmark at every plate width with its second argument off and on,
+	// e.g. on a CV_8UC1 mask and on a packed one, or without and with a MatPool.
+	//////////////////////////////////////////////////////////////////////////////////
+	void atPlateWidthsWithAndWithoutFlag(Benchmark* benchmark)
+	{
+		for (const auto width : PLATE_WIDTHS)
+		{
+			benchmark->args({ width, 0 });
+			benchmark->args({ width, 1 });
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// preparePlate()
+	//
+	// Returns the plate width the run is for, or skips the run and returns -1 if
+	// there are no images of that width.
+	//////////////////////////////////////////////////////////////////////////////////
+	int preparePlate(State& state)
+	{
+		const int width = static_cast<int>(state.range(0));
+
+		if (!PlateImages::isAvailable(width))
+		{
+			state.skipWithError("no recorded series; specify one with --images=<starting file>");
+			return -1;
+		}
+
+		state.setLabel(PlateImages::getLabel(width));
+
+		return width;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// setImagesProcessed()
+	//
+	// Report the specified images as processed once per iteration.
+	//////////////////////////////////////////////////////////////////////////////////
+	void setImagesProcessed(State& state, const vector<Mat>& images)
+	{
+		int64 bytesPerIteration = 0;
+		for (const auto& image : images)
+		{
+			bytesPerIteration += image.total() * image.elemSize();
+		}
+
+		state.setItemsProcessed(state.iterations() * images.size());
+		state.setBytesProcessed(state.iterations() * bytesPerIteration);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkOr()
+	//
+	// Time OcvUtility::or() on the foreground images of a series.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkOr(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		vector<Mat> foregroundSeries = PlateImages::getForegroundSeries(width);
+
+		while (state.keepRunning())
+		{
+			Mat orImage = OcvUtility::or(foregroundSeries);
+			doNotOptimize(orImage.data);
+		}
+
+		setImagesProcessed(state, foregroundSeries);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkOrIntoExistingImage()
+	//
+	// Time OcvUtility::or() writing into the image of the previous iteration.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkOrIntoExistingImage(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const vector<Mat>& foregroundSeries = PlateImages::getForegroundSeries(width);
+		Mat orImage;
+
+		while (state.keepRunning())
+		{
+			OcvUtility::or(foregroundSeries, orImage);
+			doNotOptimize(orImage.data);
+		}
+
+		setImagesProcessed(state, foregroundSeries);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkAnd()
+	//
+	// Time OcvUtility::and() on the foreground images of a series.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkAnd(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		vector<Mat> foregroundSeries = PlateImages::getForegroundSeries(width);
+
+		while (state.keepRunning())
+		{
+			Mat andImage = OcvUtility::and(foregroundSeries);
+			doNotOptimize(andImage.data);
+		}
+
+		setImagesProcessed(state, foregroundSeries);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkBinaryMaskOr()
+	//
+	// Time oring the packed foreground images of a series, to compare with
+	// benchmarkOr(). The images are packed before timing starts. The bytes
+	// processed are those of the unpacked images, so the rates compare directly.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkBinaryMaskOr(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const vector<Mat>& foregroundSeries = PlateImages::getForegroundSeries(width);
+		vector<BinaryMask> packedSeries;
+		for (const auto& image : foregroundSeries)
+		{
+			packedSeries.push_back(BinaryMask::pack(image));
+		}
+
+		while (state.keepRunning())
+		{
+			BinaryMask orMask = packedSeries.front();
+			for (size_t i = 1; i < packedSeries.size(); ++i)
+			{
+				orMask.orWith(packedSeries[i]);
+			}
+			doNotOptimize(orMask.ptr(0));
+		}
+
+		setImagesProcessed(state, foregroundSeries);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkComputeMaximumRootExtents()
+	//
+	// Time finding the root row and extents in the foreground union, on the
+	// CV_8UC1 union or packed, as the second argument says. Packing is untimed,
+	// as a packed union is kept packed. The packed union is searched a word at a
+	// time; on the CV_8UC1 union both searches share one profile, as
+	// computeCropRegion() builds it.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkComputeMaximumRootExtents(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		const bool isPacked = state.range(1) != 0;
+		const BinaryMask packedUnion = BinaryMask::pack(foregroundUnion);
+
+		while (state.keepRunning())
+		{
+			Rect rootRegion;
+			if (isPacked)
+			{
+				rootRegion = computeMaximumRootExtents(packedUnion, computeRowWithMaximumBlackPixels(packedUnion));
+			}
+			else
+			{
+				const ProjectionProfile profile(foregroundUnion);
+				rootRegion = computeMaximumRootExtents(profile, computeRowWithMaximumBlackPixels(profile));
+			}
+			doNotOptimize(&rootRegion);
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkKeepOnlyLargestContour()
+	//
+	// Time OcvUtility::keepOnlyLargestContour() on the foreground union, without
+	// or with a MatPool, as the second argument says.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkKeepOnlyLargestContour(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		MatPool matPool;
+		Mat image;
+
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			foregroundUnion.copyTo(image);	// keepOnlyLargestContour() modifies the image.
+			state.resumeTiming();
+
+			vector<Point> contour = OcvUtility::keepOnlyLargestContour(image, state.range(1) != 0 ? &matPool : nullptr);
+			doNotOptimize(contour.size());
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkKeepOnlyLargestComponent()
+	//
+	// Time OcvUtility::keepOnlyLargestComponent() on the foreground union, without
+	// or with a MatPool, as the second argument says.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkKeepOnlyLargestComponent(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		MatPool matPool;
+		Mat image;
+
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			foregroundUnion.copyTo(image);	// keepOnlyLargestComponent() modifies the image.
+			state.resumeTiming();
+
+			Rect component = OcvUtility::keepOnlyLargestComponent(image, state.range(1) != 0 ? &matPool : nullptr);
+			doNotOptimize(component.area());
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkGetNeighboringPixels()
+	//
+	// Time OcvUtility::getNeighboringPixels() on a grid of points covering the
+	// image.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkGetNeighboringPixels(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		const int step = 4;	// Every pixel would take far too long at the larger widths.
+		int64 pointsPerIteration = 0;
+
+		while (state.keepRunning())
+		{
+			pointsPerIteration = 0;
+
+			for (int y = 0; y < foregroundUnion.rows; y += step)
+			{
+				for (int x = 0; x < foregroundUnion.cols; x += step)
+				{
+					vector<Point> neighbors = OcvUtility::getNeighboringPixels(foregroundUnion, Point(x, y));
+					doNotOptimize(neighbors.size());
+					++pointsPerIteration;
+				}
+			}
+		}
+
+		state.setItemsProcessed(state.iterations() * pointsPerIteration);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkNeighborhood()
+	//
+	// Time iterating over a Neighborhood of the given connectivity on the same grid
+	// of points as benchmarkGetNeighboringPixels().
+	//////////////////////////////////////////////////////////////////////////////////
+	template<int Connectivity>
+	void benchmarkNeighborhood(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		const int step = 4;
+		int64 pointsPerIteration = 0;
+
+		while (state.keepRunning())
+		{
+			pointsPerIteration = 0;
+
+			for (int y = 0; y < foregroundUnion.rows; y += step)
+			{
+				for (int x = 0; x < foregroundUnion.cols; x += step)
+				{
+					int numberOfNeighbors = 0;
+					for (const Point neighbor : OcvUtility::Neighborhood<Connectivity>(foregroundUnion, Point(x, y)))
+					{
+						doNotOptimize(neighbor.x);
+						++numberOfNeighbors;
+					}
+					doNotOptimize(numberOfNeighbors);
+					++pointsPerIteration;
+				}
+			}
+		}
+
+		state.setItemsProcessed(state.iterations() * pointsPerIteration);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkComputeProjectionProfile()
+	//
+	// Time computing the projection profile of the foreground union, with its
+	// integral image.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkComputeProjectionProfile(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+
+		while (state.keepRunning())
+		{
+			ProjectionProfile profile(foregroundUnion, true);
+			doNotOptimize(&profile);
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkComputeInnermostRectangle()
+	//
+	// Time computeInnermostRectangle() on the foreground union.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkComputeInnermostRectangle(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+
+		while (state.keepRunning())
+		{
+			Rect innermostRectangle = computeInnermostRectangle(foregroundUnion);
+			doNotOptimize(innermostRectangle);
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkFindLargestVerticalLines()
+	//
+	// Time findLargestVerticalLines() on the foreground union with the line
+	// detection method the second argument says.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkFindLargestVerticalLines(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		const LineDetectionMethod method = static_cast<LineDetectionMethod>(state.range(1));
+
+		while (state.keepRunning())
+		{
+			Mat verticalLines = findLargestVerticalLines(foregroundUnion, DEFAULT_OPTIONS.verticalLineFraction, method);
+			doNotOptimize(verticalLines.data);
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkFindLargestHorizontalLines()
+	//
+	// Time findLargestHorizontalLines() on the foreground union with the line
+	// detection method the second argument says.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkFindLargestHorizontalLines(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Mat& foregroundUnion = PlateImages::getForegroundUnion(width);
+		const LineDetectionMethod method = static_cast<LineDetectionMethod>(state.range(1));
+
+		while (state.keepRunning())
+		{
+			Mat horizontalLines = findLargestHorizontalLines(foregroundUnion, DEFAULT_OPTIONS.horizontalLineFraction, method);
+			doNotOptimize(horizontalLines.data);
+		}
+
+		setImagesProcessed(state, vector<Mat>(1, foregroundUnion));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkComputeForegroundImages()
+	//
+	// Time computeForegroundImages() on a series.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkComputeForegroundImages(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const vector<Mat>& series = PlateImages::getSeries(width);
+
+		while (state.keepRunning())
+		{
+			vector<Mat> foregroundImages = computeForegroundImages(series);
+			doNotOptimize(foregroundImages.size());
+		}
+
+		setImagesProcessed(state, series);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkComputeAverageImage()
+	//
+	// Time computeAverageImage() on a series.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkComputeAverageImage(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const vector<Mat>& series = PlateImages::getSeries(width);
+
+		while (state.keepRunning())
+		{
+			Mat averageImage = computeAverageImage(series);
+			doNotOptimize(averageImage.data);
+		}
+
+		setImagesProcessed(state, series);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// atPlateWidthsWithEachBackgroundModel()
+	//
+	// Run a benchmark at every plate width with each background model.
+	//////////////////////////////////////////////////////////////////////////////////
+	void atPlateWidthsWithEachBackgroundModel(Benchmark* benchmark)
+	{
+		for (const auto width : PLATE_WIDTHS)
+		{
+			for (const auto model : BACKGROUND_MODELS)
+			{
+				benchmark->args({ width, model });
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeForegroundUnion()
+	//
+	// Compute the foreground union of a series under the specified background
+	// model, as computeSeriesCropRegion() does.
+	//////////////////////////////////////////////////////////////////////////////////
+	void computeForegroundUnion(const vector<Mat>& series, const BackgroundModel model, Mat& foregroundUnion)
+	{
+		if (model != BackgroundModel::Mog2)
+		{
+			StaticBackground::computeForegroundUnion(series, model, DEFAULT_OPTIONS.backgroundThreshold, foregroundUnion);
+			return;
+		}
+
+		ForegroundAccumulator foregroundAccumulator;
+
+		for (const auto& image : series)
+		{
+			foregroundAccumulator.add(image);
+		}
+
+		foregroundAccumulator.getForegroundUnion().copyTo(foregroundUnion);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeIntersectionOverUnion()
+	//
+	// Returns how closely the foreground pixels of two images agree, from 0 for
+	// none in common to 1 for the same pixels.
+	//////////////////////////////////////////////////////////////////////////////////
+	double computeIntersectionOverUnion(const Mat& image, const Mat& reference)
+	{
+		Mat foreground, referenceForeground, both;
+		compare(image, 0, foreground, CMP_GT);
+		compare(reference, 0, referenceForeground, CMP_GT);
+
+		bitwise_and(foreground, referenceForeground, both);
+		const int intersection = countNonZero(both);
+
+		bitwise_or(foreground, referenceForeground, both);
+		const int either = countNonZero(both);
+
+		return either == 0 ? 1.0 : static_cast<double>(intersection) / either;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkComputeForegroundUnion()
+	//
+	// Time finding the foreground union of a series with the background model the
+	// second argument says. The label reports how closely the union agrees with
+	// the one MOG2 finds, and for a synthetic plate, with the drawn foreground.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkComputeForegroundUnion(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const vector<Mat>& series = PlateImages::getSeries(width);
+		const BackgroundModel model = static_cast<BackgroundModel>(state.range(1));
+		Mat foregroundUnion;
+
+		while (state.keepRunning())
+		{
+			computeForegroundUnion(series, model, foregroundUnion);
+			doNotOptimize(foregroundUnion.data);
+		}
+
+		Mat mog2ForegroundUnion;
+		computeForegroundUnion(series, BackgroundModel::Mog2, mog2ForegroundUnion);
+
+		ostringstream label;
+		label << PlateImages::getLabel(width) << ", IoU with MOG2 " << computeIntersectionOverUnion(foregroundUnion, mog2ForegroundUnion);
+		if (width != PlateImages::RECORDED)
+			label << ", with drawn " << computeIntersectionOverUnion(foregroundUnion, PlateImages::getForegroundUnion(width));
+		state.setLabel(label.str());
+
+		setImagesProcessed(state, series);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// benchmarkGenerateEnhancedCenterMask()
+	//
+	// Time generateEnhancedCenterMask() at the size of a plate image.
+	//////////////////////////////////////////////////////////////////////////////////
+	void benchmarkGenerateEnhancedCenterMask(State& state)
+	{
+		const int width = preparePlate(state);
+		if (width < 0)
+			return;
+
+		const Size size = PlateImages::getForegroundUnion(width).size();
+
+		while (state.keepRunning())
+		{
+			Mat mask = generateEnhancedCenterMask(size);
+			doNotOptimize(mask.data);
+		}
+
+		state.setItemsProcessed(state.iterations());
+	}
+}
+
+BENCHMARK(benchmarkOr)->apply(atPlateWidths);
+BENCHMARK(benchmarkOrIntoExistingImage)->apply(atPlateWidths);
+BENCHMARK(benchmarkAnd)->apply(atPlateWidths);
+BENCHMARK(benchmarkBinaryMaskOr)->apply(atPlateWidths);
+BENCHMARK(benchmarkComputeMaximumRootExtents)->apply(atPlateWidthsWithAndWithoutFlag);
+BENCHMARK(benchmarkKeepOnlyLargestContour)->apply(atPlateWidthsWithAndWithoutFlag);
+BENCHMARK(benchmarkKeepOnlyLargestComponent)->apply(atPlateWidthsWithAndWithoutFlag);
+BENCHMARK(benchmarkGetNeighboringPixels)->apply(atPlateWidths);
+BENCHMARK(benchmarkNeighborhood<4>)->apply(atPlateWidths);
+BENCHMARK(benchmarkNeighborhood<8>)->apply(atPlateWidths);
+BENCHMARK(benchmarkComputeProjectionProfile)->apply(atPlateWidths);
+BENCHMARK(benchmarkComputeInnermostRectangle)->apply(atPlateWidths);
+BENCHMARK(benchmarkFindLargestVerticalLines)->apply(atPlateWidthsWithEachLineDetectionMethod);
+BENCHMARK(benchmarkFindLargestHorizontalLines)->apply(atPlateWidthsWithEachLineDetectionMethod);
+BENCHMARK(benchmarkComputeForegroundImages)->apply(atPlateWidths);
+BENCHMARK(benchmarkComputeAverageImage)->apply(atPlateWidths);
+BENCHMARK(benchmarkComputeForegroundUnion)->apply(atPlateWidthsWithEachBackgroundModel);
+BENCHMARK(benchmarkGenerateEnhancedCenterMask)->apply(atPlateWidths);
@@ -0,0 +1,243 @@
+#include "PlateImages.h"
+#include "ExperimentalFunctions.h"
+#include "ImageReader.h"
+#include "OcvUtilities.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+using namespace autocropper;
+using namespace benchmark;
+using namespace cv;
+using namespace experimental;
+using namespace std;
+using namespace utility;
+
+vector<Mat> PlateImages::_recordedSeries;
+map<int, vector<Mat>> PlateImages::_series;
+map<int, vector<Mat>> PlateImages::_foregroundSeries;
+map<int, Mat> PlateImages::_foregroundUnions;
+
+namespace
+{
+	const uchar BACKGROUND_INTENSITY = 40;
+	const uchar CONTAINER_INTENSITY = 200;
+	const uchar ROOT_INTENSITY = 230;
+	const int NUMBER_OF_ROOT_SEGMENTS = 400;
+	const uint64 RANDOM_SEED = 0x5eed;	// Fixed, so every run times the same images.
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// loadRecordedSeries()
+//
+// Read the first frames of the series starting with the specified file, for the
+// benchmarks run with the RECORDED width. Returns false if it couldn't be read.
+//////////////////////////////////////////////////////////////////////////////////
+bool PlateImages::loadRecordedSeries(const string& startingFilename)
+{
+	vector<Mat> series;
+
+	for (auto& image : ImageReader::readDataset(startingFilename))
+	{
+		if (image.empty() || series.size() == static_cast<size_t>(NUMBER_OF_FRAMES))
+			break;
+
+		series.push_back(image);
+	}
+
+	if (series.size() < 2)
+		return false;
+
+	_recordedSeries = series;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// isAvailable()
+//
+// Returns true if there are images of the specified width. Synthetic images are
+// always available; the recorded series only once it has been loaded.
+//////////////////////////////////////////////////////////////////////////////////
+bool PlateImages::isAvailable(const int width)
+{
+	return width != RECORDED || !_recordedSeries.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getLabel()
+//
+// Returns where the images of the specified width come from, for the results.
+//////////////////////////////////////////////////////////////////////////////////
+string PlateImages::getLabel(const int width)
+{
+	return (width == RECORDED) ? "recorded" : "synthetic";
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSeries()
+//
+// Returns grayscale frames of a plate whose root system grows from frame to
+// frame.
+//////////////////////////////////////////////////////////////////////////////////
+const vector<Mat>& PlateImages::getSeries(const int width)
+{
+	if (width == RECORDED)
+		return _recordedSeries;
+
+	auto series = _series.find(width);
+	if (series != _series.end())
+		return series->second;
+
+	const Size size = getSize(width);
+	const SyntheticPlate plate = createSyntheticPlate(size);
+	vector<Mat>& frames = _series[width];
+
+	for (int frame = 0; frame < NUMBER_OF_FRAMES; ++frame)
+	{
+		frames.push_back(drawFrame(plate, size, frame));
+	}
+
+	return frames;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getForegroundSeries()
+//
+// Returns foreground images of the frames of getSeries(). Synthetic foregrounds
+// are drawn directly; recorded ones are found by background subtraction.
+//////////////////////////////////////////////////////////////////////////////////
+const vector<Mat>& PlateImages::getForegroundSeries(const int width)
+{
+	auto foregroundSeries = _foregroundSeries.find(width);
+	if (foregroundSeries != _foregroundSeries.end())
+		return foregroundSeries->second;
+
+	vector<Mat>& foregrounds = _foregroundSeries[width];
+
+	if (width == RECORDED)
+	{
+		foregrounds = computeForegroundImages(_recordedSeries);
+		return foregrounds;
+	}
+
+	const Size size = getSize(width);
+	const SyntheticPlate plate = createSyntheticPlate(size);
+
+	for (int frame = 1; frame < NUMBER_OF_FRAMES; ++frame)	// The first frame has no foreground, as in computeForegroundImages().
+	{
+		foregrounds.push_back(drawForeground(plate, size, frame));
+	}
+
+	return foregrounds;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getForegroundUnion()
+//
+// Returns the or of getForegroundSeries(), the image the crop region is found in.
+//////////////////////////////////////////////////////////////////////////////////
+const Mat& PlateImages::getForegroundUnion(const int width)
+{
+	auto foregroundUnion = _foregroundUnions.find(width);
+	if (foregroundUnion != _foregroundUnions.end())
+		return foregroundUnion->second;
+
+	OcvUtility::or(getForegroundSeries(width), _foregroundUnions[width]);
+
+	return _foregroundUnions[width];
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// createSyntheticPlate()
+//
+// Lay out a container spanning most of the image, and a branching root system
+// growing down from the top of the gel.
+//////////////////////////////////////////////////////////////////////////////////
+PlateImages::SyntheticPlate PlateImages::createSyntheticPlate(const Size size)
+{
+	SyntheticPlate plate;
+	plate.container = Rect(size.width * 15 / 100, size.height * 4 / 100, size.width * 70 / 100, size.height * 92 / 100);
+
+	RNG rng(RANDOM_SEED);
+	const int stepLength = max(2, size.height / 60);
+	vector<Point> tips(1, Point(plate.container.x + plate.container.width / 2, plate.container.y + plate.container.height / 20));
+
+	while (plate.rootSegments.size() < NUMBER_OF_ROOT_SEGMENTS)
+	{
+		const size_t tipIndex = rng.uniform(0, static_cast<int>(tips.size()));
+		Point tip = tips[tipIndex];
+		Point next = tip + Point(rng.uniform(-stepLength, stepLength + 1), rng.uniform(stepLength / 2, stepLength + 1));
+
+		if (!plate.container.contains(next))
+		{
+			tips[tipIndex] = tips.front();	// This root has reached the container; grow another one.
+			continue;
+		}
+
+		plate.rootSegments.push_back(make_pair(tip, next));
+		tips[tipIndex] = next;
+
+		if (rng.uniform(0, 10) == 0)
+			tips.push_back(next);	// Branch.
+	}
+
+	return plate;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// drawForeground()
+//
+// Draw the binary foreground of the specified frame: the container edges, which
+// move as the plate turns, and the part of the root system grown so far.
+//////////////////////////////////////////////////////////////////////////////////
+Mat PlateImages::drawForeground(const SyntheticPlate& plate, const Size size, const int frame)
+{
+	Mat foreground = Mat::zeros(size, CV_8UC1);
+	const int thickness = max(1, size.width / 300);
+
+	rectangle(foreground, plate.container, Scalar(255), thickness);
+
+	const size_t numberOfSegments = plate.rootSegments.size() * (frame + 1) / NUMBER_OF_FRAMES;
+	for (size_t i = 0; i < numberOfSegments; ++i)
+	{
+		line(foreground, plate.rootSegments[i].first, plate.rootSegments[i].second, Scalar(255), thickness);
+	}
+
+	return foreground;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// drawFrame()
+//
+// Draw the specified frame as the camera would see it: a noisy background, the
+// container, shifted slightly as the plate turns, and the roots grown so far.
+//////////////////////////////////////////////////////////////////////////////////
+Mat PlateImages::drawFrame(const SyntheticPlate& plate, const Size size, const int frame)
+{
+	Mat image(size, CV_8UC1);
+	RNG rng(RANDOM_SEED + frame);
+	rng.fill(image, RNG::NORMAL, Scalar(BACKGROUND_INTENSITY), Scalar(6));
+
+	const int thickness = max(1, size.width / 300);
+	const Rect container = plate.container + Point((frame % 3) - 1, 0);
+	rectangle(image, container, Scalar(CONTAINER_INTENSITY), thickness);
+
+	const size_t numberOfSegments = plate.rootSegments.size() * (frame + 1) / NUMBER_OF_FRAMES;
+	for (size_t i = 0; i < numberOfSegments; ++i)
+	{
+		line(image, plate.rootSegments[i].first, plate.rootSegments[i].second, Scalar(ROOT_INTENSITY), thickness);
+	}
+
+	return image;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// getSize()
+//
+// Returns the size of a synthetic image of the specified width.
+//////////////////////////////////////////////////////////////////////////////////
+Size PlateImages::getSize(const int width)
+{
+	return Size(width, width * 3 / 4);
+}
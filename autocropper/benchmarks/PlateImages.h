@@ -0,0 +1,47 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// PlateImages
+	//
+	// The inputs the benchmarks run on: synthetic plate images, drawn at any width
+	// with a 4:3 aspect, or a recorded series read from disk. Every image is made
+	// once and cached, so making it is never part of a timed loop.
+	//////////////////////////////////////////////////////////////////////////////////
+	class PlateImages final
+	{
+	public:
+		static const int RECORDED = 0;	// Pass as the width to use the recorded series instead of a synthetic one.
+		static const int NUMBER_OF_FRAMES = 8;
+
+		static bool loadRecordedSeries(const std::string& startingFilename);
+		static bool isAvailable(const int width);
+		static std::string getLabel(const int width);
+
+		static const std::vector<cv::Mat>& getSeries(const int width);
+		static const std::vector<cv::Mat>& getForegroundSeries(const int width);
+		static const cv::Mat& getForegroundUnion(const int width);
+	private:
+		struct SyntheticPlate
+		{
+			cv::Rect container;
+			std::vector<std::pair<cv::Point, cv::Point>> rootSegments;	// In the order the root system grows.
+		};
+
+		static SyntheticPlate createSyntheticPlate(const cv::Size size);
+		static cv::Mat drawForeground(const SyntheticPlate& plate, const cv::Size size, const int frame);
+		static cv::Mat drawFrame(const SyntheticPlate& plate, const cv::Size size, const int frame);
+		static cv::Size getSize(const int width);
+
+		static std::vector<cv::Mat> _recordedSeries;
+		static std::map<int, std::vector<cv::Mat>> _series;
+		static std::map<int, std::vector<cv::Mat>> _foregroundSeries;
+		static std::map<int, cv::Mat> _foregroundUnions;
+	};
+}
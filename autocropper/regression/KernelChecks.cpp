@@ -0,0 +1,525 @@
+#include "KernelChecks.h"
+#include "Accelerator.h"
+#include "BinaryMask.h"
+#include "ExperimentalFunctions.h"
+#include "ProjectionProfile.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <initializer_list>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace experimental;
+using namespace OcvUtility;
+using namespace regression;
+using namespace std;
+
+namespace
+{
+	// Every rectangle of a mask up to this area is counted; larger masks are sampled.
+	const int EXHAUSTIVE_AREA = 400;
+	const int SAMPLES_PER_MASK = 500;
+
+	// Morphology is checked on regions of a mask large enough for the CPU to split into strips.
+	const Size MORPHOLOGY_MASK_SIZE = Size(640, 480);
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// KernelCheck
+	//
+	// Counts the checks done and reports each that fails.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct KernelCheck
+	{
+		KernelCheck(ostream& stream)
+			: stream(stream),
+			numberOfChecks(0),
+			numberOfFailures(0)
+		{
+		}
+
+		void expect(const int actual, const int expected, const string& what)
+		{
+			++numberOfChecks;
+			if (actual == expected)
+				return;
+
+			++numberOfFailures;
+			stream << "FAIL " << maskName << ": " << what << " is " << actual << ", expected " << expected << endl;
+		}
+
+		ostream& stream;
+		string maskName;
+		int numberOfChecks;
+		int numberOfFailures;
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// createRandomMask()
+	//
+	// Create a CV_8UC1 mask of the specified size with about the specified fraction
+	// of its pixels nonzero. The nonzero pixels aren't all 255, as a mask needn't be.
+	//////////////////////////////////////////////////////////////////////////////////
+	Mat createRandomMask(const Size size, const double density, mt19937& random)
+	{
+		Mat mask = Mat::zeros(size, CV_8UC1);
+		bernoulli_distribution isSet(density);
+		uniform_int_distribution<int> value(1, 255);
+
+		for (int y = 0; y < size.height; ++y)
+		{
+			uchar* pixels = mask.ptr<uchar>(y);
+			for (int x = 0; x < size.width; ++x)
+			{
+				if (isSet(random))
+					pixels[x] = static_cast<uchar>(value(random));
+			}
+		}
+
+		return mask;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// createRandomRange()
+	//
+	// Create a range within [0, length), which may be empty.
+	//////////////////////////////////////////////////////////////////////////////////
+	Range createRandomRange(const int length, mt19937& random)
+	{
+		const int start = uniform_int_distribution<int>(0, length)(random);
+		const int end = uniform_int_distribution<int>(start, length)(random);
+
+		return Range(start, end);
+	}
+
+	string describe(const Rect& rect)
+	{
+		ostringstream description;
+		description << "(" << rect.x << ", " << rect.y << ", " << rect.width << ", " << rect.height << ")";
+		return description.str();
+	}
+
+	string describe(const Range& range)
+	{
+		ostringstream description;
+		description << "[" << range.start << ", " << range.end << ")";
+		return description.str();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// countBruteForce()
+	//
+	// Count the nonzero pixels of the specified rectangle of the mask one by one.
+	//////////////////////////////////////////////////////////////////////////////////
+	int countBruteForce(const Mat& mask, const Rect& rect)
+	{
+		int count = 0;
+		for (int y = rect.y; y < rect.y + rect.height; ++y)
+		{
+			for (int x = rect.x; x < rect.x + rect.width; ++x)
+			{
+				if (mask.at<uchar>(y, x) != 0)
+					++count;
+			}
+		}
+
+		return count;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkLines()
+	//
+	// Check the count, first and last nonzero pixel of every row and column.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkLines(const Mat& mask, const ProjectionProfile& profile, KernelCheck& check)
+	{
+		const Size size = mask.size();
+		check.expect(profile.size().width, size.width, "width");
+		check.expect(profile.size().height, size.height, "height");
+		check.expect(profile.empty(), size.area() == 0, "empty()");
+
+		for (int y = 0; y < size.height; ++y)
+		{
+			int first = size.width, last = -1;
+			for (int x = 0; x < size.width; ++x)
+			{
+				if (mask.at<uchar>(y, x) == 0)
+					continue;
+
+				if (first == size.width)
+					first = x;
+				last = x;
+			}
+
+			const string row = "row " + to_string(y);
+			check.expect(profile.countRow(y), countBruteForce(mask, Rect(0, y, size.width, 1)), "countRow() of " + row);
+			check.expect(profile.findFirstInRow(y), first, "findFirstInRow() of " + row);
+			check.expect(profile.findLastInRow(y), last, "findLastInRow() of " + row);
+		}
+
+		for (int x = 0; x < size.width; ++x)
+		{
+			int first = size.height, last = -1;
+			for (int y = 0; y < size.height; ++y)
+			{
+				if (mask.at<uchar>(y, x) == 0)
+					continue;
+
+				if (first == size.height)
+					first = y;
+				last = y;
+			}
+
+			const string column = "column " + to_string(x);
+			check.expect(profile.countColumn(x), countBruteForce(mask, Rect(x, 0, 1, size.height)), "countColumn() of " + column);
+			check.expect(profile.findFirstInColumn(x), first, "findFirstInColumn() of " + column);
+			check.expect(profile.findLastInColumn(x), last, "findLastInColumn() of " + column);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkRectangle()
+	//
+	// Check the count of one rectangle. Without rectangle sums only rectangles that
+	// span every row or every column can be counted, and any other must throw.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkRectangle(const Mat& mask, const ProjectionProfile& profile, const Rect& rect, KernelCheck& check)
+	{
+		const bool isSpanning = (rect.x == 0 && rect.width == mask.cols) || (rect.y == 0 && rect.height == mask.rows);
+		if (profile.hasRectangleSums() || isSpanning)
+		{
+			check.expect(profile.countRectangle(rect), countBruteForce(mask, rect), "countRectangle() of " + describe(rect));
+			return;
+		}
+
+		bool hasThrown = false;
+		try
+		{
+			profile.countRectangle(rect);
+		}
+		catch (const runtime_error&)
+		{
+			hasThrown = true;
+		}
+		check.expect(hasThrown, true, "countRectangle() without rectangle sums throwing for " + describe(rect));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkRectangles()
+	//
+	// Check the count of every rectangle of a small mask, or of random rectangles
+	// of a larger one, including empty ones.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkRectangles(const Mat& mask, const ProjectionProfile& profile, mt19937& random, KernelCheck& check)
+	{
+		const Size size = mask.size();
+		if (size.area() <= EXHAUSTIVE_AREA)
+		{
+			for (int top = 0; top <= size.height; ++top)
+			{
+				for (int bottom = top; bottom <= size.height; ++bottom)
+				{
+					for (int left = 0; left <= size.width; ++left)
+					{
+						for (int right = left; right <= size.width; ++right)
+						{
+							checkRectangle(mask, profile, Rect(left, top, right - left, bottom - top), check);
+						}
+					}
+				}
+			}
+			return;
+		}
+
+		for (int i = 0; i < SAMPLES_PER_MASK; ++i)
+		{
+			const Range rows = createRandomRange(size.height, random);
+			const Range columns = createRandomRange(size.width, random);
+			checkRectangle(mask, profile, Rect(columns.start, rows.start, columns.size(), rows.size()), check);
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkSearches()
+	//
+	// Check the row and column searches against counting each line of the band by
+	// brute force, on random, empty and one pixel ranges and bands. Without
+	// rectangle sums the bands span the whole mask, as they must.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkSearches(const Mat& mask, const ProjectionProfile& profile, mt19937& random, KernelCheck& check)
+	{
+		const Size size = mask.size();
+		for (int i = 0; i < SAMPLES_PER_MASK; ++i)
+		{
+			Range rows = createRandomRange(size.height, random);
+			Range columns = createRandomRange(size.width, random);
+			if (i % 4 == 1 && size.width > 0)
+				columns = Range(columns.start % size.width, columns.start % size.width + 1);
+			if (i % 4 == 2 && size.height > 0)
+				rows = Range(rows.start % size.height, rows.start % size.height + 1);
+			if (!profile.hasRectangleSums())
+			{
+				if (i % 2 == 0)
+					columns = Range(0, size.width);
+				else
+					rows = Range(0, size.height);
+			}
+
+			// A minimum of zero always matches the first line, if there is one.
+			const int minimumCount = uniform_int_distribution<int>(0, max(1, max(rows.size(), columns.size()) / 2))(random);
+			const string arguments = describe(rows) + ", " + describe(columns) + ", " + to_string(minimumCount);
+
+			if (profile.hasRectangleSums() || i % 2 == 0)
+			{
+				int first = rows.end, last = rows.start - 1;
+				for (int y = rows.start; y < rows.end; ++y)
+				{
+					if (countBruteForce(mask, Rect(columns.start, y, columns.size(), 1)) < minimumCount)
+						continue;
+
+					if (first == rows.end)
+						first = y;
+					last = y;
+				}
+				check.expect(profile.findFirstRow(rows, columns, minimumCount), first, "findFirstRow(" + arguments + ")");
+				check.expect(profile.findLastRow(rows, columns, minimumCount), last, "findLastRow(" + arguments + ")");
+			}
+
+			if (profile.hasRectangleSums() || i % 2 == 1)
+			{
+				int first = columns.end, last = columns.start - 1;
+				for (int x = columns.start; x < columns.end; ++x)
+				{
+					if (countBruteForce(mask, Rect(x, rows.start, 1, rows.size())) < minimumCount)
+						continue;
+
+					if (first == columns.end)
+						first = x;
+					last = x;
+				}
+				check.expect(profile.findFirstColumn(columns, rows, minimumCount), first, "findFirstColumn(" + arguments + ")");
+				check.expect(profile.findLastColumn(columns, rows, minimumCount), last, "findLastColumn(" + arguments + ")");
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkProbeSearches()
+	//
+	// Check computeInnermostRectangle() and computeOutermostRectangle(), which only
+	// profile their probe bands, against searching the whole mask by brute force.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkProbeSearches(const Mat& mask, KernelCheck& check)
+	{
+		const Size size = mask.size();
+		const Point center = Point(size.width / 2, size.height / 2);
+		const Range rowBand = computeProbeBand(size.height);
+		const Range columnBand = computeProbeBand(size.width);
+		const int rowCoverage = computeProbeCoverage(rowBand);
+		const int columnCoverage = computeProbeCoverage(columnBand);
+
+		int u = 0, d = size.height, l = 0, r = size.width;
+		for (int y = center.y; y >= 0; --y)
+		{
+			if (countBruteForce(mask, Rect(columnBand.start, y, columnBand.size(), 1)) >= columnCoverage)
+			{
+				u = y;
+				break;
+			}
+		}
+		for (int y = center.y; y < size.height; ++y)
+		{
+			if (countBruteForce(mask, Rect(columnBand.start, y, columnBand.size(), 1)) >= columnCoverage)
+			{
+				d = y;
+				break;
+			}
+		}
+		for (int x = center.x; x >= 0; --x)
+		{
+			if (countBruteForce(mask, Rect(x, rowBand.start, 1, rowBand.size())) >= rowCoverage)
+			{
+				l = x;
+				break;
+			}
+		}
+		for (int x = center.x; x < size.width; ++x)
+		{
+			if (countBruteForce(mask, Rect(x, rowBand.start, 1, rowBand.size())) >= rowCoverage)
+			{
+				r = x;
+				break;
+			}
+		}
+
+		const Rect innermostRectangle = computeInnermostRectangle(mask);
+		check.expect(innermostRectangle.x, l, "computeInnermostRectangle() left");
+		check.expect(innermostRectangle.y, u, "computeInnermostRectangle() top");
+		check.expect(innermostRectangle.x + innermostRectangle.width, r, "computeInnermostRectangle() right");
+		check.expect(innermostRectangle.y + innermostRectangle.height, d, "computeInnermostRectangle() bottom");
+
+		int top = 0;
+		for (int y = 0; y < size.height; ++y)
+		{
+			if (countBruteForce(mask, Rect(columnBand.start, y, columnBand.size(), 1)) >= columnCoverage)
+			{
+				top = y;
+				break;
+			}
+		}
+		check.expect(computeOutermostRectangle(mask).y, top, "computeOutermostRectangle() top");
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkPackedSearches()
+	//
+	// Check that the root searches on a packed mask find what they find on the
+	// CV_8UC1 mask.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkPackedSearches(const Mat& mask, const BinaryMask& packedMask, KernelCheck& check)
+	{
+		const int rootRow = computeRowWithMaximumBlackPixels(mask);
+		check.expect(computeRowWithMaximumBlackPixels(packedMask), rootRow, "packed computeRowWithMaximumBlackPixels()");
+
+		const Rect rootExtents = computeMaximumRootExtents(mask, rootRow);
+		const Rect packedRootExtents = computeMaximumRootExtents(packedMask, rootRow);
+		check.expect(packedRootExtents.x, rootExtents.x, "packed computeMaximumRootExtents() left " + describe(rootExtents));
+		check.expect(packedRootExtents.width, rootExtents.width, "packed computeMaximumRootExtents() width " + describe(rootExtents));
+		check.expect(packedRootExtents.height, rootExtents.height, "packed computeMaximumRootExtents() height " + describe(rootExtents));
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkMorphology()
+	//
+	// Check acceleratedMorphologyEx() against morphologyEx() on the whole of a mask
+	// and on regions of it, where morphologyEx() reads the parent beyond the
+	// region in the first pass of an operation but not in the second. It is
+	// checked on the CPU, where it runs in strips, and on the device if there is
+	// one. A device operation that fails falls back to the CPU, so the accelerator
+	// must still be enabled afterwards for the device to have been checked.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkMorphology(mt19937& random, KernelCheck& check)
+	{
+		const Mat parent = createRandomMask(MORPHOLOGY_MASK_SIZE, 0.3, random);
+		const Rect regions[] = { Rect(Point(0, 0), MORPHOLOGY_MASK_SIZE), Rect(37, 29, 300, 200), Rect(0, 100, 640, 50), Rect(600, 0, 40, 480), Rect(5, 5, 1, 470) };
+		const int operations[] = { MORPH_ERODE, MORPH_DILATE, MORPH_OPEN, MORPH_CLOSE, MORPH_GRADIENT, MORPH_TOPHAT, MORPH_BLACKHAT };
+		const char* operationNames[] = { "erode", "dilate", "open", "close", "gradient", "tophat", "blackhat" };
+		const Size elementSizes[] = { Size(11, 9), Size(1, 15), Size(15, 1) };
+
+		const bool hasDevice = Accelerator::enable();
+		if (!hasDevice)
+			check.stream << "No OpenCL device; acceleratedMorphologyEx() is only checked on the CPU." << endl;
+
+		for (const bool isOnDevice : { false, true })
+		{
+			if (isOnDevice && !Accelerator::enable())
+				continue;
+			if (!isOnDevice)
+				Accelerator::disable();
+
+			for (const Rect& region : regions)
+			{
+				check.maskName = "morphology of region " + describe(region) + (isOnDevice ? " on the device" : " on the CPU");
+
+				for (size_t operation = 0; operation < sizeof(operations) / sizeof(operations[0]); ++operation)
+				{
+					for (const Size& elementSize : elementSizes)
+					{
+						const Mat element = getStructuringElement(MORPH_RECT, elementSize);
+						const string what = string(operationNames[operation]) + " by " + to_string(elementSize.width) + "x" + to_string(elementSize.height);
+
+						Mat expected;
+						Mat actual;
+						morphologyEx(parent(region), expected, operations[operation], element);
+						acceleratedMorphologyEx(parent(region), actual, operations[operation], element);
+
+						check.expect(Accelerator::isEnabled(), isOnDevice, "accelerator enabled after " + what);
+						check.expect(actual.size() == expected.size(), true, "size of " + what + " matches");
+						if (actual.size() != expected.size())
+							continue;
+
+						Mat isDifferent;
+						compare(actual, expected, isDifferent, CMP_NE);
+						check.expect(countNonZero(isDifferent), 0, "pixels of " + what + " differing from morphologyEx()");
+					}
+				}
+			}
+		}
+
+		Accelerator::disable();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// checkMask()
+	//
+	// Run every check on the specified mask, with and without rectangle sums and as
+	// a packed mask.
+	//////////////////////////////////////////////////////////////////////////////////
+	void checkMask(const Mat& mask, const string& name, mt19937& random, KernelCheck& check)
+	{
+		check.maskName = name;
+
+		for (const bool hasRectangleSums : { true, false })
+		{
+			const ProjectionProfile profile(mask, hasRectangleSums);
+			check.expect(profile.hasRectangleSums(), hasRectangleSums, "hasRectangleSums()");
+			checkLines(mask, profile, check);
+			checkRectangles(mask, profile, random, check);
+			checkSearches(mask, profile, random, check);
+		}
+
+		const BinaryMask packedMask = BinaryMask::pack(mask);
+		for (const bool hasRectangleSums : { true, false })
+		{
+			const ProjectionProfile packedProfile(packedMask, hasRectangleSums);
+			checkLines(mask, packedProfile, check);
+			checkRectangles(mask, packedProfile, random, check);
+		}
+		checkPackedSearches(mask, packedMask, check);
+
+		if (!mask.empty())
+			checkProbeSearches(mask, check);
+	}
+}
+
+namespace regression
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// runKernelChecks()
+	//
+	// Run every check on masks of each size and density, and on a region of a
+	// larger mask, reporting each failure to the specified stream. Returns the
+	// number of failures.
+	//////////////////////////////////////////////////////////////////////////////////
+	int runKernelChecks(ostream& stream)
+	{
+		KernelCheck check(stream);
+		mt19937 random(20151014);	// Fixed, so that a failure can be reproduced.
+
+		const Size sizes[] = { Size(0, 0), Size(0, 5), Size(5, 0), Size(1, 1), Size(17, 1), Size(1, 17), Size(2, 2), Size(13, 9), Size(70, 65) };
+		const double densities[] = { 0.0, 0.05, 0.5, 1.0 };
+		for (const Size& size : sizes)
+		{
+			for (const double density : densities)
+			{
+				ostringstream name;
+				name << size.width << "x" << size.height << " at " << density;
+				checkMask(createRandomMask(size, density, random), name.str(), random, check);
+			}
+		}
+
+		// A region isn't continuous, so each row must be read from its own pointer.
+		const Mat parent = createRandomMask(Size(64, 48), 0.5, random);
+		checkMask(parent(Rect(7, 5, 31, 23)), "region of 64x48", random, check);
+		checkMask(parent(Rect(63, 0, 1, 48)), "last column of 64x48", random, check);
+
+		checkMorphology(random, check);
+
+		stream << check.numberOfChecks << " checks, " << check.numberOfFailures << " failed" << endl;
+
+		return check.numberOfFailures;
+	}
+}
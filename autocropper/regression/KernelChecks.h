@@ -0,0 +1,18 @@
+#pragma once
+
+#include <ostream>
+
+//////////////////////////////////////////////////////////////////////////////////
+// KernelChecks
+//
+// Checks the kernels the crop regions are computed from against brute-force
+// versions of them on random masks, including the edge cases a corpus rarely
+// has: empty masks, single rows and columns, regions of larger images, and
+// empty and one pixel bands. The accelerated morphology is checked against
+// OpenCV's on regions of a larger mask, on the device if there is one.
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace regression
+{
+	int runKernelChecks(std::ostream& stream);
+}
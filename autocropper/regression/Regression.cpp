@@ -0,0 +1,550 @@
+#include "Regression.h"
+#include "CropPipeline.h"
+#include "FileUtilities.h"
+#include "ImageReader.h"
+#include "PackedSeries.h"
+#include "StageProfiler.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace autocropper;
+using namespace cv;
+using namespace experimental;
+using namespace OcvUtility;
+using namespace regression;
+using namespace std;
+using namespace utility;
+
+namespace
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// ResidentMemorySampler
+	//
+	// Samples the resident memory of the process on a thread of its own from when
+	// it is created until it is stopped, keeping the most seen. The high-water mark
+	// the system keeps can't be reset, so this is how the peak of one run is told
+	// apart from the peaks of the corpus and of the runs before it. A spike shorter
+	// than the sampling interval can be missed.
+	//////////////////////////////////////////////////////////////////////////////////
+	class ResidentMemorySampler final
+	{
+	public:
+		ResidentMemorySampler()
+			: _peakResidentBytes(StageProfiler::getResidentBytes()),
+			_isStopping(false)
+		{
+			_samplingThread = thread([this]()
+			{
+				unique_lock<mutex> lock(_mutex);
+
+				while (!_stopRequested.wait_for(lock, SAMPLING_INTERVAL, [this]() { return _isStopping; }))
+				{
+					_peakResidentBytes = max(_peakResidentBytes, StageProfiler::getResidentBytes());
+				}
+			});
+		}
+
+		~ResidentMemorySampler()
+		{
+			stop();
+		}
+
+		// Returns the most memory resident at once since the sampler was created.
+		size_t stop()
+		{
+			{
+				lock_guard<mutex> lock(_mutex);
+				_isStopping = true;
+			}
+			_stopRequested.notify_one();
+
+			if (_samplingThread.joinable())
+				_samplingThread.join();
+
+			return max(_peakResidentBytes, StageProfiler::getResidentBytes());
+		}
+	private:
+		ResidentMemorySampler(const ResidentMemorySampler&) = delete;
+		ResidentMemorySampler& operator=(const ResidentMemorySampler&) = delete;
+
+		static const chrono::milliseconds SAMPLING_INTERVAL;
+
+		size_t _peakResidentBytes;
+		bool _isStopping;
+		mutex _mutex;
+		condition_variable _stopRequested;
+		thread _samplingThread;
+	};
+
+	const chrono::milliseconds ResidentMemorySampler::SAMPLING_INTERVAL(5);
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeRect()
+	//
+	// Write the specified rectangle as a map of named fields, as CropSidecar does.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeRect(FileStorage& fs, const string& name, const Rect& rect)
+	{
+		fs << name << "{" << "x" << rect.x << "y" << rect.y << "width" << rect.width << "height" << rect.height << "}";
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// readRect()
+	//
+	// Read a rectangle written by writeRect().
+	//////////////////////////////////////////////////////////////////////////////////
+	Rect readRect(const FileNode& node, const string& seriesName)
+	{
+		if (node.empty())
+			throw runtime_error("The golden set is missing a region of series: " + seriesName);
+
+		return Rect(static_cast<int>(node["x"]), static_cast<int>(node["y"]), static_cast<int>(node["width"]), static_cast<int>(node["height"]));
+	}
+}
+
+namespace regression
+{
+	const string BASELINE_CONFIGURATION = "baseline";
+	const int GOLDEN_SET_VERSION = 1;	// Bump whenever the baseline can find different regions, so golden sets recorded before must be recorded again.
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// EngineConfiguration()
+	//
+	// Create a configuration with the specified name and options.
+	//////////////////////////////////////////////////////////////////////////////////
+	EngineConfiguration::EngineConfiguration(const string& name, const CropRegionOptions& options, const double minimumIntersectionOverUnion)
+		: name(name),
+		options(options),
+		minimumIntersectionOverUnion(minimumIntersectionOverUnion)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// RegressionResult()
+	//
+	// Create the result of a run that hasn't happened yet.
+	//////////////////////////////////////////////////////////////////////////////////
+	RegressionResult::RegressionResult()
+		: numberOfFrames(0),
+		numberOfFramesUsed(0),
+		wallSeconds(0),
+		framesPerSecond(0),
+		peakRunBytes(0),
+		hasGoldenRegions(false),
+		gelIntersectionOverUnion(0),
+		cropIntersectionOverUnion(0),
+		passed(false)
+	{
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getEngineConfigurations()
+	//
+	// Returns every configuration the harness knows, the baseline first. Each of
+	// the faster paths is run on its own, so a regression can be pinned on one,
+	// and then all of them together. The paths documented to find the same
+	// regions as the baseline have to match it exactly.
+	//////////////////////////////////////////////////////////////////////////////////
+	vector<EngineConfiguration> getEngineConfigurations()
+	{
+		const CropRegionOptions baseline;
+		vector<EngineConfiguration> configurations;
+		configurations.push_back(EngineConfiguration(BASELINE_CONFIGURATION, baseline, 1.0));
+
+		CropRegionOptions runLength = baseline;
+		runLength.lineDetectionMethod = LineDetectionMethod::RunLength;
+		configurations.push_back(EngineConfiguration("runlength", runLength, 1.0));
+
+		CropRegionOptions contours = baseline;
+		contours.largestComponentMethod = LargestComponentMethod::Contours;
+		configurations.push_back(EngineConfiguration("contours", contours, 0.98));
+
+		CropRegionOptions halfScale = baseline;
+		halfScale.workingScale = 0.5;
+		configurations.push_back(EngineConfiguration("scale-0.5", halfScale, 0.98));
+
+		CropRegionOptions quarterScale = baseline;
+		quarterScale.workingScale = 0.25;
+		configurations.push_back(EngineConfiguration("scale-0.25", quarterScale, 0.95));
+
+		CropRegionOptions subsampled = baseline;
+		subsampled.coarseFrameStride = 4;
+		configurations.push_back(EngineConfiguration("subsample-4", subsampled, 0.98));
+
+		CropRegionOptions meanBackground = baseline;
+		meanBackground.backgroundModel = BackgroundModel::Mean;
+		configurations.push_back(EngineConfiguration("mean", meanBackground, 0.9));
+
+		CropRegionOptions medianBackground = baseline;
+		medianBackground.backgroundModel = BackgroundModel::Median;
+		configurations.push_back(EngineConfiguration("median", medianBackground, 0.9));
+
+		CropRegionOptions fast = baseline;
+		fast.lineDetectionMethod = LineDetectionMethod::RunLength;
+		fast.workingScale = 0.5;
+		fast.coarseFrameStride = 4;
+		configurations.push_back(EngineConfiguration("fast", fast, 0.95));
+
+		return configurations;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// selectEngineConfigurations()
+	//
+	// Returns the configurations with the specified names, in that order, or every
+	// configuration if no names are specified. Throws if a name is unknown.
+	//////////////////////////////////////////////////////////////////////////////////
+	vector<EngineConfiguration> selectEngineConfigurations(const vector<string>& names)
+	{
+		const vector<EngineConfiguration> configurations = getEngineConfigurations();
+
+		if (names.empty())
+			return configurations;
+
+		vector<EngineConfiguration> selectedConfigurations;
+		for (const auto& name : names)
+		{
+			auto configuration = find_if(configurations.begin(), configurations.end(), [&](const EngineConfiguration& candidate) { return candidate.name == name; });
+			if (configuration == configurations.end())
+				throw invalid_argument("Unknown engine configuration: " + name);
+
+			selectedConfigurations.push_back(*configuration);
+		}
+
+		return selectedConfigurations;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// readRecordedSeries()
+	//
+	// Read every frame of the series beginning with the specified starting file of
+	// the specified corpus, which may be a packed series. Throws if no frames are
+	// found.
+	//////////////////////////////////////////////////////////////////////////////////
+	RecordedSeries readRecordedSeries(const string& startingFilename, const string& corpus, SeriesIndex& seriesIndex, ThreadPool& threadPool)
+	{
+		RecordedSeries series;
+		series.startingFilename = startingFilename;
+		series.goldenKey = computeGoldenKey(startingFilename, corpus);
+
+		if (PackedSeries::isPackedSeries(startingFilename))
+		{
+			series.packedSeries = make_shared<PackedSeries>(startingFilename);
+			series.seriesName = series.packedSeries->getSeriesName();
+			series.frames = series.packedSeries->getFrames();
+		}
+		else
+		{
+			series.seriesName = ImageReader::getSeriesName(startingFilename);
+			series.frames = ImageReader::readImages(seriesIndex.getFilenames(startingFilename), threadPool);
+		}
+
+		if (series.frames.empty())
+			throw runtime_error("No frames of the series were found: " + startingFilename);
+
+		return series;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeGoldenKey()
+	//
+	// Returns the key of the golden regions of the series beginning with the
+	// specified starting file: its path relative to the corpus directory, with /
+	// separators, so a golden set can be checked against a copy of the corpus
+	// anywhere. The starting files of a manifest are keyed as the manifest lists
+	// them.
+	//////////////////////////////////////////////////////////////////////////////////
+	string computeGoldenKey(const string& startingFilename, const string& corpus)
+	{
+		string goldenKey = startingFilename;
+
+		if (FileUtilities::isDirectory(corpus) && goldenKey.compare(0, corpus.size(), corpus) == 0)
+		{
+			goldenKey = goldenKey.substr(corpus.size());
+			goldenKey.erase(0, goldenKey.find_first_not_of("/\\"));
+		}
+
+		replace(goldenKey.begin(), goldenKey.end(), '\\', '/');
+
+		return goldenKey;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// runConfiguration()
+	//
+	// Find the regions of the specified series with the specified configuration,
+	// timing every stage, and compare them with the golden regions of the series
+	// if there are any. The intermediate images are borrowed from the specified
+	// pool, as a batch would borrow them, so buffers an earlier run left in it
+	// aren't counted again. A configuration that throws fails the series rather
+	// than ending the run.
+	//////////////////////////////////////////////////////////////////////////////////
+	RegressionResult runConfiguration(const EngineConfiguration& configuration, const RecordedSeries& series, const GoldenSet& goldenSet, MatPool& matPool)
+	{
+		RegressionResult result;
+		result.configurationName = configuration.name;
+		result.seriesName = series.seriesName;
+		result.goldenKey = series.goldenKey;
+		result.numberOfFrames = static_cast<int>(series.frames.size());
+
+		StageProfiler profiler(configuration.name + "/" + series.seriesName);
+
+		const size_t startResidentBytes = StageProfiler::getResidentBytes();
+		ResidentMemorySampler memorySampler;
+
+		try
+		{
+			const int64 startTicks = getTickCount();
+			result.cropRegion = computeSeriesCropRegion(series.frames, configuration.options, &matPool, &profiler, &result.gelRegion, nullptr, &result.numberOfFramesUsed);
+			result.wallSeconds = (getTickCount() - startTicks) / getTickFrequency();
+			result.framesPerSecond = (result.wallSeconds > 0) ? result.numberOfFrames / result.wallSeconds : 0;
+		}
+		catch (const exception& e)
+		{
+			result.errorMessage = e.what();
+		}
+
+		const size_t peakResidentBytes = memorySampler.stop();
+		result.peakRunBytes = (peakResidentBytes > startResidentBytes) ? peakResidentBytes - startResidentBytes : 0;
+		result.profile = profiler.getProfile();
+
+		auto goldenRegions = goldenSet.find(series.goldenKey);
+		result.hasGoldenRegions = (goldenRegions != goldenSet.end());
+
+		if (result.hasGoldenRegions && result.errorMessage.empty())
+		{
+			result.gelIntersectionOverUnion = computeIntersectionOverUnion(result.gelRegion, goldenRegions->second.gelRegion);
+			result.cropIntersectionOverUnion = computeIntersectionOverUnion(result.cropRegion, goldenRegions->second.cropRegion);
+			result.passed = (result.gelIntersectionOverUnion >= configuration.minimumIntersectionOverUnion && result.cropIntersectionOverUnion >= configuration.minimumIntersectionOverUnion);
+		}
+
+		return result;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// computeIntersectionOverUnion()
+	//
+	// Returns the area the specified rectangles share over the area they cover
+	// together. Identical rectangles give exactly 1, even if they are empty.
+	//////////////////////////////////////////////////////////////////////////////////
+	double computeIntersectionOverUnion(const Rect& a, const Rect& b)
+	{
+		if (a == b)
+			return 1.0;
+
+		const double intersectionArea = (a & b).area();
+		const double unionArea = a.area() + b.area() - intersectionArea;
+
+		return (unionArea > 0) ? intersectionArea / unionArea : 0.0;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// readGoldenSet()
+	//
+	// Read a golden set written by writeGoldenSet(). Throws if it can't be read, or
+	// if it was recorded by a baseline that could find different regions.
+	//////////////////////////////////////////////////////////////////////////////////
+	GoldenSet readGoldenSet(const string& filename)
+	{
+		FileStorage fs(filename, FileStorage::READ);
+
+		if (!fs.isOpened())
+			throw runtime_error("Unable to read golden set: " + filename);
+
+		if (static_cast<int>(fs["version"]) != GOLDEN_SET_VERSION)
+			throw runtime_error("The golden set was recorded before the crop region detection last changed; record it again: " + filename);
+
+		GoldenSet goldenSet;
+		const FileNode series = fs["series"];
+
+		for (auto it = series.begin(); it != series.end(); ++it)
+		{
+			const string goldenKey = static_cast<string>((*it)["startingFile"]);
+			if (goldenKey.empty())
+				throw runtime_error("The golden set doesn't name the starting file of each series; record it again: " + filename);
+
+			GoldenRegions goldenRegions;
+			goldenRegions.gelRegion = readRect((*it)["gelRegion"], goldenKey);
+			goldenRegions.cropRegion = readRect((*it)["cropRegion"], goldenKey);
+			goldenSet[goldenKey] = goldenRegions;
+		}
+
+		return goldenSet;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeGoldenSet()
+	//
+	// Write the golden set to the specified file as YAML, in the form of a crop
+	// sidecar per series. Throws if it can't be written.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeGoldenSet(const GoldenSet& goldenSet, const string& filename)
+	{
+		FileStorage fs(filename, FileStorage::WRITE);
+
+		if (!fs.isOpened())
+			throw runtime_error("Unable to write golden set: " + filename);
+
+		fs << "version" << GOLDEN_SET_VERSION;
+		fs << "series" << "[";
+
+		for (const auto& goldenRegions : goldenSet)
+		{
+			fs << "{" << "startingFile" << goldenRegions.first;
+			writeRect(fs, "gelRegion", goldenRegions.second.gelRegion);
+			writeRect(fs, "cropRegion", goldenRegions.second.cropRegion);
+			fs << "}";
+		}
+
+		fs << "]";
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// createGoldenSet()
+	//
+	// Returns the regions the baseline configuration found in every series it
+	// didn't fail on.
+	//////////////////////////////////////////////////////////////////////////////////
+	GoldenSet createGoldenSet(const vector<RegressionResult>& results)
+	{
+		GoldenSet goldenSet;
+
+		for (const auto& result : results)
+		{
+			if (result.configurationName != BASELINE_CONFIGURATION || !result.errorMessage.empty())
+				continue;
+
+			GoldenRegions goldenRegions;
+			goldenRegions.gelRegion = result.gelRegion;
+			goldenRegions.cropRegion = result.cropRegion;
+			goldenSet[result.goldenKey] = goldenRegions;
+		}
+
+		return goldenSet;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeConsole()
+	//
+	// Write the results as a table, one run per line, followed by the pass count
+	// and mean throughput of each configuration.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeConsole(const vector<RegressionResult>& results, ostream& stream)
+	{
+		const ios_base::fmtflags flags = stream.flags();
+		const streamsize precision = stream.precision();
+
+		size_t configurationWidth = string("Configuration").size();
+		size_t seriesWidth = string("Series").size();
+		for (const auto& result : results)
+		{
+			configurationWidth = max(configurationWidth, result.configurationName.size());
+			seriesWidth = max(seriesWidth, result.seriesName.size());
+		}
+		configurationWidth += 2;
+
+		stream << left << setw(configurationWidth) << "Configuration" << setw(seriesWidth) << "Series" << right
+			<< setw(10) << "Frames/s" << setw(8) << "Used" << setw(12) << "Peak (MB)"
+			<< setw(10) << "Gel IoU" << setw(10) << "Root IoU" << "  Status" << endl;
+		stream << string(configurationWidth + seriesWidth + 10 + 8 + 12 + 10 + 10 + 8, '-') << endl;
+
+		for (const auto& result : results)
+		{
+			stream << left << setw(configurationWidth) << result.configurationName << setw(seriesWidth) << result.seriesName << right;
+
+			if (!result.errorMessage.empty())
+			{
+				stream << "  FAILED: " << result.errorMessage << endl;
+				continue;
+			}
+
+			stream << fixed << setprecision(1) << setw(10) << result.framesPerSecond
+				<< setw(8) << result.numberOfFramesUsed
+				<< setw(12) << result.peakRunBytes / (1024.0 * 1024.0);
+
+			if (result.hasGoldenRegions)
+				stream << setprecision(4) << setw(10) << result.gelIntersectionOverUnion << setw(10) << result.cropIntersectionOverUnion << (result.passed ? "  ok" : "  FAILED") << endl;
+			else
+				stream << setw(10) << "-" << setw(10) << "-" << "  no golden regions" << endl;
+		}
+
+		stream << endl;
+
+		vector<string> configurationNames;
+		for (const auto& result : results)
+		{
+			if (find(configurationNames.begin(), configurationNames.end(), result.configurationName) == configurationNames.end())
+				configurationNames.push_back(result.configurationName);
+		}
+
+		for (const auto& configurationName : configurationNames)
+		{
+			int numberOfRuns = 0;
+			int numberOfPasses = 0;
+			double totalFramesPerSecond = 0;
+
+			for (const auto& result : results)
+			{
+				if (result.configurationName != configurationName)
+					continue;
+
+				++numberOfRuns;
+				numberOfPasses += result.passed ? 1 : 0;
+				totalFramesPerSecond += result.framesPerSecond;
+			}
+
+			stream << left << setw(configurationWidth) << configurationName << right
+				<< numberOfPasses << "/" << numberOfRuns << " passed, "
+				<< fixed << setprecision(1) << totalFramesPerSecond / numberOfRuns << " frames/s on average" << endl;
+		}
+
+		stream.flags(flags);
+		stream.precision(precision);
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// writeCsv()
+	//
+	// Write the results as CSV, one run per line.
+	//////////////////////////////////////////////////////////////////////////////////
+	void writeCsv(const vector<RegressionResult>& results, ostream& stream)
+	{
+		stream << "configuration,series,starting_file,status,gel_x,gel_y,gel_width,gel_height,x,y,width,height,frames,frames_used,wall_seconds,frames_per_second,peak_run_bytes,gel_iou,root_iou,error" << endl;
+
+		for (const auto& result : results)
+		{
+			const string status = !result.errorMessage.empty() ? "failed" : !result.hasGoldenRegions ? "no_golden" : result.passed ? "ok" : "mismatch";
+
+			stream << FileUtilities::quoteCsv(result.configurationName) << "," << FileUtilities::quoteCsv(result.seriesName) << "," << FileUtilities::quoteCsv(result.goldenKey) << "," << status << ","
+				<< result.gelRegion.x << "," << result.gelRegion.y << "," << result.gelRegion.width << "," << result.gelRegion.height << ","
+				<< result.cropRegion.x << "," << result.cropRegion.y << "," << result.cropRegion.width << "," << result.cropRegion.height << ","
+				<< result.numberOfFrames << "," << result.numberOfFramesUsed << ","
+				<< result.wallSeconds << "," << result.framesPerSecond << "," << result.peakRunBytes << ","
+				<< result.gelIntersectionOverUnion << "," << result.cropIntersectionOverUnion << "," << FileUtilities::quoteCsv(result.errorMessage) << endl;
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// getProfiles()
+	//
+	// Returns the stage timings of every run, in the order of the results. Each is
+	// named by its configuration and series.
+	//////////////////////////////////////////////////////////////////////////////////
+	vector<SeriesProfile> getProfiles(const vector<RegressionResult>& results)
+	{
+		vector<SeriesProfile> profiles;
+
+		for (const auto& result : results)
+		{
+			profiles.push_back(result.profile);
+		}
+
+		return profiles;
+	}
+}
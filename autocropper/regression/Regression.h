@@ -0,0 +1,118 @@
+#pragma once
+
+#include "CropPipeline.h"
+#include "MatPool.h"
+#include "PackedSeries.h"
+#include "SeriesIndex.h"
+#include "StageProfiler.h"
+#include "ThreadPool.h"
+#include <opencv2/core.hpp>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////////
+// Regression
+//
+// Runs a corpus of recorded series through each engine configuration, times
+// them, and compares the gel and root regions each finds with a golden set
+// recorded from the baseline configuration. A configuration passes a series if
+// both of its regions overlap the golden ones by at least its minimum
+// intersection over union.
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace regression
+{
+	//////////////////////////////////////////////////////////////////////////////////
+	// EngineConfiguration
+	//
+	// A named set of crop region options, and how closely its regions must match
+	// the golden ones.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct EngineConfiguration
+	{
+		EngineConfiguration(const std::string& name, const autocropper::CropRegionOptions& options, const double minimumIntersectionOverUnion);
+
+		std::string name;
+		autocropper::CropRegionOptions options;
+		double minimumIntersectionOverUnion;	// 1 requires the regions to match exactly.
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// GoldenRegions
+	//
+	// The regions the baseline configuration found in one series.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct GoldenRegions
+	{
+		cv::Rect gelRegion;
+		cv::Rect cropRegion;
+	};
+
+	typedef std::map<std::string, GoldenRegions> GoldenSet;	// Keyed by the starting file relative to the corpus, as series names needn't be unique.
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// RecordedSeries
+	//
+	// The frames of one series of the corpus, read before any configuration is
+	// timed on them.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct RecordedSeries
+	{
+		std::string seriesName;
+		std::string startingFilename;
+		std::string goldenKey;
+		std::vector<cv::Mat> frames;
+		std::shared_ptr<autocropper::PackedSeries> packedSeries;	// Keeps a packed series mapped, as its frames are views of it.
+	};
+
+	//////////////////////////////////////////////////////////////////////////////////
+	// RegressionResult
+	//
+	// What one configuration found in one series, how fast, and how it compares
+	// with the golden regions.
+	//////////////////////////////////////////////////////////////////////////////////
+	struct RegressionResult
+	{
+		RegressionResult();
+
+		std::string configurationName;
+		std::string seriesName;
+		std::string goldenKey;
+		cv::Rect gelRegion;
+		cv::Rect cropRegion;
+		int numberOfFrames;
+		int numberOfFramesUsed;
+		double wallSeconds;
+		double framesPerSecond;			// Of the frames of the series, whether or not all of them were used.
+		size_t peakRunBytes;			// The most memory resident during the run above what was resident before it, so the corpus and earlier runs aren't counted.
+		bool hasGoldenRegions;
+		double gelIntersectionOverUnion;
+		double cropIntersectionOverUnion;
+		bool passed;
+		std::string errorMessage;
+		utility::SeriesProfile profile;
+	};
+
+	std::vector<EngineConfiguration> getEngineConfigurations();
+	std::vector<EngineConfiguration> selectEngineConfigurations(const std::vector<std::string>& names);
+
+	RecordedSeries readRecordedSeries(const std::string& startingFilename, const std::string& corpus, autocropper::SeriesIndex& seriesIndex, utility::ThreadPool& threadPool);
+	std::string computeGoldenKey(const std::string& startingFilename, const std::string& corpus);
+	RegressionResult runConfiguration(const EngineConfiguration& configuration, const RecordedSeries& series, const GoldenSet& goldenSet, utility::MatPool& matPool);
+
+	double computeIntersectionOverUnion(const cv::Rect& a, const cv::Rect& b);
+
+	GoldenSet readGoldenSet(const std::string& filename);
+	void writeGoldenSet(const GoldenSet& goldenSet, const std::string& filename);
+	GoldenSet createGoldenSet(const std::vector<RegressionResult>& results);
+
+	void writeConsole(const std::vector<RegressionResult>& results, std::ostream& stream);
+	void writeCsv(const std::vector<RegressionResult>& results, std::ostream& stream);
+	std::vector<utility::SeriesProfile> getProfiles(const std::vector<RegressionResult>& results);
+
+	extern const std::string BASELINE_CONFIGURATION;
+	extern const int GOLDEN_SET_VERSION;
+}
@@ -0,0 +1,138 @@
+#include "BatchProcessor.h"
+#include "CommandLineArguments.h"
+#include "KernelChecks.h"
+#include "Regression.h"
+#include "SeriesIndex.h"
+#include "StageProfiler.h"
+#include "ThreadPool.h"
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+using namespace autocropper;
+using namespace regression;
+using namespace std;
+using namespace utility;
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		CommandLineArguments arguments(argc, argv);
+
+		// The kernel checks need no corpus, so they can be run on their own.
+		if (arguments.hasOption("check"))
+			return (runKernelChecks(cout) == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+		if (arguments.hasOption("help") || !arguments.hasOption("corpus") || !arguments.hasOption("golden"))
+		{
+			cerr << "Usage: regression --corpus=<directory or manifest> --golden=<file> [options]" << endl;
+			cerr << "       regression --check" << endl;
+			cerr << "Options:" << endl;
+			cerr << "  --check                   Check the kernels against brute-force versions of them on random masks, instead of running a corpus." << endl;
+			cerr << "  --record                  Write the regions the baseline finds in the corpus as the golden set, instead of comparing with it." << endl;
+			cerr << "  --configurations=<names>  Only run these configurations, separated by commas." << endl;
+			cerr << "  --iou=<fraction>          Require every configuration to match the golden regions by at least this intersection over union." << endl;
+			cerr << "  --format=<format>         Write the results as console (default) or csv." << endl;
+			cerr << "  --profile=<file>          Write the time and memory of each stage of every run, as CSV if <file> ends in .csv, otherwise JSON." << endl;
+			cerr << "Configurations:";
+			for (const auto& configuration : getEngineConfigurations())
+			{
+				cerr << " " << configuration.name;
+			}
+			cerr << endl;
+			return arguments.hasOption("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		const bool isRecording = arguments.hasOption("record");
+		const string goldenFilename = arguments.getOption("golden");
+
+		vector<EngineConfiguration> configurations = selectEngineConfigurations(isRecording ? vector<string>(1, BASELINE_CONFIGURATION) : arguments.getListOption("configurations"));
+		if (arguments.hasOption("iou"))
+		{
+			const double minimumIntersectionOverUnion = arguments.getDoubleOption("iou", 1.0);
+			if (minimumIntersectionOverUnion < 0 || minimumIntersectionOverUnion > 1)
+				throw invalid_argument("--iou must be from 0 to 1.");
+
+			for (auto& configuration : configurations)
+			{
+				configuration.minimumIntersectionOverUnion = minimumIntersectionOverUnion;
+			}
+		}
+
+		const string format = arguments.getOption("format", "console");
+		if (format != "console" && format != "csv")
+			throw invalid_argument("--format must be console or csv.");
+
+		const GoldenSet goldenSet = isRecording ? GoldenSet() : readGoldenSet(goldenFilename);
+
+		SeriesIndex seriesIndex;
+		const vector<string> startingFilenames = BatchProcessor::findSeries(arguments.getOption("corpus"), &seriesIndex);
+		if (startingFilenames.empty())
+			throw runtime_error("No series were found in the corpus: " + arguments.getOption("corpus"));
+
+		// Each series is read once, untimed, and run through every configuration before the next is read.
+		ThreadPool threadPool;
+		MatPool matPool;
+		vector<RegressionResult> results;
+		for (const auto& startingFilename : startingFilenames)
+		{
+			cerr << "Reading " << startingFilename << endl;
+			RecordedSeries series;
+			try
+			{
+				series = readRecordedSeries(startingFilename, arguments.getOption("corpus"), seriesIndex, threadPool);
+			}
+			catch (const exception& e)	// A series that can't be read fails every configuration, but doesn't stop the others.
+			{
+				for (const auto& configuration : configurations)
+				{
+					RegressionResult result;
+					result.configurationName = configuration.name;
+					result.seriesName = startingFilename;
+					result.goldenKey = computeGoldenKey(startingFilename, arguments.getOption("corpus"));
+					result.errorMessage = e.what();
+					results.push_back(result);
+				}
+				continue;
+			}
+
+			for (const auto& configuration : configurations)
+			{
+				cerr << "  " << configuration.name << endl;
+				results.push_back(runConfiguration(configuration, series, goldenSet, matPool));
+			}
+		}
+
+		if (format == "csv")
+			writeCsv(results, cout);
+		else
+			writeConsole(results, cout);
+
+		if (arguments.hasOption("profile") && !StageProfiler::writeProfiles(getProfiles(results), arguments.getOption("profile")))
+		{
+			cerr << "Unable to write profile: " << arguments.getOption("profile") << endl;
+			return EXIT_FAILURE;
+		}
+
+		if (isRecording)
+		{
+			writeGoldenSet(createGoldenSet(results), goldenFilename);
+			return EXIT_SUCCESS;
+		}
+
+		for (const auto& result : results)
+		{
+			if (!result.passed)
+				return EXIT_FAILURE;
+		}
+	}
+	catch (const exception& e)
+	{
+		cerr << "Error: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}